@@ -42,6 +42,8 @@ struct _plughandle_t {
 	plugstate_t state;
 	plugstate_t stash;
 
+	pattern_t pats [MAX_PATTERNS];
+
 	const LV2_Atom_Sequence *control;
 	LV2_Atom_Sequence *notify;
 
@@ -96,20 +98,21 @@ _disable_bell(plughandle_t *handle, int64_t frames)
 }
 
 static void
-_enable_bell(plughandle_t *handle, int64_t frames)
+_enable_bell(plughandle_t *handle, int64_t frames, uint8_t channel,
+	uint8_t note, uint8_t velocity)
 {
 	_disable_bell(handle, frames);
 
 	const uint8_t msg [3] = {
-		LV2_MIDI_MSG_NOTE_ON | handle->state.channel,
-		handle->state.note,
-		handle->state.velocity
+		LV2_MIDI_MSG_NOTE_ON | channel,
+		note,
+		velocity
 	};
 
 	_send_midi(handle, frames, sizeof(msg), msg);
 
-	handle->last_channel = handle->state.channel;
-	handle->last_note = handle->state.note;
+	handle->last_channel = channel;
+	handle->last_note = note;
 	handle->last_remaining = handle->rate / 1000 * handle->state.duration;
 }
 
@@ -118,17 +121,35 @@ _intercept_trigger(void *data, int64_t frames,
 	props_impl_t *impl __attribute__((unused)))
 {
 	plughandle_t *handle = data;
+	const int32_t trigger = handle->state.trigger;
 
-	if(handle->state.trigger)
+	if(trigger == TRIGGER_BELL)
+	{
+		_enable_bell(handle, frames, handle->state.channel, handle->state.note,
+			handle->state.velocity);
+	}
+	else if( (trigger >= TRIGGER_PATTERN(0))
+		&& (trigger < TRIGGER_PATTERN(MAX_PATTERNS)) )
 	{
-		_enable_bell(handle, frames);
+		const pattern_t *pat = &handle->pats[trigger - TRIGGER_PATTERN(0)];
+
+		_enable_bell(handle, frames, pat->channel, pat->note, pat->velocity);
 	}
 	else
 	{
 		_disable_bell(handle, frames);
 	}
 
-	handle->state.trigger = false;
+	handle->state.trigger = TRIGGER_NONE;
+}
+
+static void
+_intercept_patterns(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
+{
+	plughandle_t *handle = data;
+
+	_patterns_parse(handle->pats, handle->state.patterns);
 }
 
 static const props_def_t defs [MAX_NPROPS] = {
@@ -155,13 +176,20 @@ static const props_def_t defs [MAX_NPROPS] = {
 	{
 		.property = SHELLS_BELLS__trigger,
 		.offset = offsetof(plugstate_t, trigger),
-		.type = LV2_ATOM__Bool,
+		.type = LV2_ATOM__Int,
 		.event_cb = _intercept_trigger,
 	},
 	{
 		.property = SHELLS_BELLS__fontHeight,
 		.offset = offsetof(plugstate_t, font_height),
 		.type = LV2_ATOM__Int
+	},
+	{
+		.property = SHELLS_BELLS__patterns,
+		.offset = offsetof(plugstate_t, patterns),
+		.type = LV2_ATOM__String,
+		.max_size = MAX_PATTERNS_LEN,
+		.event_cb = _intercept_patterns
 	}
 };
 
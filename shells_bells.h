@@ -19,6 +19,9 @@
 #define _SHELLS_BELLS_LV2_H
 
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #if !defined(_WIN32)
 #	include <sys/mman.h>
 #else
@@ -55,10 +58,21 @@
 #define SHELLS_BELLS__duration      SHELLS_BELLS_PREFIX "duration"
 #define SHELLS_BELLS__trigger       SHELLS_BELLS_PREFIX "trigger"
 #define SHELLS_BELLS__fontHeight    SHELLS_BELLS_PREFIX "fontHeight"
+#define SHELLS_BELLS__patterns      SHELLS_BELLS_PREFIX "patterns"
 
-#define MAX_NPROPS 6
+#define MAX_NPROPS 7
+
+#define MAX_PATTERNS 4
+#define MAX_PATTERN_LEN 128
+#define MAX_PATTERNS_LEN (MAX_PATTERNS * MAX_PATTERN_LEN)
+
+// values of trigger property
+#define TRIGGER_NONE 0
+#define TRIGGER_BELL 1
+#define TRIGGER_PATTERN(IDX) (2 + (IDX))
 
 typedef struct _plugstate_t plugstate_t;
+typedef struct _pattern_t pattern_t;
 
 struct _plugstate_t {
 	int32_t channel;
@@ -67,6 +81,90 @@ struct _plugstate_t {
 	int32_t duration;
 	int32_t trigger;
 	int32_t font_height;
+	char patterns [MAX_PATTERNS_LEN];
+};
+
+struct _pattern_t {
+	int32_t channel;
+	int32_t note;
+	int32_t velocity;
+	char str [MAX_PATTERN_LEN];
 };
 
+static inline int32_t
+_pattern_clamp(int32_t val, int32_t max)
+{
+	return val < 0 ? 0 : (val > max ? max : val);
+}
+
+/* parse a single 'channel note velocity pattern' rule, the pattern being the
+ * verbatim remainder of the rule, invalid rules get an empty pattern */
+static inline void
+_pattern_parse(pattern_t *pat, const char *rule, size_t len)
+{
+	char buf [MAX_PATTERN_LEN];
+	int32_t vals [3];
+	char *ptr = buf;
+
+	memset(pat, 0x0, sizeof(pattern_t));
+
+	if(len >= sizeof(buf))
+	{
+		len = sizeof(buf) - 1;
+	}
+
+	memcpy(buf, rule, len);
+	buf[len] = '\0';
+
+	for(unsigned i = 0; i < 3; i++)
+	{
+		char *end = NULL;
+
+		vals[i] = strtol(ptr, &end, 10);
+
+		if( (end == ptr) || ( (*end != ' ') && (*end != '\t') ) )
+		{
+			return;
+		}
+
+		ptr = end + 1;
+	}
+
+	pat->channel = _pattern_clamp(vals[0], 0xf);
+	pat->note = _pattern_clamp(vals[1], 0x7f);
+	pat->velocity = _pattern_clamp(vals[2], 0x7f);
+	snprintf(pat->str, sizeof(pat->str), "%s", ptr);
+}
+
+// parse newline separated rules
+static inline unsigned
+_patterns_parse(pattern_t *pats, const char *patterns)
+{
+	const char *rule = patterns;
+	unsigned n = 0;
+
+	for( ; n < MAX_PATTERNS; n++)
+	{
+		const char *eol = strchr(rule, '\n');
+		const size_t len = eol ? (size_t)(eol - rule) : strlen(rule);
+
+		_pattern_parse(&pats[n], rule, len);
+
+		if(!eol)
+		{
+			n++;
+			break;
+		}
+
+		rule = eol + 1;
+	}
+
+	for(unsigned i = n; i < MAX_PATTERNS; i++)
+	{
+		memset(&pats[i], 0x0, sizeof(pattern_t));
+	}
+
+	return n;
+}
+
 #endif // _SHELLS_BELLS_LV2_H
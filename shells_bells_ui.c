@@ -25,7 +25,7 @@
 #include <time.h>
 #include <utime.h>
 #include <limits.h>
-#include <wordexp.h>
+#include <strings.h>
 
 #include <shells_bells.h>
 #include <props.h>
@@ -77,20 +77,27 @@ struct _plughandle_t {
 	LV2_URID urid_duration;
 	LV2_URID urid_trigger;
 	LV2_URID urid_fontHeight;
+	LV2_URID urid_patterns;
 
 	bool reinit;
 
 	float scale;
 	d2tk_coord_t header_height;
 	d2tk_coord_t footer_height;
+	d2tk_coord_t patterns_height;
 	d2tk_coord_t sidebar_width;
 	d2tk_coord_t font_height;
 
 	uint32_t max_red;
 
+	char rules [MAX_PATTERNS][MAX_PATTERN_LEN];
+	pattern_t pats [MAX_PATTERNS];
+	const char *pattern_strs [MAX_PATTERNS + 1];
+
 	int done;
 
-	wordexp_t wordexp;
+	char shell [PATH_MAX];
+	char *args [2];
 };
 
 static inline void
@@ -108,6 +115,35 @@ _intercept_font_height(void *data, int64_t frames __attribute__((unused)),
 	_update_font_height(handle);
 }
 
+static void
+_intercept_patterns(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
+{
+	plughandle_t *handle = data;
+	const char *rule = handle->state.patterns;
+
+	// split into editable rules
+	for(unsigned i = 0; i < MAX_PATTERNS; i++)
+	{
+		const char *eol = rule ? strchr(rule, '\n') : NULL;
+		const size_t len = eol ? (size_t)(eol - rule) : (rule ? strlen(rule) : 0);
+
+		snprintf(handle->rules[i], sizeof(handle->rules[i]), "%.*s",
+			(int)len, rule ? rule : "");
+
+		rule = eol ? eol + 1 : NULL;
+	}
+
+	_patterns_parse(handle->pats, handle->state.patterns);
+
+	for(unsigned i = 0; i < MAX_PATTERNS; i++)
+	{
+		handle->pattern_strs[i] = handle->pats[i].str;
+	}
+
+	handle->pattern_strs[MAX_PATTERNS] = NULL;
+}
+
 static const props_def_t defs [MAX_NPROPS] = {
 	{
 		.property = SHELLS_BELLS__channel,
@@ -132,13 +168,20 @@ static const props_def_t defs [MAX_NPROPS] = {
 	{
 		.property = SHELLS_BELLS__trigger,
 		.offset = offsetof(plugstate_t, trigger),
-		.type = LV2_ATOM__Bool
+		.type = LV2_ATOM__Int
 	},
 	{
 		.property = SHELLS_BELLS__fontHeight,
 		.offset = offsetof(plugstate_t, font_height),
 		.type = LV2_ATOM__Int,
 		.event_cb = _intercept_font_height
+	},
+	{
+		.property = SHELLS_BELLS__patterns,
+		.offset = offsetof(plugstate_t, patterns),
+		.type = LV2_ATOM__String,
+		.max_size = MAX_PATTERNS_LEN,
+		.event_cb = _intercept_patterns
 	}
 };
 
@@ -335,13 +378,49 @@ _expose_footer(plughandle_t *handle, const d2tk_rect_t *rect)
 	}
 }
 
+static inline void
+_expose_patterns(plughandle_t *handle, const d2tk_rect_t *rect)
+{
+	d2tk_frontend_t *dpugl = handle->dpugl;
+	d2tk_base_t *base = d2tk_frontend_get_base(dpugl);
+
+	D2TK_BASE_TABLE(rect, 1, MAX_PATTERNS, D2TK_FLAG_TABLE_REL, tab)
+	{
+		const unsigned y = d2tk_table_get_index_y(tab);
+		const d2tk_rect_t *trect = d2tk_table_get_rect(tab);
+
+		if(d2tk_base_lineedit_is_changed(base, D2TK_ID_IDX(y),
+			sizeof(handle->rules[y]), handle->rules[y], NULL, trect,
+			D2TK_FLAG_PTY_NOMOUSE))
+		{
+			char *tail = handle->state.patterns;
+			const char *end = tail + sizeof(handle->state.patterns);
+
+			// join rules
+			for(unsigned i = 0; i < MAX_PATTERNS; i++)
+			{
+				tail += snprintf(tail, end - tail, i ? "\n%s" : "%s",
+					handle->rules[i]);
+
+				if(tail >= end)
+				{
+					break;
+				}
+			}
+
+			_message_set_key(handle, handle->urid_patterns);
+			_intercept_patterns(handle, 0, NULL);
+		}
+	}
+}
+
 static inline void
 _expose_term(plughandle_t *handle, const d2tk_rect_t *rect)
 {
 	d2tk_frontend_t *dpugl = handle->dpugl;
 	d2tk_base_t *base = d2tk_frontend_get_base(dpugl);
 
-	char **args = handle->wordexp.we_wordv;
+	char **args = handle->args;
 
 	d2tk_flag_t flag = D2TK_FLAG_PTY_NOMOUSE;
 	if(handle->reinit)
@@ -365,9 +444,33 @@ _expose_term(plughandle_t *handle, const d2tk_rect_t *rect)
 			handle->done = 1;
 		}
 
+		if(d2tk_state_is_paste(state))
+		{
+			const char *type = NULL;
+			size_t len = 0;
+			const char *buf = d2tk_frontend_get_clipboard(dpugl, &type, &len);
+
+			if(buf && len)
+			{
+				d2tk_pty_paste(pty, len, buf);
+			}
+		}
+
+		d2tk_pty_set_patterns(pty, handle->pattern_strs);
+
 		if(d2tk_state_is_bell(state))
 		{
-			handle->state.trigger = true;
+			handle->state.trigger = TRIGGER_BELL;
+
+			_message_set_key(handle, handle->urid_trigger);
+		}
+
+		if(d2tk_state_is_match(state))
+		{
+			// first matching rule wins
+			const int idx = ffs(d2tk_pty_get_matches(pty)) - 1;
+
+			handle->state.trigger = TRIGGER_PATTERN(idx);
 
 			_message_set_key(handle, handle->urid_trigger);
 		}
@@ -404,8 +507,9 @@ _expose_editor(plughandle_t *handle, const d2tk_rect_t *rect)
 static inline void
 _expose_sidebar_left(plughandle_t *handle, const d2tk_rect_t *rect)
 {
-	const d2tk_coord_t frac [2] = { 0, handle->footer_height };
-	D2TK_BASE_LAYOUT(rect, 2, frac, D2TK_FLAG_LAYOUT_Y_ABS, lay)
+	const d2tk_coord_t frac [3] = { 0, handle->patterns_height,
+		handle->footer_height };
+	D2TK_BASE_LAYOUT(rect, 3, frac, D2TK_FLAG_LAYOUT_Y_ABS, lay)
 	{
 		const unsigned k = d2tk_layout_get_index(lay);
 		const d2tk_rect_t *lrect = d2tk_layout_get_rect(lay);
@@ -417,6 +521,10 @@ _expose_sidebar_left(plughandle_t *handle, const d2tk_rect_t *rect)
 				_expose_editor(handle, lrect);
 			} break;
 			case 1:
+			{
+				_expose_patterns(handle, lrect);
+			} break;
+			case 2:
 			{
 				_expose_footer(handle, lrect);
 			} break;
@@ -568,6 +676,8 @@ instantiate(const LV2UI_Descriptor *descriptor,
 		SHELLS_BELLS__trigger);
 	handle->urid_fontHeight = handle->map->map(handle->map->handle,
 		SHELLS_BELLS__fontHeight);
+	handle->urid_patterns = handle->map->map(handle->map->handle,
+		SHELLS_BELLS__patterns);
 
 	if(!props_init(&handle->props, plugin_uri,
 		defs, MAX_NPROPS, &handle->state, &handle->stash,
@@ -580,15 +690,10 @@ instantiate(const LV2UI_Descriptor *descriptor,
 
 	static const char *fallback= "sh";
 	const char *shell = getenv("SHELL");
-	char cmdline [PATH_MAX];
-	snprintf(cmdline, sizeof(cmdline), "%s",
-			shell ? shell : fallback);
-	if(wordexp(cmdline, &handle->wordexp, WRDE_NOCMD) != 0)
-	{
-		fprintf(stderr, "failed to parse EDITOR");
-		free(handle);
-		return NULL;
-	}
+	snprintf(handle->shell, sizeof(handle->shell), "%s",
+			shell && *shell ? shell : fallback);
+	handle->args[0] = handle->shell;
+	handle->args[1] = NULL;
 
 	handle->controller = controller;
 	handle->writer = write_function;
@@ -636,6 +741,7 @@ instantiate(const LV2UI_Descriptor *descriptor,
 
 	handle->header_height = 32 * handle->scale;
 	handle->footer_height = 32 * handle->scale;
+	handle->patterns_height = MAX_PATTERNS * 24 * handle->scale;
 	handle->sidebar_width = 1 * handle->scale;
 
 	handle->state.font_height = 16;
@@ -652,6 +758,7 @@ instantiate(const LV2UI_Descriptor *descriptor,
 	_message_get(handle, handle->urid_duration);
 	_message_get(handle, handle->urid_trigger);
 	_message_get(handle, handle->urid_fontHeight);
+	_message_get(handle, handle->urid_patterns);
 
 	return handle;
 }
@@ -663,8 +770,6 @@ cleanup(LV2UI_Handle instance)
 
 	d2tk_frontend_free(handle->dpugl);
 
-	wordfree(&handle->wordexp);
-
 	free(handle);
 }
 
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2018-2019 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#ifndef _D2TK_BACKEND_SOFT_H
+#define _D2TK_BACKEND_SOFT_H
+
+#include <d2tk/backend.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _d2tk_soft_target_t d2tk_soft_target_t;
+
+// render target of the software backend, handed over as context to
+// d2tk_base_pre and to custom widget callbacks
+struct _d2tk_soft_target_t {
+	uint32_t *argb; // premultiplied, native endian 0xAARRGGBB
+	size_t stride; // in bytes
+	d2tk_coord_t w;
+	d2tk_coord_t h;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _D2TK_BACKEND_SOFT_H
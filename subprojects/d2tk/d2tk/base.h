@@ -142,7 +142,9 @@ typedef enum _d2tk_state_t {
 	D2TK_STATE_ENTER				= (1 << 13),
 	D2TK_STATE_OVER	  			= (1 << 14),
 	D2TK_STATE_CLOSE	 			= (1 << 15),
-	D2TK_STATE_BELL	 				= (1 << 16)
+	D2TK_STATE_BELL	 				= (1 << 16),
+	D2TK_STATE_MATCH				= (1 << 17),
+	D2TK_STATE_PASTE				= (1 << 18)
 } d2tk_state_t;
 
 typedef enum _d2tk_flag_t {
@@ -166,7 +168,9 @@ typedef enum _d2tk_flag_t {
 	D2TK_FLAG_SEPARATOR_X   = (1 << 11),
 	D2TK_FLAG_SEPARATOR_Y   = (1 << 12),
 	D2TK_FLAG_PTY_REINIT    = (1 << 13),
-	D2TK_FLAG_PTY_NOMOUSE   = (1 << 14)
+	D2TK_FLAG_PTY_NOMOUSE   = (1 << 14),
+	D2TK_FLAG_PTY_REPLAY    = (1 << 15),
+	D2TK_FLAG_PTY_FAST      = (1 << 16)
 } d2tk_flag_t;
 
 #define D2TK_ID_IDX(IDX) ( ((d2tk_id_t)__LINE__ << 16) | (IDX) )
@@ -374,6 +378,12 @@ d2tk_state_is_close(d2tk_state_t state);
 D2TK_API bool
 d2tk_state_is_bell(d2tk_state_t state);
 
+D2TK_API bool
+d2tk_state_is_match(d2tk_state_t state);
+
+D2TK_API bool
+d2tk_state_is_paste(d2tk_state_t state);
+
 D2TK_API bool
 d2tk_base_is_hit(d2tk_base_t *base, const d2tk_rect_t *rect);
 
@@ -418,6 +428,10 @@ d2tk_base_get_default_style();
 D2TK_API const d2tk_style_t *
 d2tk_base_get_style(d2tk_base_t *base);
 
+D2TK_API uint64_t
+d2tk_base_get_style_hash(d2tk_base_t *base);
+
+// style is hashed once per call, set it again after editing it in place
 D2TK_API void
 d2tk_base_set_style(d2tk_base_t *base, const d2tk_style_t *style);
 
@@ -490,6 +504,9 @@ D2TK_API d2tk_state_t
 d2tk_base_label(d2tk_base_t *base, ssize_t lbl_len, const char *lbl,
 	float mul, const d2tk_rect_t *rect, d2tk_align_t align);
 
+D2TK_API void
+d2tk_base_stats(d2tk_base_t *base, const d2tk_rect_t *rect);
+
 D2TK_API d2tk_state_t
 d2tk_base_link(d2tk_base_t *base, d2tk_id_t id, ssize_t lbl_len, const char *lbl,
 	float mul, const d2tk_rect_t *rect, d2tk_align_t align);
@@ -522,6 +539,21 @@ d2tk_pty_get_max_green(d2tk_pty_t *pty);
 D2TK_API uint32_t
 d2tk_pty_get_max_blue(d2tk_pty_t *pty);
 
+D2TK_API void
+d2tk_pty_set_patterns(d2tk_pty_t *pty, const char **patterns);
+
+D2TK_API uint32_t
+d2tk_pty_get_matches(d2tk_pty_t *pty);
+
+D2TK_API void
+d2tk_pty_paste(d2tk_pty_t *pty, size_t len, const char *buf);
+
+D2TK_API uint64_t
+d2tk_pty_get_spawn_latency(d2tk_pty_t *pty);
+
+D2TK_API int
+d2tk_pty_record(d2tk_pty_t *pty, const char *path);
+
 #define D2TK_BASE_PTY(BASE, ID, CB, DATA, HEIGHT, RECT, FLAGS, PTY) \
 	for(d2tk_pty_t *(PTY) = d2tk_pty_begin((BASE), (ID), (CB), (DATA), (HEIGHT), \
 			(RECT), (FLAGS), alloca(d2tk_pty_sz)); \
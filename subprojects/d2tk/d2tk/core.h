@@ -35,6 +35,10 @@ typedef struct _d2tk_widget_t d2tk_widget_t;
 typedef struct _d2tk_point_t d2tk_point_t;
 typedef struct _d2tk_core_t d2tk_core_t;
 typedef struct _d2tk_core_driver_t d2tk_core_driver_t;
+typedef struct _d2tk_core_cache_stats_t d2tk_core_cache_stats_t;
+typedef struct _d2tk_core_pass_stats_t d2tk_core_pass_stats_t;
+typedef struct _d2tk_core_mem_stats_t d2tk_core_mem_stats_t;
+typedef struct _d2tk_core_stats_t d2tk_core_stats_t;
 typedef void (*d2tk_core_custom_t)(void *ctx, const d2tk_rect_t *rect,
 	const void *data);
 
@@ -62,6 +66,50 @@ struct _d2tk_point_t {
 	d2tk_coord_t y;
 };
 
+struct _d2tk_core_cache_stats_t {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+	uint32_t entries; // alive at end of frame
+};
+
+// command buffer, grows and shrinks are totals since creation
+struct _d2tk_core_mem_stats_t {
+	uint32_t size;
+	uint32_t high_water; // of recent frames
+	uint32_t cleared; // bytes
+	uint32_t grows;
+	uint32_t shrinks;
+};
+
+// driver time in ns
+struct _d2tk_core_pass_stats_t {
+	uint64_t pre;
+	uint64_t process;
+	uint64_t post;
+};
+
+// counters and timings of the most recent d2tk_core_pre/post cycle
+struct _d2tk_core_stats_t {
+	uint64_t frame;
+	uint32_t commands;
+	uint32_t bytes;
+	d2tk_core_mem_stats_t mem;
+	bool full_refresh;
+	uint32_t matched;
+	uint32_t appeared;
+	uint32_t disappeared;
+	uint32_t dirty_rects;
+	uint64_t dirty_area; // in px^2
+	d2tk_core_cache_stats_t sprites;
+	d2tk_core_cache_stats_t memcaches;
+	d2tk_core_cache_stats_t extents;
+	uint64_t build; // ns between d2tk_core_pre and d2tk_core_post
+	uint64_t diff; // ns
+	d2tk_core_pass_stats_t pass [2];
+	uint64_t end; // ns
+};
+
 #define D2TK_RECT(X, Y, W, H) \
 	((d2tk_rect_t){ .x = (X), .y = (Y), .w = (W), .h = (H) })
 
@@ -212,6 +260,9 @@ d2tk_core_get_dimensions(d2tk_core_t *core, d2tk_coord_t *w, d2tk_coord_t *h);
 D2TK_API void
 d2tk_core_set_full_refresh(d2tk_core_t *core);
 
+D2TK_API const d2tk_core_stats_t *
+d2tk_core_get_stats(d2tk_core_t *core);
+
 D2TK_API int
 d2tk_core_text_extent(d2tk_core_t *core, size_t len, const char *buf,
 	d2tk_coord_t h);
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2018-2019 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#ifndef _D2TK_FRONTEND_OFFSCREEN_H
+#define _D2TK_FRONTEND_OFFSCREEN_H
+
+#include <signal.h>
+
+#include <d2tk/base.h>
+#include <d2tk/frontend.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _d2tk_offscreen_config_t d2tk_offscreen_config_t;
+typedef struct _d2tk_offscreen_timing_t d2tk_offscreen_timing_t;
+
+struct _d2tk_offscreen_config_t {
+	d2tk_coord_t w;
+	d2tk_coord_t h;
+	const char *bundle_path;
+	d2tk_frontend_expose_t expose;
+	void *data;
+};
+
+// wall clock time spent in expose, pre and post included
+struct _d2tk_offscreen_timing_t {
+	uint64_t frames;
+	uint64_t last_ns;
+	uint64_t min_ns;
+	uint64_t max_ns;
+	uint64_t sum_ns;
+};
+
+// renders into memory, every d2tk_frontend_step/poll renders one frame,
+// synthetic input goes through the d2tk_base_set_* API on
+// d2tk_frontend_get_base before stepping
+D2TK_API d2tk_frontend_t *
+d2tk_offscreen_new(const d2tk_offscreen_config_t *config);
+
+// premultiplied, native endian 0xAARRGGBB
+D2TK_API const uint32_t *
+d2tk_offscreen_get_pixels(d2tk_frontend_t *doff, size_t *stride);
+
+D2TK_API const d2tk_offscreen_timing_t *
+d2tk_offscreen_get_timing(d2tk_frontend_t *doff);
+
+D2TK_API void
+d2tk_offscreen_reset_timing(d2tk_frontend_t *doff);
+
+D2TK_API int
+d2tk_offscreen_dump_png(d2tk_frontend_t *doff, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _D2TK_FRONTEND_OFFSCREEN_H
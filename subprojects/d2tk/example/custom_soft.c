@@ -0,0 +1,45 @@
+#include <stdint.h>
+
+#include <d2tk/core.h>
+#include <d2tk/backend_soft.h>
+
+static void
+_draw_custom(void *_ctx, const d2tk_rect_t *rect, const void *data)
+{
+	d2tk_soft_target_t *target = _ctx;
+	(void)data;
+
+	d2tk_rect_t bnd = *rect;
+	bnd.x += bnd.w/4;
+	bnd.y += bnd.h/4;
+	bnd.w /= 2;
+	bnd.h /= 2;
+
+	// 50% white, premultiplied
+	static const uint32_t src = 0x7f7f7f7f;
+
+	for(d2tk_coord_t y = bnd.y; y < bnd.y + bnd.h; y++)
+	{
+		if( (y < 0) || (y >= target->h) )
+		{
+			continue;
+		}
+
+		uint32_t *row = (uint32_t *)((uint8_t *)target->argb + y*target->stride);
+
+		for(d2tk_coord_t x = bnd.x; x < bnd.x + bnd.w; x++)
+		{
+			if( (x < 0) || (x >= target->w) )
+			{
+				continue;
+			}
+
+			const uint32_t dst = row[x];
+
+			// dst*(1 - 0.5) + src, per channel
+			row[x] = ( (dst >> 1) & 0x7f7f7f7f) + src;
+		}
+	}
+}
+
+d2tk_core_custom_t draw_custom = _draw_custom;
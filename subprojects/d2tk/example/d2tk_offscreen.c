@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2018-2019 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+
+#include <d2tk/frontend_offscreen.h>
+#include "example/example.h"
+
+typedef struct _app_t app_t;
+
+struct _app_t {
+	d2tk_frontend_t *doff;
+};
+
+static inline int
+_expose(void *data, d2tk_coord_t w, d2tk_coord_t h)
+{
+	app_t *app = data;
+	d2tk_frontend_t *doff = app->doff;
+	d2tk_base_t *base = d2tk_frontend_get_base(doff);
+
+	d2tk_example_run(doff, base, w, h);
+
+	return EXIT_SUCCESS;
+}
+
+// sweep the mouse diagonally and click every 16th frame
+static void
+_input(d2tk_base_t *base, d2tk_coord_t w, d2tk_coord_t h, unsigned frame,
+	unsigned nframes)
+{
+	const d2tk_coord_t x = (int64_t)w * frame / nframes;
+	const d2tk_coord_t y = (int64_t)h * frame / nframes;
+
+	d2tk_base_set_mouse_pos(base, x, y);
+	d2tk_base_set_butmask(base, D2TK_BUTMASK_LEFT, (frame % 16) == 15);
+}
+
+int
+main(int argc, char **argv)
+{
+	static app_t app;
+	d2tk_coord_t w = 1280;
+	d2tk_coord_t h = 720;
+	unsigned nframes = 100;
+	const char *png = NULL;
+
+	int c;
+	while( (c = getopt(argc, argv, "w:h:n:o:")) != -1)
+	{
+		switch(c)
+		{
+			case 'w':
+			{
+				w = atoi(optarg);
+			} break;
+			case 'h':
+			{
+				h = atoi(optarg);
+			} break;
+			case 'n':
+			{
+				nframes = atoi(optarg);
+			} break;
+			case 'o':
+			{
+				png = optarg;
+			} break;
+
+			default:
+			{
+				fprintf(stderr, "Usage: %s\n"
+					"  -w  width        (1280)\n"
+					"  -h  height       (720)\n"
+					"  -n  frames       (100)\n"
+					"  -o  png_path     dump last frame\n\n",
+					argv[0]);
+			} return EXIT_FAILURE;
+		}
+	}
+
+	if( (w <= 0) || (h <= 0) || (nframes == 0) )
+	{
+		return EXIT_FAILURE;
+	}
+
+	const d2tk_offscreen_config_t config = {
+		.w = w,
+		.h = h,
+		.bundle_path = "./",
+		.expose = _expose,
+		.data = &app
+	};
+
+	app.doff = d2tk_offscreen_new(&config);
+	if(!app.doff)
+	{
+		return EXIT_FAILURE;
+	}
+
+	d2tk_base_t *base = d2tk_frontend_get_base(app.doff);
+
+	d2tk_example_init();
+
+	for(unsigned i = 0; i < nframes; i++)
+	{
+		_input(base, w, h, i, nframes);
+
+		d2tk_frontend_step(app.doff);
+	}
+
+	const d2tk_offscreen_timing_t *timing = d2tk_offscreen_get_timing(app.doff);
+
+	fprintf(stdout, "%"PRIu64" frames, %.2f/%.2f/%.2f us/frame min/avg/max\n",
+		timing->frames,
+		timing->min_ns / 1e3,
+		timing->sum_ns / 1e3 / timing->frames,
+		timing->max_ns / 1e3);
+
+	int ret = EXIT_SUCCESS;
+
+	if(png && d2tk_offscreen_dump_png(app.doff, png))
+	{
+		ret = EXIT_FAILURE;
+	}
+
+	d2tk_frontend_free(app.doff);
+
+	d2tk_example_deinit();
+
+	return ret;
+}
@@ -466,6 +466,7 @@ _render_c_seq(d2tk_base_t *base, const d2tk_rect_t *rect)
 					clone = true;
 
 					style.fill_color[D2TK_TRIPLE_ACTIVE] = 0x9f00cfff;
+					d2tk_base_set_style(base, &style);
 					break;
 				}
 			}
@@ -473,7 +474,11 @@ _render_c_seq(d2tk_base_t *base, const d2tk_rect_t *rect)
 
 		const d2tk_state_t state = d2tk_base_toggle(base, id, bnd, &clone);
 
-		style.fill_color[D2TK_TRIPLE_ACTIVE] = col_active;
+		if(style.fill_color[D2TK_TRIPLE_ACTIVE] != col_active)
+		{
+			style.fill_color[D2TK_TRIPLE_ACTIVE] = col_active;
+			d2tk_base_set_style(base, &style);
+		}
 
 		if(d2tk_state_is_changed(state))
 		{
@@ -609,6 +614,7 @@ _render_c_scroll(d2tk_base_t *base, const d2tk_rect_t *rect)
 					{
 						style.fill_color[D2TK_TRIPLE_NONE] = 0x3f3f3fff;
 					}
+					d2tk_base_set_style(base, &style);
 
 					char lbl [32];
 					const size_t lbl_len = snprintf(lbl, sizeof(lbl), "%u-%03u", j, k);
@@ -1349,6 +1355,7 @@ _render_c_browser(d2tk_base_t *base, const d2tk_rect_t *rect)
 						style.fill_color[D2TK_TRIPLE_NONE] = k % 2
 							? 0x4f4f4fff
 							: 0x3f3f3fff;
+						d2tk_base_set_style(base, &style);
 
 						const char *icon = "libre-gui-folder.png";
 
@@ -1391,6 +1398,7 @@ _render_c_browser(d2tk_base_t *base, const d2tk_rect_t *rect)
 						style.fill_color[D2TK_TRIPLE_NONE] = k % 2
 							? 0x4f4f4fff
 							: 0x3f3f3fff;
+						d2tk_base_set_style(base, &style);
 
 						struct dirent *itm = &list[k];
 						const bool is_dir = (itm->d_type == DT_DIR);
@@ -18,7 +18,11 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include <cairo.h>
 #include <cairo-ft.h>
@@ -43,8 +47,43 @@ typedef enum _sprite_type_t {
 	SPRITE_TYPE_FONT = 2
 } sprite_type_t;
 
+#define D2TK_CAIRO_THREADS_MAX 16
+#define D2TK_CAIRO_TILE_SIZE 128 // px
+
+typedef struct _d2tk_cairo_job_t d2tk_cairo_job_t;
+typedef struct _d2tk_cairo_pool_t d2tk_cairo_pool_t;
 typedef struct _d2tk_backend_cairo_t d2tk_backend_cairo_t;
 
+struct _d2tk_cairo_job_t {
+	const d2tk_com_t *com;
+	d2tk_coord_t xo;
+	d2tk_coord_t yo;
+	d2tk_clip_t clip;
+	bool clipped;
+};
+
+struct _d2tk_cairo_pool_t {
+	pthread_t threads [D2TK_CAIRO_THREADS_MAX];
+	unsigned nthreads;
+	pthread_mutex_t lock; // guards sprite lookups and custom callbacks
+	pthread_mutex_t mutex;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	uint64_t seq;
+	unsigned busy;
+	bool quit;
+	d2tk_core_t *core;
+	d2tk_cairo_job_t *jobs;
+	size_t njobs;
+	size_t maxjobs;
+	d2tk_rect_t *tiles;
+	size_t ntiles;
+	size_t maxtiles;
+	atomic_size_t next;
+	uint8_t *data;
+	int stride;
+};
+
 struct _d2tk_backend_cairo_t {
 	cairo_t *pctx;
 	cairo_t *ctx;
@@ -54,13 +93,316 @@ struct _d2tk_backend_cairo_t {
 	d2tk_coord_t w;
 	d2tk_coord_t h;
 	cairo_surface_t *surf;
+	d2tk_cairo_pool_t *pool;
+	pthread_mutex_t *lock; // set on worker copies only
 };
 
+static inline void
+_d2tk_cairo_process(d2tk_backend_cairo_t *backend, d2tk_core_t *core,
+	const d2tk_com_t *com, d2tk_coord_t xo, d2tk_coord_t yo,
+	const d2tk_clip_t *clip, unsigned pass);
+
+static inline void
+_d2tk_cairo_lock(d2tk_backend_cairo_t *backend)
+{
+	if(backend->lock)
+	{
+		pthread_mutex_lock(backend->lock);
+	}
+}
+
+static inline void
+_d2tk_cairo_unlock(d2tk_backend_cairo_t *backend)
+{
+	if(backend->lock)
+	{
+		pthread_mutex_unlock(backend->lock);
+	}
+}
+
+static inline bool
+_d2tk_cairo_overlap(const d2tk_clip_t *clip, const d2tk_rect_t *rect)
+{
+	return (clip->x0 < rect->x + rect->w) && (rect->x < clip->x1)
+		&& (clip->y0 < rect->y + rect->h) && (rect->y < clip->y1);
+}
+
+// render recorded bboxes into tiles until there are none left
+static void
+_d2tk_cairo_pool_render(d2tk_backend_cairo_t *backend)
+{
+	d2tk_cairo_pool_t *pool = backend->pool;
+
+	for(size_t t = atomic_fetch_add(&pool->next, 1);
+		t < pool->ntiles;
+		t = atomic_fetch_add(&pool->next, 1))
+	{
+		const d2tk_rect_t *tile = &pool->tiles[t];
+
+		// tile surfaces alias disjoint regions of the target surface
+		cairo_surface_t *surf = cairo_image_surface_create_for_data(
+			&pool->data[tile->y*pool->stride + tile->x*sizeof(uint32_t)],
+			CAIRO_FORMAT_ARGB32, tile->w, tile->h, pool->stride);
+
+		d2tk_backend_cairo_t backend2 = *backend;
+		backend2.ctx = cairo_create(surf);
+		backend2.pat = NULL;
+		backend2.lock = &pool->lock;
+
+		cairo_translate(backend2.ctx, -tile->x, -tile->y);
+
+		for(size_t j = 0; j < pool->njobs; j++)
+		{
+			const d2tk_cairo_job_t *job = &pool->jobs[j];
+
+			if(!_d2tk_cairo_overlap(&job->com->body->bbox.clip, tile))
+			{
+				continue;
+			}
+
+			_d2tk_cairo_process(&backend2, pool->core, job->com, job->xo, job->yo,
+				job->clipped ? &job->clip : NULL, 1);
+		}
+
+		cairo_destroy(backend2.ctx);
+		cairo_surface_finish(surf);
+		cairo_surface_destroy(surf);
+	}
+}
+
+static void *
+_d2tk_cairo_pool_thread(void *data)
+{
+	d2tk_backend_cairo_t *backend = data;
+	d2tk_cairo_pool_t *pool = backend->pool;
+	uint64_t seq = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	while(true)
+	{
+		while(!pool->quit && (pool->seq == seq) )
+		{
+			pthread_cond_wait(&pool->work, &pool->mutex);
+		}
+
+		if(pool->quit)
+		{
+			break;
+		}
+
+		seq = pool->seq;
+		pthread_mutex_unlock(&pool->mutex);
+
+		_d2tk_cairo_pool_render(backend);
+
+		pthread_mutex_lock(&pool->mutex);
+
+		if(--pool->busy == 0)
+		{
+			pthread_cond_signal(&pool->done);
+		}
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+static void
+_d2tk_cairo_pool_free(d2tk_backend_cairo_t *backend)
+{
+	d2tk_cairo_pool_t *pool = backend->pool;
+
+	if(!pool)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for(unsigned i = 0; i < pool->nthreads; i++)
+	{
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_mutex_destroy(&pool->lock);
+
+	free(pool->jobs);
+	free(pool->tiles);
+	free(pool);
+
+	backend->pool = NULL;
+}
+
+// D2TK_CAIRO_THREADS=n renders with the UI thread plus n-1 workers
+static void
+_d2tk_cairo_pool_new(d2tk_backend_cairo_t *backend)
+{
+	const char *D2TK_CAIRO_THREADS = getenv("D2TK_CAIRO_THREADS");
+	const int nthreads = D2TK_CAIRO_THREADS ? atoi(D2TK_CAIRO_THREADS) - 1 : 0;
+
+	if(nthreads <= 0)
+	{
+		return;
+	}
+
+	d2tk_cairo_pool_t *pool = calloc(1, sizeof(d2tk_cairo_pool_t));
+	if(!pool)
+	{
+		fprintf(stderr, "calloc failed\n");
+		return;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	atomic_init(&pool->next, 0);
+
+	backend->pool = pool;
+
+	for(int i = 0; (i < nthreads) && (i < D2TK_CAIRO_THREADS_MAX); i++)
+	{
+		if(pthread_create(&pool->threads[i], NULL, _d2tk_cairo_pool_thread,
+			backend) != 0)
+		{
+			fprintf(stderr, "[%s] pthread_create failed: '%s'\n", __func__,
+				strerror(errno));
+			break;
+		}
+
+		pool->nthreads++;
+	}
+
+	if(pool->nthreads == 0)
+	{
+		_d2tk_cairo_pool_free(backend);
+	}
+}
+
+// record top-level bboxes to be replayed per tile in post
+static inline void
+_d2tk_cairo_pool_push(d2tk_cairo_pool_t *pool, const d2tk_com_t *com,
+	d2tk_coord_t xo, d2tk_coord_t yo, const d2tk_clip_t *clip)
+{
+	if(pool->njobs == pool->maxjobs)
+	{
+		pool->maxjobs = pool->maxjobs
+			? pool->maxjobs << 1
+			: 64;
+		pool->jobs = realloc(pool->jobs, pool->maxjobs*sizeof(d2tk_cairo_job_t));
+		assert(pool->jobs);
+	}
+
+	d2tk_cairo_job_t *job = &pool->jobs[pool->njobs++];
+
+	job->com = com;
+	job->xo = xo;
+	job->yo = yo;
+	job->clipped = clip != NULL;
+
+	if(clip)
+	{
+		job->clip = *clip;
+	}
+}
+
+static inline void
+_d2tk_cairo_pool_tile(d2tk_cairo_pool_t *pool, const d2tk_rect_t *rect)
+{
+	for(d2tk_coord_t y = rect->y; y < rect->y + rect->h; y += D2TK_CAIRO_TILE_SIZE)
+	{
+		for(d2tk_coord_t x = rect->x; x < rect->x + rect->w; x += D2TK_CAIRO_TILE_SIZE)
+		{
+			if(pool->ntiles == pool->maxtiles)
+			{
+				pool->maxtiles = pool->maxtiles
+					? pool->maxtiles << 1
+					: 64;
+				pool->tiles = realloc(pool->tiles, pool->maxtiles*sizeof(d2tk_rect_t));
+				assert(pool->tiles);
+			}
+
+			d2tk_rect_t *tile = &pool->tiles[pool->ntiles++];
+
+			tile->x = x;
+			tile->y = y;
+			tile->w = rect->x + rect->w - x;
+			tile->h = rect->y + rect->h - y;
+
+			if(tile->w > D2TK_CAIRO_TILE_SIZE)
+			{
+				tile->w = D2TK_CAIRO_TILE_SIZE;
+			}
+
+			if(tile->h > D2TK_CAIRO_TILE_SIZE)
+			{
+				tile->h = D2TK_CAIRO_TILE_SIZE;
+			}
+		}
+	}
+}
+
+// split dirty area into tiles and render them on all threads
+static void
+_d2tk_cairo_pool_run(d2tk_backend_cairo_t *backend, d2tk_core_t *core)
+{
+	d2tk_cairo_pool_t *pool = backend->pool;
+
+	size_t nrects;
+	const d2tk_rect_t *rects = d2tk_core_get_dirty_rects(core, &nrects, NULL);
+
+	pool->ntiles = 0;
+	for(size_t i = 0; i < nrects; i++)
+	{
+		_d2tk_cairo_pool_tile(pool, &rects[i]);
+	}
+
+	if(pool->njobs && pool->ntiles)
+	{
+		cairo_surface_flush(backend->surf);
+
+		pool->core = core;
+		pool->data = cairo_image_surface_get_data(backend->surf);
+		pool->stride = cairo_image_surface_get_stride(backend->surf);
+		atomic_store(&pool->next, 0);
+
+		pthread_mutex_lock(&pool->mutex);
+		pool->busy = pool->nthreads;
+		pool->seq++;
+		pthread_cond_broadcast(&pool->work);
+		pthread_mutex_unlock(&pool->mutex);
+
+		// lend a hand
+		_d2tk_cairo_pool_render(backend);
+
+		pthread_mutex_lock(&pool->mutex);
+		while(pool->busy)
+		{
+			pthread_cond_wait(&pool->done, &pool->mutex);
+		}
+		pthread_mutex_unlock(&pool->mutex);
+
+		cairo_surface_mark_dirty(backend->surf);
+	}
+
+	pool->njobs = 0;
+}
+
 static void
 d2tk_cairo_free(void *data)
 {
 	d2tk_backend_cairo_t *backend = data;
 
+	_d2tk_cairo_pool_free(backend);
+
 	if(backend->surf)
 	{
 		cairo_surface_destroy(backend->surf);
@@ -89,6 +431,8 @@ d2tk_cairo_new(const char *bundle_path)
 	backend->bundle_path = strdup(bundle_path);
 	FT_Init_FreeType(&backend->library);
 
+	_d2tk_cairo_pool_new(backend);
+
 	return backend;
 }
 
@@ -148,22 +492,25 @@ d2tk_cairo_pre(void *data, d2tk_core_t *core __attribute((unused)),
 	cairo_save(ctx);
 
 	{
-		d2tk_rect_t rect;
-		uint32_t *pixels = d2tk_core_get_pixels(core, &rect);
+		size_t nrects;
+		const d2tk_rect_t *rects = d2tk_core_get_dirty_rects(core, &nrects, NULL);
+		const uint32_t rgba = d2tk_core_get_bg_color(core);
 
-		cairo_surface_t *surf = cairo_image_surface_create_for_data(
-			(uint8_t *)pixels, CAIRO_FORMAT_ARGB32, w, h, w*sizeof(uint32_t));
-		//FIXME reuse/update surfaces
+		const float r = ( (rgba >> 24) & 0xff) * 0x1p-8;
+		const float g = ( (rgba >> 16) & 0xff) * 0x1p-8;
+		const float b = ( (rgba >>  8) & 0xff) * 0x1p-8;
+		const float a = ( (rgba >>  0) & 0xff) * 0x1p-8;
 
-		cairo_rectangle(ctx, rect.x, rect.y, rect.w, rect.h);
+		// scissor to dirty tiles and clear them to background
+		for(size_t i = 0; i < nrects; i++)
+		{
+			cairo_rectangle(ctx, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+		}
 		cairo_clip(ctx);
 
 		cairo_new_sub_path(ctx);
-		cairo_set_source_surface(ctx, surf, 0, 0);
+		cairo_set_source_rgba(ctx, r, g, b, a);
 		cairo_paint(ctx);
-
-		cairo_surface_finish(surf);
-		cairo_surface_destroy(surf);
 	}
 }
 
@@ -180,36 +527,25 @@ d2tk_cairo_post(void *data, d2tk_core_t *core __attribute__((unused)),
 		return true; // do enter 2nd pass
 	}
 
+	if(backend->pool)
+	{
+		_d2tk_cairo_pool_run(backend, core);
+	}
+
 #if D2TK_DEBUG //FIXME needs multiple buffers to work
 	{
-		d2tk_rect_t rect;
-		uint32_t *pixels = d2tk_core_get_pixels(core, &rect);
+		size_t nrects;
+		const d2tk_rect_t *rects = d2tk_core_get_dirty_rects(core, &nrects, NULL);
 
-		// brighten up the pixels for proper hilighting
-		for(d2tk_coord_t y = 0, Y = 0; y < h; y++, Y+=w)
+		// hilight dirty tiles
+		cairo_reset_clip(ctx);
+		cairo_new_path(ctx);
+		for(size_t i = 0; i < nrects; i++)
 		{
-			for(d2tk_coord_t x = 0; x < w; x++)
-			{
-				if(pixels[Y + x])
-				{
-					pixels[Y + x] = 0x5f005f5f; // premultiplied ARGB
-				}
-			}
+			cairo_rectangle(ctx, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
 		}
-
-		cairo_surface_t *surf = cairo_image_surface_create_for_data(
-			(uint8_t *)pixels, CAIRO_FORMAT_ARGB32, w, h, w*sizeof(uint32_t));
-		//FIXME reuse/update surface
-
-		cairo_rectangle(ctx, 0, 0, w, h);
-		cairo_clip(ctx);
-
-		cairo_new_sub_path(ctx);
-		cairo_set_source_surface(ctx, surf, 0, 0);
-		cairo_paint(ctx);
-
-		cairo_surface_finish(surf);
-		cairo_surface_destroy(surf);
+		cairo_set_source_rgba(ctx, 0.f, 1.f, 1.f, 0x5f * 0x1p-8);
+		cairo_fill(ctx);
 	}
 #endif
 
@@ -405,10 +741,10 @@ _absolute_path(d2tk_backend_cairo_t *backend, const char *rel)
 }
 
 static inline void
-d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
-	d2tk_coord_t xo, d2tk_coord_t yo, const d2tk_clip_t *clip, unsigned pass)
+_d2tk_cairo_process(d2tk_backend_cairo_t *backend, d2tk_core_t *core,
+	const d2tk_com_t *com, d2tk_coord_t xo, d2tk_coord_t yo,
+	const d2tk_clip_t *clip, unsigned pass)
 {
-	d2tk_backend_cairo_t *backend = data;
 	cairo_t *ctx = backend->ctx;
 
 	const d2tk_instr_t instr = com->instr;
@@ -585,7 +921,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 
 						D2TK_COM_FOREACH_CONST(com, bbox)
 						{
-							d2tk_cairo_process(&backend2, core, bbox, 0, 0, clip, pass);
+							_d2tk_cairo_process(&backend2, core, bbox, 0, 0, clip, pass);
 						}
 
 						cairo_surface_flush(surf);
@@ -605,7 +941,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 					// render directly
 					D2TK_COM_FOREACH_CONST(com, bbox)
 					{
-						d2tk_cairo_process(backend, core, bbox, body->clip.x0, body->clip.y0, clip, pass);
+						_d2tk_cairo_process(backend, core, bbox, body->clip.x0, body->clip.y0, clip, pass);
 					}
 				}
 			}
@@ -620,7 +956,9 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 
 				if(body->cached)
 				{
+					_d2tk_cairo_lock(backend);
 					uintptr_t *sprite = d2tk_core_get_sprite(core, body->hash, SPRITE_TYPE_SURF);
+					_d2tk_cairo_unlock(backend);
 					assert(sprite && *sprite);
 
 					cairo_surface_t *surf = (cairo_surface_t *)*sprite;
@@ -636,7 +974,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 					// render directly
 					D2TK_COM_FOREACH_CONST(com, bbox)
 					{
-						d2tk_cairo_process(backend, core, bbox, body->clip.x0, body->clip.y0, clip, pass);
+						_d2tk_cairo_process(backend, core, bbox, body->clip.x0, body->clip.y0, clip, pass);
 					}
 				}
 
@@ -667,6 +1005,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 			const d2tk_body_font_face_t *body = &com->body->font_face;
 
 			const uint64_t hash = d2tk_hash(body->face, strlen(body->face));
+			_d2tk_cairo_lock(backend);
 			uintptr_t *sprite = d2tk_core_get_sprite(core, hash, SPRITE_TYPE_FONT);
 			assert(sprite);
 
@@ -681,6 +1020,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 				if(ft_face == NULL)
 				{
 					fprintf(stderr, "FT_New_Face failed on '%s'\n", ft_path);
+					_d2tk_cairo_unlock(backend);
 					break;
 				}
 
@@ -690,6 +1030,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 
 				*sprite = (uintptr_t)face;
 			}
+			_d2tk_cairo_unlock(backend);
 
 			cairo_font_face_t *face = (cairo_font_face_t *)*sprite;
 			assert(face);
@@ -750,6 +1091,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 			const d2tk_body_image_t *body = &com->body->image;
 
 			const uint64_t hash = d2tk_hash(body->path, strlen(body->path));
+			_d2tk_cairo_lock(backend);
 			uintptr_t *sprite = d2tk_core_get_sprite(core, hash, SPRITE_TYPE_SURF);
 			assert(sprite);
 
@@ -798,6 +1140,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 
 				free(img_path);
 			}
+			_d2tk_cairo_unlock(backend);
 
 			cairo_surface_t *surf = (cairo_surface_t *)*sprite;
 			assert(surf);
@@ -810,6 +1153,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 			const d2tk_body_bitmap_t *body = &com->body->bitmap;
 
 			const uint64_t hash = d2tk_hash(&body->surf, sizeof(body->surf));
+			_d2tk_cairo_lock(backend);
 			uintptr_t *sprite = d2tk_core_get_sprite(core, hash, SPRITE_TYPE_SURF);
 			assert(sprite);
 
@@ -821,6 +1165,7 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 
 				*sprite = (uintptr_t)surf;
 			}
+			_d2tk_cairo_unlock(backend);
 
 			cairo_surface_t *surf = (cairo_surface_t *)*sprite;
 			assert(surf);
@@ -832,10 +1177,13 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 		{
 			const d2tk_body_custom_t *body = &com->body->custom;
 
+			// user callbacks need not be reentrant
+			_d2tk_cairo_lock(backend);
 			cairo_save(ctx);
 			body->custom(ctx, &D2TK_RECT(body->x + xo, body->y + yo, body->w, body->h),
 				body->data);
 			cairo_restore(ctx);
+			_d2tk_cairo_unlock(backend);
 		} break;
 		case D2TK_INSTR_STROKE_WIDTH:
 		{
@@ -850,6 +1198,21 @@ d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 	}
 }
 
+static inline void
+d2tk_cairo_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
+	d2tk_coord_t xo, d2tk_coord_t yo, const d2tk_clip_t *clip, unsigned pass)
+{
+	d2tk_backend_cairo_t *backend = data;
+
+	if(backend->pool && (pass == 1) )
+	{
+		_d2tk_cairo_pool_push(backend->pool, com, xo, yo, clip);
+		return;
+	}
+
+	_d2tk_cairo_process(backend, core, com, xo, yo, clip, pass);
+}
+
 const d2tk_core_driver_t d2tk_core_driver = {
 	.new = d2tk_cairo_new,
 	.free = d2tk_cairo_free,
@@ -18,6 +18,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <sys/stat.h>
 
@@ -28,6 +29,13 @@
 #	include <OpenGL/glext.h>
 #else
 #	include <GL/glew.h>
+#	if !defined(_WIN32)
+#		include <GL/glx.h>
+#	endif
+#endif
+
+#if !defined(GLX_BACK_BUFFER_AGE_EXT)
+#	define GLX_BACK_BUFFER_AGE_EXT 0x20F4
 #endif
 
 #define NANOVG_GLES3_IMPLEMENTATION
@@ -55,47 +63,388 @@
 #include <d2tk/backend.h>
 #include <d2tk/hash.h>
 
-#define D2TK_BACKEND_NANOVG_FBO_MAX 2
+#define D2TK_BACKEND_NANOVG_AGE_MAX 4
+#define D2TK_BACKEND_NANOVG_ATLAS_MAX 8
+#define D2TK_BACKEND_NANOVG_ATLAS_SIZE 1024
+#define D2TK_BACKEND_NANOVG_ATLAS_SPRITE 256 // larger sprites get their own FBO
+#define D2TK_BACKEND_NANOVG_SHELF_ALIGN 8
 
 typedef enum _sprite_type_t {
 	SPRITE_TYPE_NONE = 0,
-	SPRITE_TYPE_FBO  = 1,
+	SPRITE_TYPE_BBOX = 1,
 	SPRITE_TYPE_IMG  = 2,
 	SPRITE_TYPE_FONT = 3
 } sprite_type_t;
 
+typedef struct _d2tk_nanovg_sprite_t d2tk_nanovg_sprite_t;
+typedef struct _d2tk_nanovg_shelf_t d2tk_nanovg_shelf_t;
+typedef struct _d2tk_nanovg_atlas_t d2tk_nanovg_atlas_t;
+typedef struct _d2tk_nanovg_batch_t d2tk_nanovg_batch_t;
 typedef struct _d2tk_backend_nanovg_t d2tk_backend_nanovg_t;
 
+struct _d2tk_nanovg_sprite_t {
+	d2tk_nanovg_sprite_t *next; // in free list of shelf
+	d2tk_nanovg_atlas_t *atlas; // NULL if sprite has its own FBO
+	NVGLUframebuffer *fbo;
+	unsigned shelf;
+	d2tk_coord_t x;
+	d2tk_coord_t y;
+	d2tk_coord_t w;
+};
+
+struct _d2tk_nanovg_shelf_t {
+	d2tk_nanovg_sprite_t *free;
+	d2tk_coord_t y;
+	d2tk_coord_t h;
+	d2tk_coord_t x;
+	unsigned used;
+};
+
+struct _d2tk_nanovg_atlas_t {
+	NVGLUframebuffer *fbo;
+	d2tk_nanovg_shelf_t *shelves;
+	unsigned nshelves;
+	d2tk_coord_t y;
+};
+
+struct _d2tk_nanovg_batch_t {
+	d2tk_nanovg_atlas_t *atlas;
+	NVGvertex *verts;
+	int nverts;
+	int maxverts;
+};
+
 struct _d2tk_backend_nanovg_t {
 	NVGcontext *ctx;
 	char *bundle_path;
-	NVGLUframebuffer *fbo [D2TK_BACKEND_NANOVG_FBO_MAX];
-	bool fbop;
+	NVGLUframebuffer *fbo;
+	d2tk_rect_t damage [D2TK_BACKEND_NANOVG_AGE_MAX];
+	bool age_probed;
+	bool has_age;
 	d2tk_coord_t w;
 	d2tk_coord_t h;
-	int mask;
+	d2tk_nanovg_atlas_t atlas [D2TK_BACKEND_NANOVG_ATLAS_MAX];
+	unsigned natlas;
+	d2tk_nanovg_atlas_t *target; // atlas currently rendered to
+	const d2tk_rect_t *slot; // sprite currently rendered to
+	d2tk_nanovg_batch_t batch;
 };
 
+static inline void
+_d2tk_nanovg_atlas_end(d2tk_backend_nanovg_t *backend)
+{
+	if(!backend->target)
+	{
+		return;
+	}
+
+	nvgEndFrame(backend->ctx);
+	nvgluBindFramebuffer(NULL);
+
+	backend->target = NULL;
+}
+
+static inline void
+_d2tk_nanovg_atlas_begin(d2tk_backend_nanovg_t *backend,
+	d2tk_nanovg_atlas_t *atlas)
+{
+	if(backend->target == atlas)
+	{
+		return;
+	}
+
+	_d2tk_nanovg_atlas_end(backend);
+
+	nvgluBindFramebuffer(atlas->fbo);
+
+	glViewport(0, 0, D2TK_BACKEND_NANOVG_ATLAS_SIZE, D2TK_BACKEND_NANOVG_ATLAS_SIZE);
+
+	nvgBeginFrame(backend->ctx, D2TK_BACKEND_NANOVG_ATLAS_SIZE,
+		D2TK_BACKEND_NANOVG_ATLAS_SIZE, 1.f);
+
+	backend->target = atlas;
+}
+
+static inline void
+_d2tk_nanovg_shelf_reset(d2tk_nanovg_shelf_t *shelf)
+{
+	for(d2tk_nanovg_sprite_t *sprite = shelf->free, *next; sprite; sprite = next)
+	{
+		next = sprite->next;
+
+		free(sprite);
+	}
+
+	shelf->free = NULL;
+	shelf->x = 0;
+}
+
+static inline d2tk_nanovg_sprite_t *
+_d2tk_nanovg_shelf_alloc(d2tk_nanovg_atlas_t *atlas, unsigned s, d2tk_coord_t w)
+{
+	d2tk_nanovg_shelf_t *shelf = &atlas->shelves[s];
+
+	// reuse first freed slot wide enough
+	for(d2tk_nanovg_sprite_t **ref = &shelf->free; *ref; ref = &(*ref)->next)
+	{
+		d2tk_nanovg_sprite_t *sprite = *ref;
+
+		if(sprite->w >= w)
+		{
+			*ref = sprite->next;
+			sprite->next = NULL;
+			shelf->used++;
+
+			return sprite;
+		}
+	}
+
+	if(shelf->x + w > D2TK_BACKEND_NANOVG_ATLAS_SIZE)
+	{
+		return NULL;
+	}
+
+	d2tk_nanovg_sprite_t *sprite = calloc(1, sizeof(d2tk_nanovg_sprite_t));
+	if(!sprite)
+	{
+		return NULL;
+	}
+
+	sprite->atlas = atlas;
+	sprite->shelf = s;
+	sprite->x = shelf->x;
+	sprite->y = shelf->y;
+	sprite->w = w;
+
+	shelf->x += w;
+	shelf->used++;
+
+	return sprite;
+}
+
+static inline d2tk_nanovg_sprite_t *
+_d2tk_nanovg_atlas_alloc(d2tk_backend_nanovg_t *backend, d2tk_coord_t w,
+	d2tk_coord_t h)
+{
+	// round up to limit number of distinct shelf heights
+	const d2tk_coord_t sh = (h + D2TK_BACKEND_NANOVG_SHELF_ALIGN - 1)
+		& ~(D2TK_BACKEND_NANOVG_SHELF_ALIGN - 1);
+
+	for(unsigned a = 0; a < D2TK_BACKEND_NANOVG_ATLAS_MAX; a++)
+	{
+		d2tk_nanovg_atlas_t *atlas = &backend->atlas[a];
+
+		if(a == backend->natlas) // create new atlas
+		{
+			_d2tk_nanovg_atlas_end(backend);
+
+			atlas->fbo = nvgluCreateFramebuffer(backend->ctx,
+				D2TK_BACKEND_NANOVG_ATLAS_SIZE, D2TK_BACKEND_NANOVG_ATLAS_SIZE,
+				NVG_IMAGE_NEAREST);
+			if(!atlas->fbo)
+			{
+				return NULL;
+			}
+
+			nvgluBindFramebuffer(atlas->fbo);
+
+			glViewport(0, 0, D2TK_BACKEND_NANOVG_ATLAS_SIZE, D2TK_BACKEND_NANOVG_ATLAS_SIZE);
+			glClearColor(0.f, 0.f, 0.f, 0.f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+			nvgluBindFramebuffer(NULL);
+
+			backend->natlas++;
+		}
+
+		for(unsigned s = 0; s < atlas->nshelves; s++)
+		{
+			if(atlas->shelves[s].h != sh)
+			{
+				continue;
+			}
+
+			d2tk_nanovg_sprite_t *sprite = _d2tk_nanovg_shelf_alloc(atlas, s, w);
+			if(sprite)
+			{
+				return sprite;
+			}
+		}
+
+		if(atlas->y + sh > D2TK_BACKEND_NANOVG_ATLAS_SIZE)
+		{
+			continue; // atlas is full
+		}
+
+		d2tk_nanovg_shelf_t *shelves = realloc(atlas->shelves,
+			(atlas->nshelves + 1) * sizeof(d2tk_nanovg_shelf_t));
+		if(!shelves)
+		{
+			return NULL;
+		}
+
+		atlas->shelves = shelves;
+
+		d2tk_nanovg_shelf_t *shelf = &atlas->shelves[atlas->nshelves++];
+
+		memset(shelf, 0x0, sizeof(d2tk_nanovg_shelf_t));
+		shelf->y = atlas->y;
+		shelf->h = sh;
+
+		atlas->y += sh;
+
+		return _d2tk_nanovg_shelf_alloc(atlas, atlas->nshelves - 1, w);
+	}
+
+	return NULL;
+}
+
+static inline void
+_d2tk_nanovg_atlas_release(d2tk_nanovg_sprite_t *sprite)
+{
+	d2tk_nanovg_atlas_t *atlas = sprite->atlas;
+	d2tk_nanovg_shelf_t *shelf = &atlas->shelves[sprite->shelf];
+
+	sprite->next = shelf->free;
+	shelf->free = sprite;
+
+	if(--shelf->used > 0)
+	{
+		return;
+	}
+
+	_d2tk_nanovg_shelf_reset(shelf);
+
+	// drop empty shelves at the top
+	while( (atlas->nshelves > 0) && (atlas->shelves[atlas->nshelves - 1].used == 0) )
+	{
+		atlas->nshelves--;
+		atlas->y = atlas->shelves[atlas->nshelves].y;
+	}
+}
+
+static inline void
+_d2tk_nanovg_batch_flush(d2tk_backend_nanovg_t *backend)
+{
+	d2tk_nanovg_batch_t *batch = &backend->batch;
+
+	if(batch->nverts == 0)
+	{
+		return;
+	}
+
+	NVGcontext *ctx = backend->ctx;
+	NVGparams *params = nvgInternalParams(ctx);
+	NVGpaint paint = nvgImagePattern(ctx, 0, 0, D2TK_BACKEND_NANOVG_ATLAS_SIZE,
+		D2TK_BACKEND_NANOVG_ATLAS_SIZE, 0, batch->atlas->fbo->image, 1.0f);
+	NVGscissor scissor = {
+		.extent = { -1.f, -1.f } // quads are clipped already
+	};
+	const NVGcompositeOperationState op = {
+		.srcRGB = NVG_ONE,
+		.dstRGB = NVG_ONE_MINUS_SRC_ALPHA,
+		.srcAlpha = NVG_ONE,
+		.dstAlpha = NVG_ONE_MINUS_SRC_ALPHA
+	};
+
+	// one draw call for all queued sprites of this atlas
+	params->renderTriangles(params->userPtr, &paint, op, &scissor,
+		batch->verts, batch->nverts);
+
+	batch->nverts = 0;
+}
+
+static inline void
+_d2tk_nanovg_batch_push(d2tk_backend_nanovg_t *backend,
+	const d2tk_nanovg_sprite_t *sprite, const d2tk_clip_t *bbox,
+	const d2tk_clip_t *clip)
+{
+	d2tk_nanovg_batch_t *batch = &backend->batch;
+
+	// clip quad to area of interest
+	d2tk_coord_t x0 = bbox->x0;
+	d2tk_coord_t y0 = bbox->y0;
+	d2tk_coord_t x1 = bbox->x1;
+	d2tk_coord_t y1 = bbox->y1;
+
+	if(clip)
+	{
+		x0 = x0 < clip->x0 ? clip->x0 : x0;
+		y0 = y0 < clip->y0 ? clip->y0 : y0;
+		x1 = x1 > clip->x1 ? clip->x1 : x1;
+		y1 = y1 > clip->y1 ? clip->y1 : y1;
+	}
+
+	if( (x0 >= x1) || (y0 >= y1) )
+	{
+		return;
+	}
+
+	if(batch->atlas != sprite->atlas)
+	{
+		_d2tk_nanovg_batch_flush(backend);
+
+		batch->atlas = sprite->atlas;
+	}
+
+	if(batch->nverts + 6 > batch->maxverts)
+	{
+		const int maxverts = batch->maxverts ? batch->maxverts * 2 : 0x600;
+		NVGvertex *verts = realloc(batch->verts, maxverts * sizeof(NVGvertex));
+		if(!verts)
+		{
+			return;
+		}
+
+		batch->verts = verts;
+		batch->maxverts = maxverts;
+	}
+
+	// atlas texture is bottom-up
+	static const float scale = 1.f / D2TK_BACKEND_NANOVG_ATLAS_SIZE;
+	const float u0 = (sprite->x + x0 - bbox->x0) * scale;
+	const float u1 = (sprite->x + x1 - bbox->x0) * scale;
+	const float v0 = 1.f - (sprite->y + y0 - bbox->y0) * scale;
+	const float v1 = 1.f - (sprite->y + y1 - bbox->y0) * scale;
+
+	// same winding as nvgText
+	NVGvertex *vtx = &batch->verts[batch->nverts];
+	vtx[0] = (NVGvertex){ x0, y0, u0, v0 };
+	vtx[1] = (NVGvertex){ x1, y1, u1, v1 };
+	vtx[2] = (NVGvertex){ x1, y0, u1, v0 };
+	vtx[3] = (NVGvertex){ x0, y0, u0, v0 };
+	vtx[4] = (NVGvertex){ x0, y1, u0, v1 };
+	vtx[5] = (NVGvertex){ x1, y1, u1, v1 };
+
+	batch->nverts += 6;
+}
+
 static void
 d2tk_nanovg_free(void *data)
 {
 	d2tk_backend_nanovg_t *backend = data;
 
-	for(unsigned f = 0; f < D2TK_BACKEND_NANOVG_FBO_MAX; f++)
+	if(backend->fbo)
 	{
-		if(backend->fbo[f])
-		{
-			nvgluDeleteFramebuffer(backend->fbo[f]);
-			backend->fbo[f] = NULL;
-		}
+		nvgluDeleteFramebuffer(backend->fbo);
+		backend->fbo = NULL;
 	}
 
-	if(backend->mask)
+	for(unsigned a = 0; a < backend->natlas; a++)
 	{
-		nvgDeleteImage(backend->ctx, backend->mask);
-		backend->mask = 0;
+		d2tk_nanovg_atlas_t *atlas = &backend->atlas[a];
+
+		for(unsigned s = 0; s < atlas->nshelves; s++)
+		{
+			_d2tk_nanovg_shelf_reset(&atlas->shelves[s]);
+		}
+
+		free(atlas->shelves);
+		nvgluDeleteFramebuffer(atlas->fbo);
 	}
 
+	free(backend->batch.verts);
+
 	if(backend->ctx)
 	{
 		nvgDelete(backend->ctx);
@@ -170,75 +519,52 @@ d2tk_nanovg_pre(void *data, d2tk_core_t *core, d2tk_coord_t w, d2tk_coord_t h,
 		backend->w = w;
 		backend->h = h;
 
-		for(unsigned f = 0; f < D2TK_BACKEND_NANOVG_FBO_MAX; f++)
-		{
-			if(backend->fbo[f])
-			{
-				nvgluDeleteFramebuffer(backend->fbo[f]);
-				backend->fbo[f] = NULL;
-			}
-		}
-
-		if(backend->mask)
+		if(backend->fbo)
 		{
-			nvgDeleteImage(ctx, backend->mask);
-			backend->mask = 0;
+			nvgluDeleteFramebuffer(backend->fbo);
+			backend->fbo = NULL;
 		}
 	}
 
-	for(unsigned f = 0; f < D2TK_BACKEND_NANOVG_FBO_MAX; f++)
+	if(!backend->fbo)
 	{
-		if(!backend->fbo[f])
-		{
-			backend->fbo[f] = nvgluCreateFramebuffer(ctx, w, h, NVG_IMAGE_NEAREST);
-			assert(backend->fbo[f]);
-		}
-	}
+		backend->fbo = nvgluCreateFramebuffer(ctx, w, h, NVG_IMAGE_NEAREST);
+		assert(backend->fbo);
 
-	// draw to foreground framebuffer object
-	NVGLUframebuffer *fbo_fg = backend->fbo[backend->fbop];
-	nvgluBindFramebuffer(fbo_fg);
+		nvgluBindFramebuffer(backend->fbo);
+
+		glViewport(0, 0, w, h);
+		glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	}
+	else
+	{
+		// framebuffer object still holds last frame, only dirty tiles are redrawn
+		nvgluBindFramebuffer(backend->fbo);
 
-	glViewport(0, 0, w, h);
-	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		glViewport(0, 0, w, h);
+	}
 
 	nvgBeginFrame(ctx, w, h, 1.f);
 	nvgSave(ctx);
 
-	if(!configured)
-	{
-		// draw background framebuffer object (aka last foreground framebuffer object)
-		NVGLUframebuffer *fbo_bg = backend->fbo[!backend->fbop];
-		const NVGpaint bg = nvgImagePattern(ctx, 0, 0, w, h, 0, fbo_bg->image, 1.0f);
-		nvgBeginPath(ctx);
-		nvgRect(ctx, 0, 0, w, h);
-		nvgStrokeWidth(ctx, 0);
-		nvgFillPaint(ctx, bg);
-		nvgFill(ctx);
-	}
-
 	{
-		// draw mask
-		d2tk_rect_t rect;
-		uint32_t *pixels = d2tk_core_get_pixels(core, &rect);
+		// clear dirty tiles to background
+		size_t nrects;
+		const d2tk_rect_t *rects = d2tk_core_get_dirty_rects(core, &nrects, NULL);
+		const uint32_t rgba = d2tk_core_get_bg_color(core);
 
-		if(backend->mask)
-		{
-			nvgUpdateSubImage(ctx, backend->mask, (const uint8_t *)pixels,
-				rect.x, rect.y, rect.w, rect.h);
-		}
-		else
+		nvgBeginPath(ctx);
+		for(size_t i = 0; i < nrects; i++)
 		{
-			backend->mask = nvgCreateImageRGBA(ctx, w, h, NVG_IMAGE_NEAREST,
-				(const uint8_t *)pixels);
+			nvgRect(ctx, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
 		}
-
-		const NVGpaint bg = nvgImagePattern(ctx, 0, 0, w, h, 0, backend->mask, 1.f);
-		nvgBeginPath(ctx);
-		nvgRect(ctx, rect.x, rect.y, rect.w, rect.h);
 		nvgStrokeWidth(ctx, 0);
-		nvgFillPaint(ctx, bg);
+		nvgFillColor(ctx, nvgRGBA(
+			(rgba >> 24) & 0xff,
+			(rgba >> 16) & 0xff,
+			(rgba >>  8) & 0xff,
+			(rgba >>  0) & 0xff));
 		nvgFill(ctx);
 	}
 }
@@ -248,88 +574,169 @@ d2tk_nanovg_post(void *data, d2tk_core_t *core __attribute__((unused)),
 	d2tk_coord_t w __attribute__((unused)), d2tk_coord_t h __attribute__((unused)),
 	unsigned pass)
 {
+	d2tk_backend_nanovg_t *backend = data;
+	NVGcontext *ctx = backend->ctx;;
+
 	if(pass == 0) // is this 1st pass?
 	{
+		_d2tk_nanovg_atlas_end(backend);
+
 		return true; // do enter 2nd pass
 	}
 
-	d2tk_backend_nanovg_t *backend = data;
-	NVGcontext *ctx = backend->ctx;;
+	_d2tk_nanovg_batch_flush(backend);
 
 	nvgRestore(ctx);
 	nvgEndFrame(ctx);
 
 	nvgluBindFramebuffer(NULL);
 
-	// switch foreground and background framebuffer objects
-	backend->fbop = !backend->fbop;
-
 	return false; // do NOT enter 3rd pass
 }
 
+static inline unsigned
+_d2tk_nanovg_buffer_age(d2tk_backend_nanovg_t *backend)
+{
+#if !defined(__APPLE__) && !defined(_WIN32)
+	Display *disp = glXGetCurrentDisplay();
+	const GLXDrawable drawable = glXGetCurrentDrawable();
+
+	if(!disp || !drawable) // e.g. not a GLX context
+	{
+		return 0;
+	}
+
+	if(!backend->age_probed)
+	{
+		const char *exts = glXQueryExtensionsString(disp, DefaultScreen(disp));
+
+		backend->has_age = exts && strstr(exts, "GLX_EXT_buffer_age");
+		backend->age_probed = true;
+	}
+
+	if(backend->has_age)
+	{
+		unsigned age = 0;
+
+		glXQueryDrawable(disp, drawable, GLX_BACK_BUFFER_AGE_EXT, &age);
+
+		return age;
+	}
+#else
+	(void)backend;
+#endif
+
+	return 0; // back buffer content is undefined
+}
+
 static inline void
-d2tk_nanovg_end(void *data __attribute__((unused)),
-	d2tk_core_t *core, d2tk_coord_t w, d2tk_coord_t h)
+_d2tk_nanovg_blit(const d2tk_rect_t *rect, d2tk_coord_t h)
+{
+	// framebuffers are bottom-up
+	const GLint x0 = rect->x;
+	const GLint y0 = h - rect->y - rect->h;
+	const GLint x1 = x0 + rect->w;
+	const GLint y1 = y0 + rect->h;
+
+	glBlitFramebuffer(x0, y0, x1, y1, x0, y0, x1, y1, GL_COLOR_BUFFER_BIT,
+		GL_NEAREST);
+}
+
+static inline void
+d2tk_nanovg_end(void *data, d2tk_core_t *core, d2tk_coord_t w, d2tk_coord_t h)
 {
 	d2tk_backend_nanovg_t *backend = data;
+#if D2TK_DEBUG
 	NVGcontext *ctx = backend->ctx;;
+#endif
 
-	glViewport(0, 0, w, h);
-	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	d2tk_rect_t bbox;
+	d2tk_core_get_dirty_rects(core, NULL, &bbox);
 
-	nvgBeginFrame(ctx, w, h, 1.f);
-	nvgSave(ctx);
+	// push damage of this frame to history of the last presented frames
+	memmove(&backend->damage[1], &backend->damage[0],
+		sizeof(d2tk_rect_t)*(D2TK_BACKEND_NANOVG_AGE_MAX - 1));
+	backend->damage[0] = bbox;
 
-	// draw former foreground framebuffer object to main framebuffer
-	NVGLUframebuffer *fbo_fg = backend->fbo[!backend->fbop];
-	const NVGpaint fg = nvgImagePattern(ctx, 0, 0, w, h, 0, fbo_fg->image, 1.0f);
-	nvgBeginPath(ctx);
-	nvgRect(ctx, 0, 0, w, h);
-	nvgStrokeWidth(ctx, 0);
-	nvgFillPaint(ctx, fg);
-	nvgFill(ctx);
+	if(!backend->fbo) // nothing rendered yet
+	{
+		return;
+	}
 
 #if D2TK_DEBUG
+	const unsigned age = 0; // hilighted dirty tiles would linger otherwise
+#else
+	const unsigned age = _d2tk_nanovg_buffer_age(backend);
+#endif
+	const bool full = (age == 0) || (age > D2TK_BACKEND_NANOVG_AGE_MAX);
+
+	if(!full)
 	{
-		d2tk_rect_t rect;
-		uint32_t *pixels = d2tk_core_get_pixels(core, &rect);
+		bool outdated = false;
 
-		// brighten up the pixels for proper hilighting
-		for(d2tk_coord_t y = 0, Y = 0; y < h; y++, Y+=w)
+		for(unsigned a = 0; a < age; a++)
 		{
-			for(d2tk_coord_t x = 0; x < w; x++)
-			{
-				if(pixels[Y + x])
-				{
-					pixels[Y + x] = 0x5fffff00;; // ABGR
-				}
-			}
+			outdated |= (backend->damage[a].w > 0);
 		}
 
-		if(backend->mask)
+		if(!outdated) // back buffer is up-to-date
 		{
-			nvgUpdateImage(ctx, backend->mask, (const uint8_t *)pixels);
+			return;
 		}
-		else
+	}
+
+	GLint win;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &win);
+
+	// copy framebuffer object to main framebuffer
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, backend->fbo->fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, win);
+
+	if(full)
+	{
+		_d2tk_nanovg_blit(&D2TK_RECT(0, 0, w, h), h);
+	}
+	else
+	{
+		// only repair what changed since back buffer has been presented,
+		// bboxes touching dirty tiles are redrawn up to the dirty area bounds
+		for(unsigned a = 0; a < age; a++)
 		{
-			backend->mask = nvgCreateImageRGBA(ctx, w, h, NVG_IMAGE_NEAREST,
-				(const uint8_t *)pixels);
+			const d2tk_rect_t *rect = &backend->damage[a];
+
+			if(rect->w > 0)
+			{
+				_d2tk_nanovg_blit(rect, h);
+			}
 		}
-	
-		const NVGpaint bg = nvgImagePattern(ctx, 0, 0, w, h, 0, backend->mask, 1.f);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, win);
+
+#if D2TK_DEBUG
+	{
+		glViewport(0, 0, w, h);
+
+		nvgBeginFrame(ctx, w, h, 1.f);
+		nvgSave(ctx);
+
+		// hilight dirty tiles
+		size_t nrects;
+		const d2tk_rect_t *rects = d2tk_core_get_dirty_rects(core, &nrects, NULL);
+
 		nvgBeginPath(ctx);
-		nvgRect(ctx, 0, 0, w, h);
+		for(size_t i = 0; i < nrects; i++)
+		{
+			nvgRect(ctx, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+		}
 		nvgStrokeWidth(ctx, 0);
-		nvgFillPaint(ctx, bg);
+		nvgFillColor(ctx, nvgRGBA(0x00, 0xff, 0xff, 0x5f));
 		nvgFill(ctx);
+
+		nvgRestore(ctx);
+		nvgEndFrame(ctx);
 	}
-#else
-	(void)core;
 #endif
-
-	nvgRestore(ctx);
-	nvgEndFrame(ctx);
 }
 
 static inline void
@@ -340,11 +747,20 @@ d2tk_nanovg_sprite_free(void *data, uint8_t type, uintptr_t body)
 
 	switch((sprite_type_t)type)
 	{
-		case SPRITE_TYPE_FBO:
+		case SPRITE_TYPE_BBOX:
 		{
-			NVGLUframebuffer *fbo = (NVGLUframebuffer *)body;
+			d2tk_nanovg_sprite_t *sprite = (d2tk_nanovg_sprite_t *)body;
 
-			nvgluDeleteFramebuffer(fbo);
+			if(sprite->atlas)
+			{
+				// slot is kept for reuse
+				_d2tk_nanovg_atlas_release(sprite);
+			}
+			else
+			{
+				nvgluDeleteFramebuffer(sprite->fbo);
+				free(sprite);
+			}
 		} break;
 		case SPRITE_TYPE_IMG:
 		{
@@ -590,24 +1006,78 @@ d2tk_nanovg_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 			{
 				if(body->cached)
 				{
-					uintptr_t *sprite = d2tk_core_get_sprite(core, body->hash, SPRITE_TYPE_FBO);
-					assert(sprite);
+					uintptr_t *ref = d2tk_core_get_sprite(core, body->hash, SPRITE_TYPE_BBOX);
+					assert(ref);
 
-					if(!*sprite)
+					if(*ref)
 					{
 #if D2TK_DEBUG
-						//fprintf(stderr, "\tcreating sprite\n");
+						//fprintf(stderr, "\texisting sprite\n");
 #endif
-						NVGLUframebuffer *fbo = nvgluCreateFramebuffer(ctx, body->clip.w, body->clip.h, NVG_IMAGE_NEAREST);
+						break;
+					}
+
+#if D2TK_DEBUG
+					//fprintf(stderr, "\tcreating sprite\n");
+#endif
+					const d2tk_coord_t w = body->clip.w;
+					const d2tk_coord_t h = body->clip.h;
+					d2tk_nanovg_sprite_t *sprite = NULL;
+
+					if( (w <= D2TK_BACKEND_NANOVG_ATLAS_SPRITE)
+						&& (h <= D2TK_BACKEND_NANOVG_ATLAS_SPRITE) )
+					{
+						sprite = _d2tk_nanovg_atlas_alloc(backend, w, h);
+					}
+
+					if(sprite) // render to atlas, batched with other new sprites
+					{
+						const d2tk_rect_t slot = D2TK_RECT(0, 0, w, h);
+
+						_d2tk_nanovg_atlas_begin(backend, sprite->atlas);
+
+						nvgSave(ctx);
+						nvgTranslate(ctx, sprite->x, sprite->y);
+						nvgScissor(ctx, slot.x, slot.y, slot.w, slot.h);
+
+						// clear slot, it may hold a former sprite
+						nvgSave(ctx);
+						nvgShapeAntiAlias(ctx, 0);
+						nvgGlobalCompositeOperation(ctx, NVG_COPY);
+						nvgBeginPath(ctx);
+						nvgRect(ctx, slot.x, slot.y, slot.w, slot.h);
+						nvgFillColor(ctx, nvgRGBA(0x0, 0x0, 0x0, 0x0));
+						nvgFill(ctx);
+						nvgRestore(ctx);
+
+						backend->slot = &slot;
+
+						D2TK_COM_FOREACH_CONST(com, bbox)
+						{
+							d2tk_nanovg_process(backend, core, bbox, 0, 0, clip, pass);
+						}
+
+						backend->slot = NULL;
+
+						nvgRestore(ctx);
+					}
+					else // too large or atlases full, render to FBO of its own
+					{
+						sprite = calloc(1, sizeof(d2tk_nanovg_sprite_t));
+						assert(sprite);
+
+						_d2tk_nanovg_atlas_end(backend);
+
+						NVGLUframebuffer *fbo = nvgluCreateFramebuffer(ctx, w, h, NVG_IMAGE_NEAREST);
 						assert(fbo);
 
 						nvgluBindFramebuffer(fbo);
 
-						glViewport(0, 0, body->clip.w, body->clip.h);
+						glViewport(0, 0, w, h);
 						glClearColor(0.f, 0.f, 0.f, 0.f);
 						glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-						nvgBeginFrame(ctx, body->clip.w, body->clip.h, 1.f);
+						nvgBeginFrame(ctx, w, h, 1.f);
 						nvgSave(ctx);
 
 						D2TK_COM_FOREACH_CONST(com, bbox)
@@ -620,43 +1090,58 @@ d2tk_nanovg_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 
 						nvgluBindFramebuffer(NULL);
 
-						*sprite = (uintptr_t )fbo;
-					}
-					else
-					{
-#if D2TK_DEBUG
-						//fprintf(stderr, "\texisting sprite\n");
-#endif
+						sprite->fbo = fbo;
 					}
+
+					*ref = (uintptr_t)sprite;
 				}
 				else // !body->cached
 				{
-					// render directly
+					_d2tk_nanovg_atlas_end(backend);
+
+					// load resources only
 					D2TK_COM_FOREACH_CONST(com, bbox)
 					{
 						d2tk_nanovg_process(backend, core, bbox, body->clip.x0, body->clip.y0, clip, pass);
 					}
+
+					// drop paths drawn outside of any frame
+					nvgCancelFrame(ctx);
 				}
 			}
 			else if(pass == 1)
 			{
+				const d2tk_nanovg_sprite_t *sprite = NULL;
+
+				if(body->cached)
+				{
+					uintptr_t *ref = d2tk_core_get_sprite(core, body->hash, SPRITE_TYPE_BBOX);
+					assert(ref && *ref);
+
+					sprite = (const d2tk_nanovg_sprite_t *)*ref;
+
+					if(sprite->atlas)
+					{
+						// paint pre-rendered sprite, batched per atlas
+						_d2tk_nanovg_batch_push(backend, sprite, &body->clip, clip);
+						break;
+					}
+				}
+
+				// keep painting order
+				_d2tk_nanovg_batch_flush(backend);
+
 				nvgSave(ctx);
 				if(clip)
 				{
 					nvgScissor(ctx, clip->x0, clip->y0, clip->w, clip->h);
 				}
 
-				if(body->cached)
+				if(sprite)
 				{
-					uintptr_t *sprite = d2tk_core_get_sprite(core, body->hash, SPRITE_TYPE_FBO);
-					assert(sprite && *sprite);
-
-					NVGLUframebuffer *fbo = (NVGLUframebuffer *)*sprite;
-					assert(fbo);
-
 					// paint pre-rendered sprite
 					const NVGpaint pat = nvgImagePattern(ctx, body->clip.x0, body->clip.y0,
-						body->clip.w, body->clip.h, 0, fbo->image, 1.0f);
+						body->clip.w, body->clip.h, 0, sprite->fbo->image, 1.0f);
 					nvgBeginPath(ctx);
 					nvgRect(ctx, body->clip.x0, body->clip.y0, body->clip.w, body->clip.h);
 					nvgStrokeWidth(ctx, 0);
@@ -688,10 +1173,24 @@ d2tk_nanovg_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 			const d2tk_body_scissor_t *body = &com->body->scissor;
 
 			nvgScissor(ctx, body->x + xo, body->y + yo, body->w, body->h);
+
+			if(backend->slot) // do not spill over to neighbouring sprites in atlas
+			{
+				nvgIntersectScissor(ctx, backend->slot->x, backend->slot->y,
+					backend->slot->w, backend->slot->h);
+			}
 		} break;
 		case D2TK_INSTR_RESET_SCISSOR:
 		{
-			nvgResetScissor(ctx);
+			if(backend->slot)
+			{
+				nvgScissor(ctx, backend->slot->x, backend->slot->y,
+					backend->slot->w, backend->slot->h);
+			}
+			else
+			{
+				nvgResetScissor(ctx);
+			}
 		} break;
 		case D2TK_INSTR_FONT_FACE:
 		{
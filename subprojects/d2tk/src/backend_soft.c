@@ -0,0 +1,1903 @@
+/*
+ * Copyright (c) 2018-2019 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmisleading-indentation"
+#pragma GCC diagnostic ignored "-Wimplicit-fallthrough="
+#pragma GCC diagnostic ignored "-Wshift-negative-value"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wsign-compare"
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "stb_truetype.h"
+#pragma GCC diagnostic pop
+
+#include "core_internal.h"
+#include <d2tk/backend_soft.h>
+#include <d2tk/hash.h>
+
+#define D2TK_SOFT_STACK_MAX 16
+#define D2TK_SOFT_TOLERANCE 0.25f // max flattening error in px
+
+typedef enum _sprite_type_t {
+	SPRITE_TYPE_NONE = 0,
+	SPRITE_TYPE_SURF = 1,
+	SPRITE_TYPE_FONT = 2,
+	SPRITE_TYPE_GLYPH = 3
+} sprite_type_t;
+
+typedef struct _d2tk_soft_point_t d2tk_soft_point_t;
+typedef struct _d2tk_soft_path_t d2tk_soft_path_t;
+typedef struct _d2tk_soft_raster_t d2tk_soft_raster_t;
+typedef struct _d2tk_soft_surf_t d2tk_soft_surf_t;
+typedef struct _d2tk_soft_font_t d2tk_soft_font_t;
+typedef struct _d2tk_soft_glyph_t d2tk_soft_glyph_t;
+typedef struct _d2tk_soft_glyph_key_t d2tk_soft_glyph_key_t;
+typedef struct _d2tk_soft_state_t d2tk_soft_state_t;
+typedef struct _d2tk_backend_soft_t d2tk_backend_soft_t;
+
+struct _d2tk_soft_point_t {
+	float x;
+	float y;
+	bool move; // starts a new subpath
+};
+
+struct _d2tk_soft_path_t {
+	d2tk_soft_point_t *pts;
+	size_t npts;
+	size_t maxpts;
+	size_t start; // first point of current subpath
+	bool current; // has current point
+};
+
+// signed area accumulation buffer, one row of w+2 floats per scanline
+struct _d2tk_soft_raster_t {
+	float *acc;
+	size_t nacc;
+	uint8_t *cov;
+	size_t ncov;
+	d2tk_coord_t x0;
+	d2tk_coord_t y0;
+	d2tk_coord_t w;
+	d2tk_coord_t h;
+};
+
+struct _d2tk_soft_surf_t {
+	d2tk_coord_t w;
+	d2tk_coord_t h;
+	uint32_t argb [];
+};
+
+struct _d2tk_soft_font_t {
+	stbtt_fontinfo info;
+	uint64_t hash;
+	int ascent;
+	int descent;
+	uint8_t *data;
+};
+
+struct _d2tk_soft_glyph_t {
+	d2tk_coord_t x;
+	d2tk_coord_t y;
+	d2tk_coord_t w;
+	d2tk_coord_t h;
+	float advance;
+	uint8_t alpha [];
+};
+
+struct _d2tk_soft_glyph_key_t {
+	uint64_t font;
+	int32_t size;
+	uint32_t cp;
+};
+
+struct _d2tk_soft_state_t {
+	uint32_t argb [2]; // premultiplied source, 2nd for gradients
+	bool gradient;
+	float gx; // gradient origin
+	float gy;
+	float gdx; // gradient direction scaled by 1/length^2
+	float gdy;
+	float width;
+	d2tk_coord_t size;
+	const d2tk_soft_font_t *font;
+	d2tk_clip_t scissor;
+	float cos;
+	float sin;
+};
+
+struct _d2tk_backend_soft_t {
+	char *bundle_path;
+	d2tk_soft_target_t *target;
+	d2tk_soft_target_t dst; // current render target, target or sprite
+	d2tk_clip_t base; // clip of current bbox
+	d2tk_soft_state_t state;
+	d2tk_soft_state_t stack [D2TK_SOFT_STACK_MAX];
+	unsigned depth;
+	d2tk_soft_path_t *path; // shared with sprite renderers
+	d2tk_soft_raster_t *raster;
+	const d2tk_soft_font_t *font; // most recent, for text extents
+};
+
+static inline void
+_d2tk_soft_process(d2tk_backend_soft_t *backend, d2tk_core_t *core,
+	const d2tk_com_t *com, d2tk_coord_t xo, d2tk_coord_t yo,
+	const d2tk_clip_t *clip, unsigned pass);
+
+// multiply all 4 channels by a in [0, 255], two channels at a time
+static inline uint32_t
+_d2tk_soft_mul(uint32_t p, uint32_t a)
+{
+	uint32_t rb = (p & 0x00ff00ff) * a;
+	uint32_t ag = ( (p >> 8) & 0x00ff00ff) * a;
+
+	rb = ( (rb + ( (rb >> 8) & 0x00ff00ff) + 0x00800080) >> 8) & 0x00ff00ff;
+	ag = (ag + ( (ag >> 8) & 0x00ff00ff) + 0x00800080) & 0xff00ff00;
+
+	return rb | ag;
+}
+
+static inline uint32_t
+_d2tk_soft_over(uint32_t dst, uint32_t src)
+{
+	return src + _d2tk_soft_mul(dst, 0xff - (src >> 24));
+}
+
+// 0xRRGGBBAA to premultiplied 0xAARRGGBB
+static inline uint32_t
+_d2tk_soft_argb(uint32_t rgba)
+{
+	const uint32_t a = rgba & 0xff;
+	const uint32_t argb = (a << 24) | (rgba >> 8);
+
+	return (_d2tk_soft_mul(argb, a) & 0x00ffffff) | (a << 24);
+}
+
+static inline uint32_t *
+_d2tk_soft_row(const d2tk_soft_target_t *dst, d2tk_coord_t y)
+{
+	return (uint32_t *)((uint8_t *)dst->argb + y*dst->stride);
+}
+
+static inline void
+_d2tk_soft_clip_intersect(d2tk_clip_t *dst, const d2tk_clip_t *a,
+	const d2tk_clip_t *b)
+{
+	dst->x0 = a->x0 > b->x0 ? a->x0 : b->x0;
+	dst->y0 = a->y0 > b->y0 ? a->y0 : b->y0;
+	dst->x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+	dst->y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+
+	if(dst->x1 < dst->x0)
+	{
+		dst->x1 = dst->x0;
+	}
+
+	if(dst->y1 < dst->y0)
+	{
+		dst->y1 = dst->y0;
+	}
+
+	dst->w = dst->x1 - dst->x0;
+	dst->h = dst->y1 - dst->y0;
+}
+
+static inline void
+_d2tk_soft_clip_rect(d2tk_clip_t *dst, d2tk_coord_t x, d2tk_coord_t y,
+	d2tk_coord_t w, d2tk_coord_t h)
+{
+	dst->x0 = x;
+	dst->y0 = y;
+	dst->x1 = x + w;
+	dst->y1 = y + h;
+	dst->w = w;
+	dst->h = h;
+}
+
+// blend a span of coverage values with the current source
+static inline void
+_d2tk_soft_span(d2tk_backend_soft_t *backend, d2tk_coord_t x, d2tk_coord_t y,
+	d2tk_coord_t n, const uint8_t *cov)
+{
+	const d2tk_soft_state_t *state = &backend->state;
+	uint32_t *dst = &_d2tk_soft_row(&backend->dst, y)[x];
+
+	if(state->gradient)
+	{
+		const float py = y + 0.5f - state->gy;
+
+		for(d2tk_coord_t i = 0; i < n; i++)
+		{
+			if(!cov[i])
+			{
+				continue;
+			}
+
+			const float px = x + i + 0.5f - state->gx;
+			float t = px*state->gdx + py*state->gdy;
+
+			t = t < 0.f
+				? 0.f
+				: (t > 1.f ? 1.f : t);
+
+			const uint32_t u = t*0xff + 0.5f;
+			const uint32_t src = _d2tk_soft_mul(state->argb[0], 0xff - u)
+				+ _d2tk_soft_mul(state->argb[1], u);
+
+			dst[i] = _d2tk_soft_over(dst[i], _d2tk_soft_mul(src, cov[i]));
+		}
+	}
+	else if( (state->argb[0] >> 24) == 0xff)
+	{
+		const uint32_t src = state->argb[0];
+
+		for(d2tk_coord_t i = 0; i < n; i++)
+		{
+			if(cov[i] == 0xff)
+			{
+				dst[i] = src;
+			}
+			else if(cov[i])
+			{
+				dst[i] = _d2tk_soft_over(dst[i], _d2tk_soft_mul(src, cov[i]));
+			}
+		}
+	}
+	else
+	{
+		const uint32_t src = state->argb[0];
+
+		for(d2tk_coord_t i = 0; i < n; i++)
+		{
+			if(cov[i])
+			{
+				dst[i] = _d2tk_soft_over(dst[i], _d2tk_soft_mul(src, cov[i]));
+			}
+		}
+	}
+}
+
+static inline int
+_d2tk_soft_raster_begin(d2tk_soft_raster_t *raster, const d2tk_clip_t *clip)
+{
+	const size_t nacc = (clip->w + 2) * clip->h;
+
+	if(nacc > raster->nacc)
+	{
+		free(raster->acc);
+		raster->acc = calloc(nacc, sizeof(float));
+		if(!raster->acc)
+		{
+			raster->nacc = 0;
+			return 1;
+		}
+
+		raster->nacc = nacc;
+	}
+
+	if( (size_t)clip->w > raster->ncov)
+	{
+		raster->cov = realloc(raster->cov, clip->w);
+		if(!raster->cov)
+		{
+			raster->ncov = 0;
+			return 1;
+		}
+
+		raster->ncov = clip->w;
+	}
+
+	raster->x0 = clip->x0;
+	raster->y0 = clip->y0;
+	raster->w = clip->w;
+	raster->h = clip->h;
+
+	return 0;
+}
+
+// accumulate signed area of a line in local coordinates with x in [0, w]
+static inline void
+_d2tk_soft_raster_acc(d2tk_soft_raster_t *raster, float x0, float y0,
+	float x1, float y1)
+{
+	if(fabsf(y1 - y0) <= 1e-6f)
+	{
+		return;
+	}
+
+	float dir = 1.f;
+
+	if(y0 > y1)
+	{
+		float tmp;
+
+		tmp = x0; x0 = x1; x1 = tmp;
+		tmp = y0; y0 = y1; y1 = tmp;
+		dir = -1.f;
+	}
+
+	const size_t stride = raster->w + 2;
+	const float dxdy = (x1 - x0) / (y1 - y0);
+	float x = x0;
+
+	if(y0 < 0.f)
+	{
+		x -= y0 * dxdy;
+	}
+
+	const d2tk_coord_t ys = y0 < 0.f
+		? 0
+		: y0;
+	const d2tk_coord_t ye = ceilf(y1) < raster->h
+		? ceilf(y1)
+		: raster->h;
+
+	for(d2tk_coord_t y = ys; y < ye; y++)
+	{
+		float *a = &raster->acc[y*stride];
+		const float dy = (y + 1 < y1 ? y + 1 : y1) - (y > y0 ? y : y0);
+		const float xnext = x + dxdy*dy;
+		const float d = dy*dir;
+		const float xa = x < xnext ? x : xnext;
+		const float xb = x < xnext ? xnext : x;
+		const float xafloor = floorf(xa);
+		const d2tk_coord_t xai = xafloor;
+		const float xbceil = ceilf(xb);
+		const d2tk_coord_t xbi = xbceil;
+
+		if(xbi <= xai + 1)
+		{
+			const float xmf = 0.5f*(x + xnext) - xafloor;
+
+			a[xai] += d - d*xmf;
+			a[xai + 1] += d*xmf;
+		}
+		else
+		{
+			const float s = 1.f / (xb - xa);
+			const float xaf = xa - xafloor;
+			const float a0 = 0.5f*s*(1.f - xaf)*(1.f - xaf);
+			const float xbf = xb - xbceil + 1.f;
+			const float am = 0.5f*s*xbf*xbf;
+
+			a[xai] += d*a0;
+
+			if(xbi == xai + 2)
+			{
+				a[xai + 1] += d*(1.f - a0 - am);
+			}
+			else
+			{
+				const float a1 = s*(1.5f - xaf);
+
+				a[xai + 1] += d*(a1 - a0);
+
+				for(d2tk_coord_t xi = xai + 2; xi < xbi - 1; xi++)
+				{
+					a[xi] += d*s;
+				}
+
+				const float a2 = a1 + (xbi - xai - 3)*s;
+
+				a[xbi - 1] += d*(1.f - a2 - am);
+			}
+
+			a[xbi] += d*am;
+		}
+
+		x = xnext;
+	}
+}
+
+// clip line to [0, w] horizontally, project outside parts onto the edges
+static inline void
+_d2tk_soft_raster_line(d2tk_soft_raster_t *raster, float x0, float y0,
+	float x1, float y1)
+{
+	const float w = raster->w;
+
+	x0 -= raster->x0;
+	x1 -= raster->x0;
+	y0 -= raster->y0;
+	y1 -= raster->y0;
+
+	if( (x0 < 0.f) || (x1 < 0.f) )
+	{
+		if( (x0 < 0.f) && (x1 < 0.f) )
+		{
+			_d2tk_soft_raster_acc(raster, 0.f, y0, 0.f, y1);
+			return;
+		}
+
+		const float ym = y0 + (y1 - y0) * (0.f - x0) / (x1 - x0);
+
+		if(x0 < 0.f)
+		{
+			_d2tk_soft_raster_acc(raster, 0.f, y0, 0.f, ym);
+			x0 = 0.f;
+			y0 = ym;
+		}
+		else
+		{
+			_d2tk_soft_raster_acc(raster, 0.f, ym, 0.f, y1);
+			x1 = 0.f;
+			y1 = ym;
+		}
+	}
+
+	if( (x0 > w) || (x1 > w) )
+	{
+		if( (x0 > w) && (x1 > w) )
+		{
+			_d2tk_soft_raster_acc(raster, w, y0, w, y1);
+			return;
+		}
+
+		const float ym = y0 + (y1 - y0) * (w - x0) / (x1 - x0);
+
+		if(x0 > w)
+		{
+			_d2tk_soft_raster_acc(raster, w, y0, w, ym);
+			x0 = w;
+			y0 = ym;
+		}
+		else
+		{
+			_d2tk_soft_raster_acc(raster, w, ym, w, y1);
+			x1 = w;
+			y1 = ym;
+		}
+	}
+
+	_d2tk_soft_raster_acc(raster, x0, y0, x1, y1);
+}
+
+// integrate accumulated area into coverage and blend it row by row
+static inline void
+_d2tk_soft_raster_end(d2tk_backend_soft_t *backend)
+{
+	d2tk_soft_raster_t *raster = backend->raster;
+	const size_t stride = raster->w + 2;
+
+	for(d2tk_coord_t y = 0; y < raster->h; y++)
+	{
+		float *a = &raster->acc[y*stride];
+		float sum = 0.f;
+		bool any = false;
+
+		for(d2tk_coord_t x = 0; x < raster->w; x++)
+		{
+			sum += a[x];
+			a[x] = 0.f;
+
+			const float c = fabsf(sum);
+			const uint8_t cov = c >= 1.f
+				? 0xff
+				: c*0xff + 0.5f;
+
+			raster->cov[x] = cov;
+			any |= cov != 0;
+		}
+
+		a[raster->w] = 0.f;
+		a[raster->w + 1] = 0.f;
+
+		if(any)
+		{
+			_d2tk_soft_span(backend, raster->x0, raster->y0 + y, raster->w,
+				raster->cov);
+		}
+	}
+}
+
+static inline void
+_d2tk_soft_raster_poly(d2tk_soft_raster_t *raster, const float *xy, unsigned n)
+{
+	for(unsigned i = 0, j = n - 1; i < n; j = i++)
+	{
+		_d2tk_soft_raster_line(raster, xy[j*2], xy[j*2 + 1], xy[i*2], xy[i*2 + 1]);
+	}
+}
+
+static inline unsigned
+_d2tk_soft_arc_segments(float r, float da)
+{
+	const float step = r > D2TK_SOFT_TOLERANCE
+		? 2.f*acosf(1.f - D2TK_SOFT_TOLERANCE / r)
+		: da;
+	const float n = ceilf(fabsf(da) / step);
+
+	return n < 1.f
+		? 1
+		: (n > 256.f ? 256 : n);
+}
+
+static inline void
+_d2tk_soft_path_clear(d2tk_soft_path_t *path)
+{
+	path->npts = 0;
+	path->start = 0;
+	path->current = false;
+}
+
+// append point in user space, transformed to device space
+static inline void
+_d2tk_soft_path_push(d2tk_backend_soft_t *backend, float x, float y, bool move)
+{
+	d2tk_soft_path_t *path = backend->path;
+	const d2tk_soft_state_t *state = &backend->state;
+
+	if(path->npts == path->maxpts)
+	{
+		path->maxpts = path->maxpts
+			? path->maxpts << 1
+			: 256;
+		path->pts = realloc(path->pts, path->maxpts*sizeof(d2tk_soft_point_t));
+		assert(path->pts);
+	}
+
+	if(move || !path->current)
+	{
+		path->start = path->npts;
+		move = true;
+	}
+
+	d2tk_soft_point_t *pt = &path->pts[path->npts++];
+
+	pt->x = x*state->cos - y*state->sin;
+	pt->y = x*state->sin + y*state->cos;
+	pt->move = move;
+
+	path->current = true;
+}
+
+static inline void
+_d2tk_soft_path_close(d2tk_soft_path_t *path)
+{
+	if(path->current && (path->npts > path->start) )
+	{
+		const d2tk_soft_point_t *start = &path->pts[path->start];
+		const d2tk_soft_point_t *last = &path->pts[path->npts - 1];
+
+		if( (last->x != start->x) || (last->y != start->y) )
+		{
+			if(path->npts == path->maxpts)
+			{
+				path->maxpts <<= 1;
+				path->pts = realloc(path->pts, path->maxpts*sizeof(d2tk_soft_point_t));
+				assert(path->pts);
+				start = &path->pts[path->start];
+			}
+
+			d2tk_soft_point_t *pt = &path->pts[path->npts++];
+
+			pt->x = start->x;
+			pt->y = start->y;
+			pt->move = false;
+		}
+	}
+
+	path->current = false;
+}
+
+static inline void
+_d2tk_soft_path_arc(d2tk_backend_soft_t *backend, float cx, float cy, float r,
+	float a, float b, bool cw)
+{
+	static const float mul = M_PI / 180;
+
+	a *= mul;
+	b *= mul;
+
+	// normalize like cairo_arc/cairo_arc_negative
+	if(cw)
+	{
+		while(b < a)
+		{
+			b += 2*M_PI;
+		}
+	}
+	else
+	{
+		while(b > a)
+		{
+			b -= 2*M_PI;
+		}
+	}
+
+	const unsigned n = _d2tk_soft_arc_segments(r, b - a);
+	const float da = (b - a) / n;
+
+	for(unsigned i = 0; i <= n; i++)
+	{
+		const float t = a + da*i;
+
+		_d2tk_soft_path_push(backend, cx + r*cosf(t), cy + r*sinf(t), false);
+	}
+}
+
+// flatten cubic bezier in device space from current point
+static inline void
+_d2tk_soft_path_curve(d2tk_backend_soft_t *backend, float x1, float y1,
+	float x2, float y2, float x3, float y3)
+{
+	d2tk_soft_path_t *path = backend->path;
+
+	if(!path->current)
+	{
+		_d2tk_soft_path_push(backend, x1, y1, true);
+	}
+
+	const d2tk_soft_state_t *state = &backend->state;
+	const d2tk_soft_point_t *p0 = &path->pts[path->npts - 1];
+
+	// control points to device space
+	const float px [4] = {
+		p0->x,
+		x1*state->cos - y1*state->sin,
+		x2*state->cos - y2*state->sin,
+		x3*state->cos - y3*state->sin
+	};
+	const float py [4] = {
+		p0->y,
+		x1*state->sin + y1*state->cos,
+		x2*state->sin + y2*state->cos,
+		x3*state->sin + y3*state->cos
+	};
+
+	const float len = hypotf(px[1] - px[0], py[1] - py[0])
+		+ hypotf(px[2] - px[1], py[2] - py[1])
+		+ hypotf(px[3] - px[2], py[3] - py[2]);
+	const float nf = ceilf(sqrtf(len / D2TK_SOFT_TOLERANCE) * 0.5f);
+	const unsigned n = nf < 2.f
+		? 2
+		: (nf > 64.f ? 64 : nf);
+
+	// push in device space with identity transform
+	d2tk_soft_state_t tmp = *state;
+	backend->state.cos = 1.f;
+	backend->state.sin = 0.f;
+
+	for(unsigned i = 1; i <= n; i++)
+	{
+		const float t = (float)i / n;
+		const float u = 1.f - t;
+		const float b0 = u*u*u;
+		const float b1 = 3.f*u*u*t;
+		const float b2 = 3.f*u*t*t;
+		const float b3 = t*t*t;
+
+		_d2tk_soft_path_push(backend,
+			b0*px[0] + b1*px[1] + b2*px[2] + b3*px[3],
+			b0*py[0] + b1*py[1] + b2*py[2] + b3*py[3], false);
+	}
+
+	backend->state = tmp;
+}
+
+// intersect bounds of path, grown by brd, with the scissor
+static inline bool
+_d2tk_soft_path_clip(d2tk_backend_soft_t *backend, float brd, d2tk_clip_t *dst)
+{
+	const d2tk_soft_path_t *path = backend->path;
+
+	if(path->npts < 2)
+	{
+		return false;
+	}
+
+	float x0 = INFINITY;
+	float y0 = INFINITY;
+	float x1 = -INFINITY;
+	float y1 = -INFINITY;
+
+	for(size_t i = 0; i < path->npts; i++)
+	{
+		const d2tk_soft_point_t *pt = &path->pts[i];
+
+		x0 = pt->x < x0 ? pt->x : x0;
+		y0 = pt->y < y0 ? pt->y : y0;
+		x1 = pt->x > x1 ? pt->x : x1;
+		y1 = pt->y > y1 ? pt->y : y1;
+	}
+
+	d2tk_clip_t bnd;
+	_d2tk_soft_clip_rect(&bnd, floorf(x0 - brd), floorf(y0 - brd), 0, 0);
+	bnd.x1 = ceilf(x1 + brd);
+	bnd.y1 = ceilf(y1 + brd);
+
+	_d2tk_soft_clip_intersect(dst, &bnd, &backend->state.scissor);
+
+	return (dst->w > 0) && (dst->h > 0);
+}
+
+static inline void
+_d2tk_soft_fill(d2tk_backend_soft_t *backend)
+{
+	d2tk_soft_path_t *path = backend->path;
+	d2tk_soft_raster_t *raster = backend->raster;
+	d2tk_clip_t clip;
+
+	if(_d2tk_soft_path_clip(backend, 0.f, &clip)
+		&& (_d2tk_soft_raster_begin(raster, &clip) == 0) )
+	{
+		for(size_t i = 0; i < path->npts; )
+		{
+			size_t j = i + 1;
+
+			for( ; (j < path->npts) && !path->pts[j].move; j++)
+			{
+				const d2tk_soft_point_t *p = &path->pts[j - 1];
+				const d2tk_soft_point_t *q = &path->pts[j];
+
+				_d2tk_soft_raster_line(raster, p->x, p->y, q->x, q->y);
+			}
+
+			// implicitly close subpath
+			const d2tk_soft_point_t *p = &path->pts[j - 1];
+			const d2tk_soft_point_t *q = &path->pts[i];
+
+			_d2tk_soft_raster_line(raster, p->x, p->y, q->x, q->y);
+
+			i = j;
+		}
+
+		_d2tk_soft_raster_end(backend);
+	}
+
+	_d2tk_soft_path_clear(path);
+}
+
+// round join, same orientation as the segment quads
+static inline void
+_d2tk_soft_stroke_join(d2tk_soft_raster_t *raster, float x, float y, float r)
+{
+	float xy [2*64];
+	unsigned n = _d2tk_soft_arc_segments(r, 2*M_PI);
+
+	n = n < 8
+		? 8
+		: (n > 64 ? 64 : n);
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		const float t = -2*M_PI*i / n;
+
+		xy[i*2] = x + r*cosf(t);
+		xy[i*2 + 1] = y + r*sinf(t);
+	}
+
+	_d2tk_soft_raster_poly(raster, xy, n);
+}
+
+static inline void
+_d2tk_soft_stroke(d2tk_backend_soft_t *backend)
+{
+	d2tk_soft_path_t *path = backend->path;
+	d2tk_soft_raster_t *raster = backend->raster;
+	const float hw = backend->state.width * 0.5f;
+	d2tk_clip_t clip;
+
+	if( (hw > 0.f) && _d2tk_soft_path_clip(backend, hw + 1.f, &clip)
+		&& (_d2tk_soft_raster_begin(raster, &clip) == 0) )
+	{
+		for(size_t i = 0; i < path->npts; )
+		{
+			size_t j = i + 1;
+
+			for( ; (j < path->npts) && !path->pts[j].move; j++)
+			{
+				const d2tk_soft_point_t *p = &path->pts[j - 1];
+				const d2tk_soft_point_t *q = &path->pts[j];
+				const float dx = q->x - p->x;
+				const float dy = q->y - p->y;
+				const float len = hypotf(dx, dy);
+
+				if(len <= 0.f)
+				{
+					continue;
+				}
+
+				const float nx = -dy / len * hw;
+				const float ny = dx / len * hw;
+				const float xy [2*4] = {
+					p->x + nx, p->y + ny,
+					q->x + nx, q->y + ny,
+					q->x - nx, q->y - ny,
+					p->x - nx, p->y - ny
+				};
+
+				_d2tk_soft_raster_poly(raster, xy, 4);
+
+				// join inner vertices, and the start of closed subpaths
+				const bool last = (j + 1 == path->npts) || path->pts[j + 1].move;
+				const bool closed = (q->x == path->pts[i].x) && (q->y == path->pts[i].y);
+
+				if(!last || closed)
+				{
+					_d2tk_soft_stroke_join(raster, q->x, q->y, hw);
+				}
+			}
+
+			i = j;
+		}
+
+		_d2tk_soft_raster_end(backend);
+	}
+
+	_d2tk_soft_path_clear(path);
+}
+
+// nearest neighbour scaled blit of premultiplied pixels
+static inline void
+_d2tk_soft_blit(d2tk_backend_soft_t *backend, const uint32_t *argb,
+	d2tk_coord_t w, d2tk_coord_t h, size_t stride, d2tk_coord_t x,
+	d2tk_coord_t y, d2tk_coord_t dw, d2tk_coord_t dh)
+{
+	if( (w <= 0) || (h <= 0) || (dw <= 0) || (dh <= 0) )
+	{
+		return;
+	}
+
+	d2tk_clip_t bnd;
+	d2tk_clip_t clip;
+	_d2tk_soft_clip_rect(&bnd, x, y, dw, dh);
+	_d2tk_soft_clip_intersect(&clip, &bnd, &backend->state.scissor);
+
+	const uint32_t sx = ((uint64_t)w << 16) / dw;
+	const uint32_t sy = ((uint64_t)h << 16) / dh;
+
+	for(d2tk_coord_t py = clip.y0; py < clip.y1; py++)
+	{
+		uint32_t *dst = _d2tk_soft_row(&backend->dst, py);
+		const uint32_t *src = (const uint32_t *)((const uint8_t *)argb
+			+ (((py - y)*sy) >> 16)*stride);
+		uint32_t fx = (clip.x0 - x)*sx;
+
+		for(d2tk_coord_t px = clip.x0; px < clip.x1; px++, fx += sx)
+		{
+			const uint32_t s = src[fx >> 16];
+
+			if( (s >> 24) == 0xff)
+			{
+				dst[px] = s;
+			}
+			else if(s)
+			{
+				dst[px] = _d2tk_soft_over(dst[px], s);
+			}
+		}
+	}
+}
+
+static inline void
+_d2tk_soft_surf_draw(d2tk_backend_soft_t *backend, const uint32_t *argb,
+	d2tk_coord_t W, d2tk_coord_t H, size_t stride, d2tk_coord_t xo,
+	d2tk_coord_t yo, d2tk_align_t align, const d2tk_rect_t *rect)
+{
+	d2tk_coord_t w = W;
+	d2tk_coord_t h = H;
+	float scale = 1.f;
+
+	if(h != rect->h)
+	{
+		scale = (float)rect->h / h;
+		w *= scale;
+		h = rect->h;
+	}
+
+	if(w > rect->w)
+	{
+		const float scale_t = (float)rect->w / w;
+		scale *= scale_t;
+		h *= scale_t;
+		w = rect->w;
+	}
+
+	d2tk_coord_t x = rect->x + xo;
+	d2tk_coord_t y = rect->y + yo;
+
+	if(align & D2TK_ALIGN_LEFT)
+	{
+		x += 0;
+	}
+	else if(align & D2TK_ALIGN_CENTER)
+	{
+		x += rect->w / 2;
+		x -= w / 2;
+	}
+	else if(align & D2TK_ALIGN_RIGHT)
+	{
+		x += rect->w;
+		x -= w;
+	}
+
+	if(align & D2TK_ALIGN_TOP)
+	{
+		y += 0;
+	}
+	else if(align & D2TK_ALIGN_MIDDLE)
+	{
+		y += rect->h / 2;
+		y -= h / 2;
+	}
+	else if(align & D2TK_ALIGN_BOTTOM)
+	{
+		y += rect->h;
+		y -= h;
+	}
+
+	_d2tk_soft_blit(backend, argb, W, H, stride, x, y, w, h);
+}
+
+static inline char *
+_absolute_path(d2tk_backend_soft_t *backend, const char *rel)
+{
+	char *abs = NULL;
+
+	if(rel[0] == '/')
+	{
+		assert(asprintf(&abs, "%s", rel) != -1);
+	}
+	else
+	{
+		assert(asprintf(&abs, "%s%s", backend->bundle_path, rel) != -1);
+	}
+
+	return abs;
+}
+
+static inline uint8_t *
+_d2tk_soft_load(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if(!f)
+	{
+		return NULL;
+	}
+
+	uint8_t *data = NULL;
+
+	if(fseek(f, 0, SEEK_END) == 0)
+	{
+		const long len = ftell(f);
+
+		if( (len > 0) && (fseek(f, 0, SEEK_SET) == 0) )
+		{
+			data = malloc(len);
+
+			if(data && (fread(data, len, 1, f) != 1) )
+			{
+				free(data);
+				data = NULL;
+			}
+		}
+	}
+
+	fclose(f);
+
+	return data;
+}
+
+static inline const d2tk_soft_font_t *
+_d2tk_soft_font(d2tk_backend_soft_t *backend, d2tk_core_t *core,
+	const char *face)
+{
+	const uint64_t hash = d2tk_hash(face, strlen(face));
+	uintptr_t *sprite = d2tk_core_get_sprite(core, hash, SPRITE_TYPE_FONT);
+	if(!sprite)
+	{
+		return NULL;
+	}
+
+	if(!*sprite)
+	{
+		char ft_path [1024];
+		d2tk_core_get_font_path(core, backend->bundle_path, face,
+			sizeof(ft_path), ft_path);
+
+		d2tk_soft_font_t *font = calloc(1, sizeof(d2tk_soft_font_t));
+		if(!font)
+		{
+			return NULL;
+		}
+
+		font->data = _d2tk_soft_load(ft_path);
+		if(!font->data || !stbtt_InitFont(&font->info, font->data,
+			stbtt_GetFontOffsetForIndex(font->data, 0)))
+		{
+			fprintf(stderr, "stbtt_InitFont failed on '%s'\n", ft_path);
+			free(font->data);
+			free(font);
+			return NULL;
+		}
+
+		font->hash = hash;
+		stbtt_GetFontVMetrics(&font->info, &font->ascent, &font->descent, NULL);
+
+		*sprite = (uintptr_t)font;
+	}
+
+	return (const d2tk_soft_font_t *)*sprite;
+}
+
+static inline const d2tk_soft_glyph_t *
+_d2tk_soft_glyph(d2tk_core_t *core, const d2tk_soft_font_t *font,
+	d2tk_coord_t size, float scale, uint32_t cp)
+{
+	const d2tk_soft_glyph_key_t key = {
+		.font = font->hash,
+		.size = size,
+		.cp = cp
+	};
+	const uint64_t hash = d2tk_hash(&key, sizeof(key));
+	uintptr_t *sprite = d2tk_core_get_sprite(core, hash, SPRITE_TYPE_GLYPH);
+	if(!sprite)
+	{
+		return NULL;
+	}
+
+	if(!*sprite)
+	{
+		int adv;
+		int lsb;
+		int x0;
+		int y0;
+		int x1;
+		int y1;
+
+		stbtt_GetCodepointHMetrics(&font->info, cp, &adv, &lsb);
+		stbtt_GetCodepointBitmapBox(&font->info, cp, scale, scale,
+			&x0, &y0, &x1, &y1);
+
+		const d2tk_coord_t w = x1 - x0;
+		const d2tk_coord_t h = y1 - y0;
+
+		d2tk_soft_glyph_t *glyph = calloc(1, sizeof(d2tk_soft_glyph_t) + w*h);
+		if(!glyph)
+		{
+			return NULL;
+		}
+
+		glyph->x = x0;
+		glyph->y = y0;
+		glyph->w = w;
+		glyph->h = h;
+		glyph->advance = adv*scale;
+
+		if( (w > 0) && (h > 0) )
+		{
+			stbtt_MakeCodepointBitmap(&font->info, glyph->alpha, w, h, w,
+				scale, scale, cp);
+		}
+
+		*sprite = (uintptr_t)glyph;
+	}
+
+	return (const d2tk_soft_glyph_t *)*sprite;
+}
+
+static inline uint32_t
+_d2tk_soft_utf8(const char **str)
+{
+	const uint8_t *s = (const uint8_t *)*str;
+	uint32_t cp = s[0];
+	unsigned n = 0;
+
+	if(cp >= 0xf0)
+	{
+		cp &= 0x07;
+		n = 3;
+	}
+	else if(cp >= 0xe0)
+	{
+		cp &= 0x0f;
+		n = 2;
+	}
+	else if(cp >= 0xc0)
+	{
+		cp &= 0x1f;
+		n = 1;
+	}
+
+	s++;
+
+	for(unsigned i = 0; i < n; i++, s++)
+	{
+		if( (*s & 0xc0) != 0x80)
+		{
+			cp = 0xfffd; // truncated sequence
+			break;
+		}
+
+		cp = (cp << 6) | (*s & 0x3f);
+	}
+
+	*str = (const char *)s;
+
+	return cp;
+}
+
+static inline float
+_d2tk_soft_text_width(const d2tk_soft_font_t *font, float scale,
+	const char *str, const char *end)
+{
+	float width = 0.f;
+	uint32_t prev = 0;
+
+	while( (str < end) && *str)
+	{
+		const uint32_t cp = _d2tk_soft_utf8(&str);
+		int adv;
+		int lsb;
+
+		stbtt_GetCodepointHMetrics(&font->info, cp, &adv, &lsb);
+
+		if(prev)
+		{
+			width += stbtt_GetCodepointKernAdvance(&font->info, prev, cp) * scale;
+		}
+
+		width += adv * scale;
+		prev = cp;
+	}
+
+	return width;
+}
+
+static inline void
+_d2tk_soft_text(d2tk_backend_soft_t *backend, d2tk_core_t *core,
+	const d2tk_body_text_t *body, d2tk_coord_t xo, d2tk_coord_t yo)
+{
+	const d2tk_soft_state_t *state = &backend->state;
+	const d2tk_soft_font_t *font = state->font;
+
+	if(!font || (state->size <= 0) )
+	{
+		return;
+	}
+
+	const char *end = body->text + strlen(body->text);
+	const float scale = stbtt_ScaleForMappingEmToPixels(&font->info, state->size);
+	const float width = _d2tk_soft_text_width(font, scale, body->text, end);
+	float x = 0.f;
+	float y = 0.f;
+
+	if(body->align & D2TK_ALIGN_LEFT)
+	{
+		x += body->x;
+	}
+	else if(body->align & D2TK_ALIGN_CENTER)
+	{
+		x += body->x + body->w / 2;
+		x -= width / 2;
+	}
+	else if(body->align & D2TK_ALIGN_RIGHT)
+	{
+		x += body->x + body->w;
+		x -= width;
+	}
+
+	if(body->align & D2TK_ALIGN_TOP)
+	{
+		y += body->y + font->ascent*scale;
+	}
+	else if(body->align & D2TK_ALIGN_MIDDLE)
+	{
+		y += body->y + body->h / 2 - font->descent*scale;
+	}
+	else if(body->align & D2TK_ALIGN_BOTTOM)
+	{
+		y += body->y + body->h;
+	}
+
+	x += xo;
+	y += yo;
+
+	const d2tk_coord_t baseline = lrintf(y);
+	const char *str = body->text;
+	uint32_t prev = 0;
+
+	while(str < end)
+	{
+		const uint32_t cp = _d2tk_soft_utf8(&str);
+
+		if(prev)
+		{
+			x += stbtt_GetCodepointKernAdvance(&font->info, prev, cp) * scale;
+		}
+
+		const d2tk_soft_glyph_t *glyph = _d2tk_soft_glyph(core, font,
+			state->size, scale, cp);
+
+		if(!glyph)
+		{
+			break;
+		}
+
+		d2tk_clip_t bnd;
+		d2tk_clip_t clip;
+		const d2tk_coord_t gx = lrintf(x) + glyph->x;
+		const d2tk_coord_t gy = baseline + glyph->y;
+
+		_d2tk_soft_clip_rect(&bnd, gx, gy, glyph->w, glyph->h);
+		_d2tk_soft_clip_intersect(&clip, &bnd, &state->scissor);
+
+		for(d2tk_coord_t py = clip.y0; py < clip.y1; py++)
+		{
+			_d2tk_soft_span(backend, clip.x0, py, clip.w,
+				&glyph->alpha[(py - gy)*glyph->w + clip.x0 - gx]);
+		}
+
+		x += glyph->advance;
+		prev = cp;
+	}
+}
+
+static inline void
+_d2tk_soft_state_reset(d2tk_backend_soft_t *backend)
+{
+	d2tk_soft_state_t *state = &backend->state;
+
+	// same defaults as cairo
+	state->argb[0] = 0xff000000;
+	state->argb[1] = 0xff000000;
+	state->gradient = false;
+	state->width = 2.f;
+	state->size = 10;
+	state->font = NULL;
+	state->scissor = backend->base;
+	state->cos = 1.f;
+	state->sin = 0.f;
+
+	backend->depth = 0;
+	_d2tk_soft_path_clear(backend->path);
+}
+
+static inline void
+_d2tk_soft_bbox_begin(d2tk_backend_soft_t *backend, const d2tk_clip_t *clip,
+	const d2tk_clip_t *bbox)
+{
+	d2tk_clip_t bnd;
+	_d2tk_soft_clip_rect(&bnd, 0, 0, backend->dst.w, backend->dst.h);
+
+	_d2tk_soft_clip_intersect(&backend->base, &bnd, bbox);
+
+	if(clip)
+	{
+		_d2tk_soft_clip_intersect(&backend->base, &backend->base, clip);
+	}
+
+	_d2tk_soft_state_reset(backend);
+}
+
+// pre-render cached bbox into its own surface
+static inline const d2tk_soft_surf_t *
+_d2tk_soft_sprite(d2tk_backend_soft_t *backend, d2tk_core_t *core,
+	const d2tk_com_t *com)
+{
+	const d2tk_body_bbox_t *body = &com->body->bbox;
+
+	uintptr_t *sprite = d2tk_core_get_sprite(core, body->hash, SPRITE_TYPE_SURF);
+	if(!sprite)
+	{
+		return NULL;
+	}
+
+	if(!*sprite)
+	{
+		const d2tk_coord_t w = body->clip.w;
+		const d2tk_coord_t h = body->clip.h;
+
+		d2tk_soft_surf_t *surf = calloc(1, sizeof(d2tk_soft_surf_t)
+			+ w*h*sizeof(uint32_t));
+		if(!surf)
+		{
+			return NULL;
+		}
+
+		surf->w = w;
+		surf->h = h;
+
+		d2tk_backend_soft_t backend2 = *backend;
+		backend2.dst.argb = surf->argb;
+		backend2.dst.stride = w*sizeof(uint32_t);
+		backend2.dst.w = w;
+		backend2.dst.h = h;
+
+		d2tk_clip_t bnd;
+		_d2tk_soft_clip_rect(&bnd, 0, 0, w, h);
+		_d2tk_soft_bbox_begin(&backend2, NULL, &bnd);
+
+		D2TK_COM_FOREACH_CONST(com, bbox)
+		{
+			_d2tk_soft_process(&backend2, core, bbox, 0, 0, NULL, 1);
+		}
+
+		backend->font = backend2.font;
+		*sprite = (uintptr_t)surf;
+	}
+
+	return (const d2tk_soft_surf_t *)*sprite;
+}
+
+static void
+d2tk_soft_free(void *data)
+{
+	d2tk_backend_soft_t *backend = data;
+
+	if(backend->path)
+	{
+		free(backend->path->pts);
+		free(backend->path);
+	}
+
+	if(backend->raster)
+	{
+		free(backend->raster->acc);
+		free(backend->raster->cov);
+		free(backend->raster);
+	}
+
+	free(backend->bundle_path);
+	free(backend);
+}
+
+static void *
+d2tk_soft_new(const char *bundle_path)
+{
+	d2tk_backend_soft_t *backend = calloc(1, sizeof(d2tk_backend_soft_t));
+	if(!backend)
+	{
+		fprintf(stderr, "calloc failed\n");
+		return NULL;
+	}
+
+	backend->bundle_path = strdup(bundle_path);
+	backend->path = calloc(1, sizeof(d2tk_soft_path_t));
+	backend->raster = calloc(1, sizeof(d2tk_soft_raster_t));
+
+	if(!backend->bundle_path || !backend->path || !backend->raster)
+	{
+		fprintf(stderr, "calloc failed\n");
+		d2tk_soft_free(backend);
+		return NULL;
+	}
+
+	_d2tk_soft_state_reset(backend);
+
+	return backend;
+}
+
+static int
+d2tk_soft_context(void *data, void *pctx)
+{
+	d2tk_backend_soft_t *backend = data;
+
+	if(!pctx)
+	{
+		fprintf(stderr, "invalid soft target\n");
+		return 1;
+	}
+
+	backend->target = pctx;
+
+	return 0;
+}
+
+static inline void
+d2tk_soft_pre(void *data, d2tk_core_t *core, d2tk_coord_t w, d2tk_coord_t h,
+	unsigned pass)
+{
+	d2tk_backend_soft_t *backend = data;
+
+	if(pass == 0) // is this 1st pass ?
+	{
+		return;
+	}
+
+	backend->dst = *backend->target;
+
+	if(backend->dst.w > w)
+	{
+		backend->dst.w = w;
+	}
+
+	if(backend->dst.h > h)
+	{
+		backend->dst.h = h;
+	}
+
+	// clear dirty tiles to background
+	size_t nrects;
+	const d2tk_rect_t *rects = d2tk_core_get_dirty_rects(core, &nrects, NULL);
+	const uint32_t bg = _d2tk_soft_argb(d2tk_core_get_bg_color(core));
+
+	d2tk_clip_t bnd;
+	_d2tk_soft_clip_rect(&bnd, 0, 0, backend->dst.w, backend->dst.h);
+
+	for(size_t i = 0; i < nrects; i++)
+	{
+		d2tk_clip_t rect;
+		d2tk_clip_t clip;
+
+		_d2tk_soft_clip_rect(&rect, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+		_d2tk_soft_clip_intersect(&clip, &rect, &bnd);
+
+		for(d2tk_coord_t y = clip.y0; y < clip.y1; y++)
+		{
+			uint32_t *dst = _d2tk_soft_row(&backend->dst, y);
+
+			for(d2tk_coord_t x = clip.x0; x < clip.x1; x++)
+			{
+				dst[x] = bg;
+			}
+		}
+	}
+}
+
+static inline bool
+d2tk_soft_post(void *data __attribute__((unused)),
+	d2tk_core_t *core __attribute__((unused)),
+	d2tk_coord_t w __attribute__((unused)), d2tk_coord_t h __attribute__((unused)),
+	unsigned pass)
+{
+	if(pass == 0) // is this 1st pass ?
+	{
+		return true; // do enter 2nd pass
+	}
+
+#if D2TK_DEBUG
+	{
+		d2tk_backend_soft_t *backend = data;
+
+		// hilight dirty tiles
+		size_t nrects;
+		const d2tk_rect_t *rects = d2tk_core_get_dirty_rects(core, &nrects, NULL);
+
+		d2tk_clip_t bnd;
+		_d2tk_soft_clip_rect(&bnd, 0, 0, backend->dst.w, backend->dst.h);
+
+		for(size_t i = 0; i < nrects; i++)
+		{
+			d2tk_clip_t rect;
+			d2tk_clip_t clip;
+
+			_d2tk_soft_clip_rect(&rect, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+			_d2tk_soft_clip_intersect(&clip, &rect, &bnd);
+
+			for(d2tk_coord_t y = clip.y0; y < clip.y1; y++)
+			{
+				uint32_t *dst = _d2tk_soft_row(&backend->dst, y);
+
+				for(d2tk_coord_t x = clip.x0; x < clip.x1; x++)
+				{
+					dst[x] = _d2tk_soft_over(dst[x], 0x5f005f5f);
+				}
+			}
+		}
+	}
+#endif
+
+	return false; // do NOT enter 3rd pass
+}
+
+static inline void
+d2tk_soft_end(void *data __attribute__((unused)),
+	d2tk_core_t *core __attribute__((unused)),
+	d2tk_coord_t w __attribute__((unused)), d2tk_coord_t h __attribute__((unused)))
+{
+	// rendered in place, nothing to copy
+}
+
+static inline void
+d2tk_soft_sprite_free(void *data, uint8_t type, uintptr_t body)
+{
+	d2tk_backend_soft_t *backend = data;
+
+	switch((sprite_type_t)type)
+	{
+		case SPRITE_TYPE_SURF:
+		{
+			d2tk_soft_surf_t *surf = (d2tk_soft_surf_t *)body;
+
+			free(surf);
+		} break;
+		case SPRITE_TYPE_FONT:
+		{
+			d2tk_soft_font_t *font = (d2tk_soft_font_t *)body;
+
+			if(backend->font == font)
+			{
+				backend->font = NULL;
+			}
+
+			free(font->data);
+			free(font);
+		} break;
+		case SPRITE_TYPE_GLYPH:
+		{
+			d2tk_soft_glyph_t *glyph = (d2tk_soft_glyph_t *)body;
+
+			free(glyph);
+		} break;
+		case SPRITE_TYPE_NONE:
+		{
+			// nothing to do
+		} break;
+	}
+}
+
+static inline int
+d2tk_soft_text_extent(void *data, size_t len, const char *buf, d2tk_coord_t h)
+{
+	d2tk_backend_soft_t *backend = data;
+	const d2tk_soft_font_t *font = backend->font;
+	//FIXME we need to take font face into account, too
+
+	if(!font)
+	{
+		return len * h / 2; // rough guess until a face has been loaded
+	}
+
+	const float scale = stbtt_ScaleForMappingEmToPixels(&font->info, h);
+
+	return _d2tk_soft_text_width(font, scale, buf, &buf[len]);
+}
+
+static inline void
+_d2tk_soft_process(d2tk_backend_soft_t *backend, d2tk_core_t *core,
+	const d2tk_com_t *com, d2tk_coord_t xo, d2tk_coord_t yo,
+	const d2tk_clip_t *clip, unsigned pass)
+{
+	d2tk_soft_state_t *state = &backend->state;
+	d2tk_soft_path_t *path = backend->path;
+
+	const d2tk_instr_t instr = com->instr;
+	switch(instr)
+	{
+		case D2TK_INSTR_LINE_TO:
+		{
+			const d2tk_body_line_to_t *body = &com->body->line_to;
+
+			_d2tk_soft_path_push(backend, body->x + xo, body->y + yo, false);
+		} break;
+		case D2TK_INSTR_MOVE_TO:
+		{
+			const d2tk_body_move_to_t *body = &com->body->move_to;
+
+			_d2tk_soft_path_push(backend, body->x + xo, body->y + yo, true);
+		} break;
+		case D2TK_INSTR_RECT:
+		{
+			const d2tk_body_rect_t *body = &com->body->rect;
+			const d2tk_coord_t x = body->x + xo;
+			const d2tk_coord_t y = body->y + yo;
+
+			_d2tk_soft_path_push(backend, x, y, true);
+			_d2tk_soft_path_push(backend, x + body->w, y, false);
+			_d2tk_soft_path_push(backend, x + body->w, y + body->h, false);
+			_d2tk_soft_path_push(backend, x, y + body->h, false);
+			_d2tk_soft_path_close(path);
+		} break;
+		case D2TK_INSTR_ROUNDED_RECT:
+		{
+			const d2tk_body_rounded_rect_t *body = &com->body->rounded_rect;
+			const d2tk_coord_t x = body->x + xo;
+			const d2tk_coord_t y = body->y + yo;
+			const d2tk_coord_t w = body->w;
+			const d2tk_coord_t h = body->h;
+			const d2tk_coord_t r = body->r;
+
+			if(r > 0)
+			{
+				path->current = false;
+				_d2tk_soft_path_arc(backend, x + w - r, y + r, r, -90, 0, true);
+				_d2tk_soft_path_arc(backend, x + w - r, y + h - r, r, 0, 90, true);
+				_d2tk_soft_path_arc(backend, x + r, y + h - r, r, 90, 180, true);
+				_d2tk_soft_path_arc(backend, x + r, y + r, r, 180, 270, true);
+			}
+			else
+			{
+				_d2tk_soft_path_push(backend, x, y, true);
+				_d2tk_soft_path_push(backend, x + w, y, false);
+				_d2tk_soft_path_push(backend, x + w, y + h, false);
+				_d2tk_soft_path_push(backend, x, y + h, false);
+			}
+			_d2tk_soft_path_close(path);
+		} break;
+		case D2TK_INSTR_ARC:
+		{
+			const d2tk_body_arc_t *body = &com->body->arc;
+
+			_d2tk_soft_path_arc(backend, body->x + xo, body->y + yo, body->r,
+				body->a, body->b, body->cw);
+		} break;
+		case D2TK_INSTR_CURVE_TO:
+		{
+			const d2tk_body_curve_to_t *body = &com->body->curve_to;
+
+			_d2tk_soft_path_curve(backend,
+				body->x1 + xo, body->y1 + yo,
+				body->x2 + xo, body->y2 + yo,
+				body->x3 + xo, body->y3 + yo);
+		} break;
+		case D2TK_INSTR_COLOR:
+		{
+			const d2tk_body_color_t *body = &com->body->color;
+
+			state->argb[0] = _d2tk_soft_argb(body->rgba);
+			state->gradient = false;
+		} break;
+		case D2TK_INSTR_LINEAR_GRADIENT:
+		{
+			const d2tk_body_linear_gradient_t *body = &com->body->linear_gradient;
+
+			const float x0 = body->p[0].x + xo;
+			const float y0 = body->p[0].y + yo;
+			const float x1 = body->p[1].x + xo;
+			const float y1 = body->p[1].y + yo;
+
+			// gradient vector to device space
+			const float gx = x0*state->cos - y0*state->sin;
+			const float gy = x0*state->sin + y0*state->cos;
+			const float dx = (x1*state->cos - y1*state->sin) - gx;
+			const float dy = (x1*state->sin + y1*state->cos) - gy;
+			const float len2 = dx*dx + dy*dy;
+
+			state->argb[0] = _d2tk_soft_argb(body->rgba[0]);
+			state->argb[1] = _d2tk_soft_argb(body->rgba[1]);
+			state->gradient = len2 > 0.f;
+			state->gx = gx;
+			state->gy = gy;
+			state->gdx = len2 > 0.f ? dx / len2 : 0.f;
+			state->gdy = len2 > 0.f ? dy / len2 : 0.f;
+		} break;
+		case D2TK_INSTR_ROTATE:
+		{
+			const d2tk_body_rotate_t *body = &com->body->rotate;
+
+			static const float mul = M_PI / 180;
+			const float rad = body->deg * mul;
+			const float c = cosf(rad);
+			const float s = sinf(rad);
+			const float cos = state->cos*c - state->sin*s;
+			const float sin = state->sin*c + state->cos*s;
+
+			state->cos = cos;
+			state->sin = sin;
+		} break;
+		case D2TK_INSTR_STROKE:
+		{
+			_d2tk_soft_stroke(backend);
+		} break;
+		case D2TK_INSTR_FILL:
+		{
+			_d2tk_soft_fill(backend);
+		} break;
+		case D2TK_INSTR_SAVE:
+		{
+			if(backend->depth < D2TK_SOFT_STACK_MAX)
+			{
+				backend->stack[backend->depth] = *state;
+			}
+			backend->depth++;
+		} break;
+		case D2TK_INSTR_RESTORE:
+		{
+			if(backend->depth > 0)
+			{
+				backend->depth--;
+
+				if(backend->depth < D2TK_SOFT_STACK_MAX)
+				{
+					*state = backend->stack[backend->depth];
+				}
+			}
+		} break;
+		case D2TK_INSTR_BBOX:
+		{
+			const d2tk_body_bbox_t *body = &com->body->bbox;
+
+			if(body->cached)
+			{
+				const d2tk_soft_surf_t *surf = _d2tk_soft_sprite(backend, core, com);
+
+				if( (pass == 1) && surf)
+				{
+					// paint pre-rendered sprite
+					_d2tk_soft_bbox_begin(backend, clip, &body->clip);
+					_d2tk_soft_blit(backend, surf->argb, surf->w, surf->h,
+						surf->w*sizeof(uint32_t), body->clip.x0, body->clip.y0,
+						surf->w, surf->h);
+				}
+			}
+			else if(pass == 1)
+			{
+				// render directly
+				_d2tk_soft_bbox_begin(backend, clip, &body->clip);
+
+				D2TK_COM_FOREACH_CONST(com, bbox)
+				{
+					_d2tk_soft_process(backend, core, bbox, body->clip.x0, body->clip.y0,
+						clip, pass);
+				}
+			}
+		} break;
+		case D2TK_INSTR_BEGIN_PATH:
+		{
+			path->current = false;
+		} break;
+		case D2TK_INSTR_CLOSE_PATH:
+		{
+			_d2tk_soft_path_close(path);
+		} break;
+		case D2TK_INSTR_SCISSOR:
+		{
+			const d2tk_body_scissor_t *body = &com->body->scissor;
+
+			d2tk_clip_t rect;
+			_d2tk_soft_clip_rect(&rect, body->x + xo, body->y + yo, body->w, body->h);
+			_d2tk_soft_clip_intersect(&state->scissor, &state->scissor, &rect);
+		} break;
+		case D2TK_INSTR_RESET_SCISSOR:
+		{
+			state->scissor = backend->base;
+		} break;
+		case D2TK_INSTR_FONT_FACE:
+		{
+			const d2tk_body_font_face_t *body = &com->body->font_face;
+
+			state->font = _d2tk_soft_font(backend, core, body->face);
+
+			if(state->font)
+			{
+				backend->font = state->font;
+			}
+		} break;
+		case D2TK_INSTR_FONT_SIZE:
+		{
+			const d2tk_body_font_size_t *body = &com->body->font_size;
+
+			state->size = body->size;
+		} break;
+		case D2TK_INSTR_TEXT:
+		{
+			const d2tk_body_text_t *body = &com->body->text;
+
+			_d2tk_soft_text(backend, core, body, xo, yo);
+		} break;
+		case D2TK_INSTR_IMAGE:
+		{
+			const d2tk_body_image_t *body = &com->body->image;
+
+			const uint64_t hash = d2tk_hash(body->path, strlen(body->path));
+			uintptr_t *sprite = d2tk_core_get_sprite(core, hash, SPRITE_TYPE_SURF);
+			assert(sprite);
+
+			if(!*sprite)
+			{
+				char *img_path = _absolute_path(backend, body->path);
+				assert(img_path);
+
+				struct stat st;
+				if(stat(img_path, &st) == 0)
+				{
+					int W, H, N;
+					uint8_t *pixels = NULL;
+
+					stbi_set_unpremultiply_on_load(1);
+					stbi_convert_iphone_png_to_rgb(1);
+					pixels = stbi_load(img_path, &W, &H, &N, 4);
+
+					d2tk_soft_surf_t *surf = pixels
+						? calloc(1, sizeof(d2tk_soft_surf_t) + W*H*sizeof(uint32_t))
+						: NULL;
+
+					if(surf)
+					{
+						surf->w = W;
+						surf->h = H;
+
+						// premultiply and swizzle to native ARGB
+						for(int i = 0; i < W*H; i++)
+						{
+							const uint8_t *p = &pixels[i*4];
+							const uint32_t rgba = ((uint32_t)p[0] << 24)
+								| ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+
+							surf->argb[i] = _d2tk_soft_argb(rgba);
+						}
+
+						*sprite = (uintptr_t)surf;
+					}
+
+					stbi_image_free(pixels);
+				}
+
+				free(img_path);
+			}
+
+			const d2tk_soft_surf_t *surf = (const d2tk_soft_surf_t *)*sprite;
+
+			if(surf)
+			{
+				_d2tk_soft_surf_draw(backend, surf->argb, surf->w, surf->h,
+					surf->w*sizeof(uint32_t), xo, yo, body->align,
+					&D2TK_RECT(body->x, body->y, body->w, body->h));
+			}
+		} break;
+		case D2TK_INSTR_BITMAP:
+		{
+			const d2tk_body_bitmap_t *body = &com->body->bitmap;
+
+			// already premultiplied ARGB, blit in place
+			_d2tk_soft_surf_draw(backend, body->surf.argb, body->surf.w,
+				body->surf.h, body->surf.stride, xo, yo, body->align,
+				&D2TK_RECT(body->x, body->y, body->w, body->h));
+		} break;
+		case D2TK_INSTR_CUSTOM:
+		{
+			const d2tk_body_custom_t *body = &com->body->custom;
+
+			body->custom(&backend->dst,
+				&D2TK_RECT(body->x + xo, body->y + yo, body->w, body->h), body->data);
+		} break;
+		case D2TK_INSTR_STROKE_WIDTH:
+		{
+			const d2tk_body_stroke_width_t *body = &com->body->stroke_width;
+
+			state->width = body->width;
+		} break;
+		default:
+		{
+			fprintf(stderr, "%s: unknown command (%i)\n", __func__, com->instr);
+		} break;
+	}
+}
+
+static inline void
+d2tk_soft_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
+	d2tk_coord_t xo, d2tk_coord_t yo, const d2tk_clip_t *clip, unsigned pass)
+{
+	d2tk_backend_soft_t *backend = data;
+
+	_d2tk_soft_process(backend, core, com, xo, yo, clip, pass);
+}
+
+const d2tk_core_driver_t d2tk_core_driver = {
+	.new = d2tk_soft_new,
+	.free = d2tk_soft_free,
+	.context = d2tk_soft_context,
+	.pre = d2tk_soft_pre,
+	.process = d2tk_soft_process,
+	.post = d2tk_soft_post,
+	.end = d2tk_soft_end,
+	.sprite_free = d2tk_soft_sprite_free,
+	.text_extent = d2tk_soft_text_extent
+};
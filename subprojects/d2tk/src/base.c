@@ -90,6 +90,35 @@ _d2tk_flip_clear_old(d2tk_flip_t *flip)
 	_d2tk_flip_set_old(flip, 0);
 }
 
+static inline void
+_d2tk_base_poller_add(d2tk_base_t *base, d2tk_atom_t *atom)
+{
+	if(atom->poller)
+	{
+		return;
+	}
+
+	base->pollers[base->npollers++] = atom - base->atoms;
+	atom->poller = base->npollers;
+}
+
+static inline void
+_d2tk_base_poller_del(d2tk_base_t *base, d2tk_atom_t *atom)
+{
+	if(!atom->poller)
+	{
+		return;
+	}
+
+	// move last registered atom into the gap
+	const uint32_t pos = atom->poller - 1;
+	const uint16_t last = base->pollers[--base->npollers];
+
+	base->pollers[pos] = last;
+	base->atoms[last].poller = pos + 1;
+	atom->poller = 0;
+}
+
 void *
 _d2tk_base_get_atom(d2tk_base_t *base, d2tk_id_t id, d2tk_atom_type_t type,
 	d2tk_atom_event_t event)
@@ -171,6 +200,15 @@ _d2tk_base_get_atom(d2tk_base_t *base, d2tk_id_t id, d2tk_atom_type_t type,
 				memset(body, 0x0, len);
 				atom->body = body;
 			}
+
+			if(atom->event)
+			{
+				_d2tk_base_poller_add(base, atom);
+			}
+			else
+			{
+				_d2tk_base_poller_del(base, atom);
+			}
 		}
 
 		atom->ttl = 32; //FIXME
@@ -359,6 +397,18 @@ d2tk_state_is_bell(d2tk_state_t state)
 	return (state & D2TK_STATE_BELL);
 }
 
+D2TK_API bool
+d2tk_state_is_match(d2tk_state_t state)
+{
+	return (state & D2TK_STATE_MATCH);
+}
+
+D2TK_API bool
+d2tk_state_is_paste(d2tk_state_t state)
+{
+	return (state & D2TK_STATE_PASTE);
+}
+
 D2TK_API bool
 d2tk_base_is_hit(d2tk_base_t *base, const d2tk_rect_t *rect)
 {
@@ -760,10 +810,34 @@ d2tk_base_get_style(d2tk_base_t *base)
 	return base->style ? base->style : d2tk_base_get_default_style();
 }
 
+D2TK_API uint64_t
+d2tk_base_get_style_hash(d2tk_base_t *base)
+{
+	// hash style once per set, widgets only hash the resulting integer
+	if(!base->style_hashed)
+	{
+		base->style_hash = d2tk_hash(d2tk_base_get_style(base),
+			sizeof(d2tk_style_t));
+		base->style_hashed = true;
+	}
+
+	return base->style_hash;
+}
+
 D2TK_API void
 d2tk_base_set_style(d2tk_base_t *base, const d2tk_style_t *style)
 {
 	base->style = style;
+	base->style_hashed = false;
+}
+
+void
+_d2tk_base_set_style_hash(d2tk_base_t *base, const d2tk_style_t *style,
+	uint64_t hash)
+{
+	base->style = style;
+	base->style_hash = hash;
+	base->style_hashed = true;
 }
 
 D2TK_API void
@@ -795,8 +869,10 @@ d2tk_base_set_ttls(d2tk_base_t *base, uint32_t sprites, uint32_t memcaches)
 }
 
 static void
-_d2tk_atom_deinit(d2tk_atom_t *atom)
+_d2tk_atom_deinit(d2tk_base_t *base, d2tk_atom_t *atom)
 {
+	_d2tk_base_poller_del(base, atom);
+
 	atom->id = 0;
 	atom->type = 0;
 	if(atom->event)
@@ -821,7 +897,7 @@ _d2tk_atom_gc(d2tk_base_t *base)
 			continue;
 		}
 
-		_d2tk_atom_deinit(atom);
+		_d2tk_atom_deinit(base, atom);
 	}
 }
 
@@ -832,7 +908,7 @@ _d2tk_atom_free(d2tk_base_t *base)
 	{
 		d2tk_atom_t *atom = &base->atoms[i];
 
-		_d2tk_atom_deinit(atom);
+		_d2tk_atom_deinit(base, atom);
 	}
 }
 
@@ -901,60 +977,71 @@ d2tk_base_post(d2tk_base_t *base)
 	d2tk_core_post(base->core);
 }
 
-static int
-_d2tk_base_probe(int fd)
+D2TK_API void
+d2tk_base_probe(d2tk_base_t *base)
 {
-	if(fd <= 0)
-	{
-		return 0;
-	}
-
 #if !defined(_WIN32)
-	struct pollfd fds = {
-		.fd = fd,
-		.events = POLLIN,
-		.revents = 0
-	};
-
-	switch(poll(&fds, 1, 0))
+	// one poll call per batch of registered atoms, each with up to two fds
+	for(uint32_t off = 0; off < base->npollers; off += _D2TK_POLL_BATCH)
 	{
-		case -1:
-		{
-			//printf("[%s] error: %s\n", __func__, strerror(errno));
-		} return 0;
-		case 0:
+		const uint32_t end = (off + _D2TK_POLL_BATCH < base->npollers)
+			? off + _D2TK_POLL_BATCH
+			: base->npollers;
+		struct pollfd fds [_D2TK_POLL_BATCH*2];
+		d2tk_atom_t *atoms [_D2TK_POLL_BATCH*2];
+		nfds_t nfds = 0;
+
+		for(uint32_t i = off; i < end; i++)
 		{
-			//printf("[%s] timeout\n", __func__);
-		} return 0;
+			d2tk_atom_t *atom = &base->atoms[base->pollers[i]];
 
-		default:
-		{
-			//printf("[%s] ready\n", __func__);
-		} return 1;
-	}
-#else
-	return 0;
-#endif
-}
+			const int fd = atom->event(D2TK_ATOM_EVENT_FD, atom->body);
+			const int aux = atom->event(D2TK_ATOM_EVENT_FD_AUX, atom->body);
 
-D2TK_API void
-d2tk_base_probe(d2tk_base_t *base)
-{
-	for(unsigned i = 0; i < _D2TK_MAX_ATOM; i++)
-	{
-		d2tk_atom_t *atom = &base->atoms[i];
+			if(fd > 0)
+			{
+				const int events = atom->event(D2TK_ATOM_EVENT_EVENTS, atom->body);
 
-		if(atom->id && atom->type && atom->event)
+				fds[nfds].fd = fd;
+				fds[nfds].events = events ? events : POLLIN;
+				fds[nfds].revents = 0;
+				atoms[nfds++] = atom;
+			}
+
+			if(aux > 0)
+			{
+				fds[nfds].fd = aux;
+				fds[nfds].events = POLLIN;
+				fds[nfds].revents = 0;
+				atoms[nfds++] = atom;
+			}
+		}
+
+		if( (nfds == 0) || (poll(fds, nfds, 0) <= 0) )
 		{
-			const int fd = atom->event(D2TK_ATOM_EVENT_FD, atom->body);
+			continue;
+		}
+
+		for(nfds_t i = 0; i < nfds; i++)
+		{
+			d2tk_atom_t *atom = atoms[i];
+			int revents = fds[i].revents;
+
+			if(revents & POLLOUT)
+			{
+				atom->event(D2TK_ATOM_EVENT_WRITE, atom->body);
+				revents &= ~POLLOUT;
+			}
 
-			if(_d2tk_base_probe(fd))
+			if(revents)
 			{
 				d2tk_base_set_again(base);
-				break;
 			}
 		}
 	}
+#else
+	(void)base;
+#endif
 }
 
 D2TK_API int
@@ -962,18 +1049,21 @@ d2tk_base_get_file_descriptors(d2tk_base_t *base, int *fds, int numfds)
 {
 	int idx = 0;
 
-	for(unsigned i = 0; i < _D2TK_MAX_ATOM; i++)
+	for(uint32_t i = 0; i < base->npollers; i++)
 	{
-		d2tk_atom_t *atom = &base->atoms[i];
+		d2tk_atom_t *atom = &base->atoms[base->pollers[i]];
+
+		const int fd = atom->event(D2TK_ATOM_EVENT_FD, atom->body);
+		const int aux = atom->event(D2TK_ATOM_EVENT_FD_AUX, atom->body);
 
-		if(atom->id && atom->type && atom->event)
+		if( (fd > 0) && (idx < numfds) )
 		{
-			const int fd = atom->event(D2TK_ATOM_EVENT_FD, atom->body);
+			fds[idx++] = fd;
+		}
 
-			if( (fd > 0) && (idx < numfds) )
-			{
-				fds[idx++] = fd;
-			}
+		if( (aux > 0) && (idx < numfds) )
+		{
+			fds[idx++] = aux;
 		}
 	}
 
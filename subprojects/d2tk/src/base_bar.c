@@ -23,12 +23,13 @@
 
 static inline void
 _d2tk_base_draw_bar(d2tk_core_t *core, const d2tk_rect_t *rect,
-	d2tk_state_t state, const d2tk_style_t *style, float v, float z)
+	d2tk_state_t state, const d2tk_style_t *style, uint64_t style_hash,
+	float v, float z)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ rect, sizeof(d2tk_rect_t) },
 		{ &state , sizeof(d2tk_state_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &v, sizeof(float) },
 		{ &z, sizeof(float) },
 		{ NULL, 0 }
@@ -154,7 +155,8 @@ d2tk_base_bar_int32(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	d2tk_clip_float(0.f, &v, 1.f);
 	d2tk_clip_float(0.f, &z, 1.f);
 
-	_d2tk_base_draw_bar(base->core, rect, state, d2tk_base_get_style(base), v, z);
+	_d2tk_base_draw_bar(base->core, rect, state, d2tk_base_get_style(base),
+		d2tk_base_get_style_hash(base), v, z);
 
 	return state;
 }
@@ -203,7 +205,8 @@ d2tk_base_bar_int64(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	d2tk_clip_float(0.f, &v, 1.f);
 	d2tk_clip_float(0.f, &z, 1.f);
 
-	_d2tk_base_draw_bar(base->core, rect, state, d2tk_base_get_style(base), v, z);
+	_d2tk_base_draw_bar(base->core, rect, state, d2tk_base_get_style(base),
+		d2tk_base_get_style_hash(base), v, z);
 
 	return state;
 }
@@ -258,7 +261,8 @@ d2tk_base_bar_float(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	d2tk_clip_float(0.f, &v, 1.f);
 	d2tk_clip_float(0.f, &z, 1.f);
 
-	_d2tk_base_draw_bar(base->core, rect, state, d2tk_base_get_style(base), v, z);
+	_d2tk_base_draw_bar(base->core, rect, state, d2tk_base_get_style(base),
+		d2tk_base_get_style_hash(base), v, z);
 
 	return state;
 }
@@ -313,7 +317,8 @@ d2tk_base_bar_double(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	d2tk_clip_double(0.f, &v, 1.f);
 	d2tk_clip_double(0.f, &z, 1.f);
 
-	_d2tk_base_draw_bar(base->core, rect, state, d2tk_base_get_style(base), v, z);
+	_d2tk_base_draw_bar(base->core, rect, state, d2tk_base_get_style(base),
+		d2tk_base_get_style_hash(base), v, z);
 
 	return state;
 }
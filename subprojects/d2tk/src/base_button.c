@@ -22,7 +22,8 @@
 static inline void
 _d2tk_base_draw_button(d2tk_core_t *core, ssize_t lbl_len, const char *lbl,
 	d2tk_align_t align, ssize_t path_len, const char *path,
-	const d2tk_rect_t *rect, d2tk_triple_t triple, const d2tk_style_t *style)
+	const d2tk_rect_t *rect, d2tk_triple_t triple, const d2tk_style_t *style,
+	uint64_t style_hash)
 {
 	const bool has_lbl = lbl_len && lbl;
 	const bool has_img = path_len && path;
@@ -40,7 +41,7 @@ _d2tk_base_draw_button(d2tk_core_t *core, ssize_t lbl_len, const char *lbl,
 	const d2tk_hash_dict_t dict [] = {
 		{ &triple, sizeof(d2tk_triple_t) },
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &align, sizeof(d2tk_align_t) },
 		{ (lbl ? lbl : path), (lbl ? lbl_len : path_len) },
 		{ path, path_len },
@@ -135,7 +136,7 @@ d2tk_base_button_label_image(d2tk_base_t *base, d2tk_id_t id, ssize_t lbl_len,
 	}
 
 	_d2tk_base_draw_button(base->core, lbl_len, lbl, align, path_len, path, rect,
-		triple, d2tk_base_get_style(base));
+		triple, d2tk_base_get_style(base), d2tk_base_get_style_hash(base));
 
 	return state;
 }
@@ -194,7 +195,7 @@ d2tk_base_toggle_label_image(d2tk_base_t *base, d2tk_id_t id, ssize_t lbl_len,
 	}
 
 	_d2tk_base_draw_button(base->core, lbl_len, lbl, align, path_len, path, rect,
-		triple, d2tk_base_get_style(base));
+		triple, d2tk_base_get_style(base), d2tk_base_get_style_hash(base));
 
 	return state;
 }
@@ -22,12 +22,12 @@
 static inline void
 _d2tk_base_draw_combo(d2tk_core_t *core, ssize_t nitms, const char **itms,
 	const d2tk_rect_t *rect, d2tk_state_t state, int32_t value,
-	const d2tk_style_t *style)
+	const d2tk_style_t *style, uint64_t style_hash)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ &state, sizeof(d2tk_state_t) },
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &value, sizeof(int32_t) },
 		{ &nitms, sizeof(ssize_t) },
 		{ itms, sizeof(const char **) }, //FIXME we should actually cache the labels
@@ -199,6 +199,7 @@ d2tk_base_combo(d2tk_base_t *base, d2tk_id_t id, ssize_t nitms,
 	const char **itms, const d2tk_rect_t *rect, int32_t *value)
 {
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	d2tk_state_t state = d2tk_base_is_active_hot(base, id, rect,
 		D2TK_FLAG_SCROLL_X | D2TK_FLAG_SCROLL_Y);
@@ -245,7 +246,8 @@ d2tk_base_combo(d2tk_base_t *base, d2tk_id_t id, ssize_t nitms,
 
 	d2tk_core_t *core = base->core;
 
-	_d2tk_base_draw_combo(core, nitms, itms, rect, state, *value, style);
+	_d2tk_base_draw_combo(core, nitms, itms, rect, state, *value, style,
+		style_hash);
 
 	return state;
 }
@@ -22,10 +22,11 @@ d2tk_base_cursor(d2tk_base_t *base, const d2tk_rect_t *rect)
 {
 	d2tk_core_t *core = base->core;
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	const d2tk_hash_dict_t dict [] = {
 		{ rect, sizeof(rect) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ NULL, 0 }
 	};
 	const uint64_t hash = d2tk_hash_dict(dict);
@@ -52,12 +52,13 @@ d2tk_base_dial_bool(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	}
 
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 	d2tk_core_t *core = base->core;
 
 	const d2tk_hash_dict_t dict [] = {
 		{ &state, sizeof(d2tk_state_t) },
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ value, sizeof(bool) },
 		{ NULL, 0 }
 	};
@@ -125,12 +126,13 @@ d2tk_base_dial_bool(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 
 static inline void
 _d2tk_base_draw_dial(d2tk_core_t *core, const d2tk_rect_t *rect,
-	d2tk_state_t state, float rel, const d2tk_style_t *style)
+	d2tk_state_t state, float rel, const d2tk_style_t *style,
+	uint64_t style_hash)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ &state, sizeof(d2tk_state_t) },
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &rel, sizeof(float) },
 		{ NULL, 0 }
 	};
@@ -253,7 +255,8 @@ d2tk_base_dial_int32(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	d2tk_clip_float(0.f, &rel, 1.f);
 
 	d2tk_core_t *core = base->core;
-	_d2tk_base_draw_dial(core, rect, state, rel, d2tk_base_get_style(base));
+	_d2tk_base_draw_dial(core, rect, state, rel, d2tk_base_get_style(base),
+		d2tk_base_get_style_hash(base));
 
 	return state;
 }
@@ -347,7 +350,8 @@ d2tk_base_dial_int64(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	d2tk_clip_float(0.f, &rel, 1.f);
 
 	d2tk_core_t *core = base->core;
-	_d2tk_base_draw_dial(core, rect, state, rel, d2tk_base_get_style(base));
+	_d2tk_base_draw_dial(core, rect, state, rel, d2tk_base_get_style(base),
+		d2tk_base_get_style_hash(base));
 
 	return state;
 }
@@ -396,7 +400,8 @@ d2tk_base_dial_float(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	d2tk_clip_float(0.f, &rel, 1.f);
 
 	d2tk_core_t *core = base->core;
-	_d2tk_base_draw_dial(core, rect, state, rel, d2tk_base_get_style(base));
+	_d2tk_base_draw_dial(core, rect, state, rel, d2tk_base_get_style(base),
+		d2tk_base_get_style_hash(base));
 
 	return state;
 }
@@ -496,7 +501,8 @@ d2tk_base_dial_double(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	d2tk_clip_float(0.f, &rel, 1.f);
 
 	d2tk_core_t *core = base->core;
-	_d2tk_base_draw_dial(core, rect, state, rel, d2tk_base_get_style(base));
+	_d2tk_base_draw_dial(core, rect, state, rel, d2tk_base_get_style(base),
+		d2tk_base_get_style_hash(base));
 
 	return state;
 }
@@ -95,6 +95,7 @@ _d2tk_flowmatrix_connect(d2tk_base_t *base, d2tk_flowmatrix_t *flowmatrix,
 	const d2tk_pos_t *src_pos, const d2tk_pos_t *dst_pos)
 {
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	d2tk_pos_t dst;
 	if(!dst_pos) // connect to mouse pointer
@@ -106,7 +107,7 @@ _d2tk_flowmatrix_connect(d2tk_base_t *base, d2tk_flowmatrix_t *flowmatrix,
 		{ flowmatrix, sizeof(d2tk_flowmatrix_t) },
 		{ src_pos, sizeof(d2tk_pos_t) },
 		{ dst_pos ? dst_pos : &dst, sizeof(d2tk_pos_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ NULL, 0 }
 	};
 	const uint64_t hash = d2tk_hash_dict(dict);
@@ -347,12 +348,13 @@ d2tk_flowmatrix_node_begin(d2tk_base_t *base, d2tk_flowmatrix_t *flowmatrix,
 	}
 
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	const d2tk_hash_dict_t dict [] = {
 		{ flowmatrix, sizeof(d2tk_flowmatrix_t) },
 		{ pos, sizeof(d2tk_pos_t) },
 		{ node, sizeof(d2tk_flowmatrix_node_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ NULL, 0 }
 	};
 	const uint64_t hash = d2tk_hash_dict(dict);
@@ -503,6 +505,7 @@ d2tk_flowmatrix_arc_begin(d2tk_base_t *base, d2tk_flowmatrix_t *flowmatrix,
 	arc->rect.h = arc->c_2;
 
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	const d2tk_hash_dict_t dict [] = {
 		{ flowmatrix, sizeof(d2tk_flowmatrix_t) },
@@ -512,7 +515,7 @@ d2tk_flowmatrix_arc_begin(d2tk_base_t *base, d2tk_flowmatrix_t *flowmatrix,
 		{ dst, sizeof(d2tk_pos_t) },
 		{ pos, sizeof(d2tk_pos_t) },
 		{ arc, sizeof(d2tk_flowmatrix_arc_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ NULL, 0 }
 	};
 	const uint64_t hash = d2tk_hash_dict(dict);
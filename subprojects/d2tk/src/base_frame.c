@@ -32,6 +32,7 @@ d2tk_frame_begin(d2tk_base_t *base, const d2tk_rect_t *rect,
 	const bool has_lbl = lbl_len && lbl;
 
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 	d2tk_core_t *core = base->core;
 	const d2tk_coord_t h = 17; //FIXME
 
@@ -42,7 +43,7 @@ d2tk_frame_begin(d2tk_base_t *base, const d2tk_rect_t *rect,
 
 	const d2tk_hash_dict_t dict [] = {
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ lbl, lbl_len },
 		{ NULL, 0 }
 	};
@@ -23,6 +23,7 @@
 
 #define _D2TK_MAX_ATOM 0x1000
 #define _D2TK_MASK_ATOMS (_D2TK_MAX_ATOM - 1)
+#define _D2TK_POLL_BATCH 32 // registered atoms per poll call
 
 typedef enum _d2tk_atom_type_t {
 	D2TK_ATOM_NONE,
@@ -41,6 +42,9 @@ typedef enum _d2tk_atom_type_t {
 typedef enum _d2tk_atom_event_type_t {
 	D2TK_ATOM_EVENT_NONE,
 	D2TK_ATOM_EVENT_FD,
+	D2TK_ATOM_EVENT_EVENTS, // poll events of interest, POLLIN if 0
+	D2TK_ATOM_EVENT_WRITE, // fd is ready for writing
+	D2TK_ATOM_EVENT_FD_AUX, // auxiliary fd to watch for readability
 	D2TK_ATOM_EVENT_DEINIT
 } d2tk_atom_event_type_t;
 
@@ -59,6 +63,7 @@ struct _d2tk_atom_t {
 	uint32_t ttl;
 	void *body;
 	d2tk_atom_event_t event;
+	uint32_t poller; // position in pollers + 1, 0 if not registered
 };
 
 struct _d2tk_base_t {
@@ -110,6 +115,8 @@ struct _d2tk_base_t {
 	} tooltip;
 
 	const d2tk_style_t *style;
+	uint64_t style_hash;
+	bool style_hashed;
 
 	atomic_bool again;
 	bool clear_focus;
@@ -118,6 +125,8 @@ struct _d2tk_base_t {
 	d2tk_core_t *core;
 
 	d2tk_atom_t atoms [_D2TK_MAX_ATOM];
+	uint16_t pollers [_D2TK_MAX_ATOM]; // atoms with an event callback
+	uint32_t npollers;
 };
 
 extern const size_t d2tk_atom_body_flow_sz;
@@ -142,6 +151,10 @@ _d2tk_base_is_active_hot_horizontal_scroll(d2tk_base_t *base);
 void
 _d2tk_base_clear_chars(d2tk_base_t *base);
 
+void
+_d2tk_base_set_style_hash(d2tk_base_t *base, const d2tk_style_t *style,
+	uint64_t hash);
+
 d2tk_state_t
 _d2tk_base_tooltip_draw(d2tk_base_t *base, ssize_t lbl_len, const char *lbl,
 	d2tk_coord_t h);
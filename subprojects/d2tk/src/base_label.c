@@ -31,10 +31,11 @@ d2tk_base_label(d2tk_base_t *base, ssize_t lbl_len, const char *lbl,
 	}
 
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	const d2tk_hash_dict_t dict [] = {
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &mul, sizeof(float) },
 		{ &align, sizeof(d2tk_align_t) },
 		{ lbl, lbl_len },
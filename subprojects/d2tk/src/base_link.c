@@ -22,7 +22,7 @@
 static void
 _d2tk_base_draw_link(d2tk_base_t *base, ssize_t lbl_len, const char *lbl,
 	float mul, const d2tk_rect_t *rect, d2tk_align_t align, d2tk_triple_t triple,
-	const d2tk_style_t *style)
+	const d2tk_style_t *style, uint64_t style_hash)
 {
 	const bool has_lbl = lbl_len && lbl;
 
@@ -34,7 +34,7 @@ _d2tk_base_draw_link(d2tk_base_t *base, ssize_t lbl_len, const char *lbl,
 	const d2tk_hash_dict_t dict [] = {
 		{ &triple, sizeof(d2tk_triple_t) },
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &mul, sizeof(float) },
 		{ &align, sizeof(d2tk_align_t) },
 		{ lbl, lbl_len },
@@ -116,7 +116,7 @@ d2tk_base_link(d2tk_base_t *base, d2tk_id_t id, ssize_t lbl_len, const char *lbl
 	}
 
 	_d2tk_base_draw_link(base, lbl_len, lbl, mul, rect, align, triple,
-		d2tk_base_get_style(base));
+		d2tk_base_get_style(base), d2tk_base_get_style_hash(base));
 
 	return state;
 }
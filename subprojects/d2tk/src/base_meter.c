@@ -23,12 +23,13 @@
 
 static inline void
 _d2tk_base_draw_meter(d2tk_core_t *core, const d2tk_rect_t *rect,
-	d2tk_state_t state, int32_t value, const d2tk_style_t *style)
+	d2tk_state_t state, int32_t value, const d2tk_style_t *style,
+	uint64_t style_hash)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ &state, sizeof(d2tk_state_t) },
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &value, sizeof(int32_t) },
 		{ NULL, 0 }
 	};
@@ -221,13 +222,14 @@ d2tk_base_meter(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	const int32_t *value)
 {
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	const d2tk_state_t state = d2tk_base_is_active_hot(base, id, rect,
 		D2TK_FLAG_NONE);
 
 	d2tk_core_t *core = base->core;
 
-	_d2tk_base_draw_meter(core, rect, state, *value, style);
+	_d2tk_base_draw_meter(core, rect, state, *value, style, style_hash);
 
 	return state;
 }
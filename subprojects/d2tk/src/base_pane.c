@@ -36,12 +36,12 @@ const size_t d2tk_pane_sz = sizeof(d2tk_pane_t);
 
 static void
 _d2tk_draw_pane(d2tk_core_t *core, d2tk_state_t state, const d2tk_rect_t *sub,
-	const d2tk_style_t *style, d2tk_flag_t flags)
+	const d2tk_style_t *style, uint64_t style_hash, d2tk_flag_t flags)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ &state, sizeof(d2tk_state_t) },
 		{ sub, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &flags, sizeof(d2tk_flag_t) },
 		{ NULL, 0 }
 	};
@@ -207,10 +207,11 @@ d2tk_pane_begin(d2tk_base_t *base, const d2tk_rect_t *rect, d2tk_id_t id,
 	}
 
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	d2tk_core_t *core = base->core;
 
-	_d2tk_draw_pane(core, state, &sub, style, flags);
+	_d2tk_draw_pane(core, state, &sub, style, style_hash, flags);
 
 	return pane;
 }
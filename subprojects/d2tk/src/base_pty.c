@@ -22,11 +22,16 @@
 #include <fcntl.h>
 #include <vterm.h>
 #include <pty.h>
-#include <utmp.h>
-#include <sched.h>
+#include <spawn.h>
 #include <limits.h>
+#include <time.h>
+#include <unistd.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdatomic.h>
 
@@ -38,6 +43,11 @@
 #define DEFAULT_FG_LIGHT 0xdddddd7f
 #define DEFAULT_BG_LIGHT 0x2222227f
 
+#define DEFAULT_BG_VTERM 0x000000ff
+
+#define MATCH_FG 0x222222ff
+#define MATCH_BG 0xddbb44ff
+
 #define NROWS_MAX 512
 #define NCOLS_MAX 512
 
@@ -48,12 +58,59 @@
 #define FONT_CODE_MEDIUM  "FiraCode:medium"
 #define FONT_CODE_BOLD    "FiraCode:bold"
 
+#define SB_ARENA_SIZE  0x800000 // 8 MiB, must be a power of two
+#define SB_ARENA_MASK  (SB_ARENA_SIZE - 1)
+#define SB_LINES_MAX   0x20000 // must be a power of two
+#define SB_LINES_MASK  (SB_LINES_MAX - 1)
+#define SB_SCROLL_STEP 3
+
+#define SB_ATTR_BOLD    (1 << 0)
+#define SB_ATTR_ITALIC  (1 << 1)
+#define SB_ATTR_REVERSE (1 << 2)
+
+#define SEARCH_QUERY_MAX   256
+#define SEARCH_MATCHES_MAX 0x1000
+#define SEARCH_BUDGET      0x100000 // bytes scanned per frame
+
+#define AC_PATTERNS_MAX 32
+#define AC_STATES_MAX   0x1000
+#define AC_NONE         UINT16_MAX
+
+#define OUT_RING_SIZE    0x10000 // must be a power of two
+#define OUT_RING_MASK    (OUT_RING_SIZE - 1)
+#define OUT_RING_RESERVE 0x20 // for end of bracketed paste
+#define PASTE_END        "\033[201~"
+#define PASTE_END_LEN    (sizeof(PASTE_END) - 1)
+
+#define MOUSE_BUTTONS    3
+#define MOUSE_SCROLL_MAX 8 // wheel events per frame, the rest is carried over
+
+#define REC_MAGIC     "d2tkpty1"
+#define REC_CHUNK     0x100000 // grow log in 1 MiB steps
+#define REC_ALIGN     8
+#define REPLAY_BUDGET 0x10000 // bytes replayed per frame at maximum speed
+
+#define REAPERS_MAX 0x20
+#define REAP_TERM_NS   250000000 // SIGTERM after 250ms
+#define REAP_KILL_NS  1000000000 // SIGKILL after 1s
+#define REAP_POLL_NS    10000000 // waitpid polling without pidfd
+
 typedef struct _col_t col_t;
 typedef struct _cell_t cell_t;
 typedef struct _d2tk_atom_body_pty_t d2tk_atom_body_pty_t;
 typedef struct _d2tk_pty_t d2tk_pty_t;
 typedef struct _thread_data_t thread_data_t;
-typedef struct _clone_data_t clone_data_t;
+typedef struct _env_t env_t;
+typedef struct _rec_hdr_t rec_hdr_t;
+typedef struct _rec_evt_t rec_evt_t;
+typedef struct _rec_t rec_t;
+typedef struct _mouse_t mouse_t;
+typedef struct _sb_run_t sb_run_t;
+typedef struct _sb_line_t sb_line_t;
+typedef struct _sb_t sb_t;
+typedef struct _search_t search_t;
+typedef struct _ac_t ac_t;
+typedef struct _out_t out_t;
 
 struct _col_t {
 	uint8_t r;
@@ -68,6 +125,7 @@ struct _cell_t {
 	bool italic;
 	bool reverse;
 	bool cursor;
+	bool match;
 	uint32_t fg;
 	uint32_t bg;
 };
@@ -79,10 +137,125 @@ struct _thread_data_t {
 	atomic_bool running;
 };
 
-struct _clone_data_t {
-	int master;
-	int slave;
-	void *data;
+typedef enum _rec_type_t {
+	REC_TYPE_INPUT = 0,
+	REC_TYPE_RESIZE
+} rec_type_t;
+
+struct _rec_hdr_t {
+	char magic [8];
+	uint32_t ncols;
+	uint32_t nrows;
+};
+
+struct _rec_evt_t {
+	uint64_t time; // ns since start of recording
+	uint32_t type;
+	uint32_t len;
+	uint8_t buf [];
+	// padded to REC_ALIGN
+};
+
+struct _rec_t {
+	int fd;
+	uint8_t *map;
+	size_t size; // mapped size
+	size_t off; // end of log when recording, replay position otherwise
+	uint64_t t0;
+	bool replay;
+	bool fast;
+};
+
+struct _mouse_t {
+	bool hot;
+	int row;
+	int col;
+	bool btn [MOUSE_BUTTONS];
+	int32_t scroll; // pending wheel steps
+};
+
+struct _env_t {
+	pthread_once_t once;
+	char **envp;
+	char *block;
+};
+
+struct _sb_run_t {
+	uint16_t ncells;
+	uint16_t attrs;
+	uint32_t fg;
+	uint32_t bg;
+};
+
+struct _sb_line_t {
+	uint16_t ncols;
+	uint16_t ncells; // trailing blank cells are not stored
+	uint16_t nruns;
+	uint16_t len;
+	sb_run_t runs [];
+	// followed by len bytes of utf8 text, one codepoint per cell
+};
+
+struct _sb_t {
+	uint8_t *arena;
+	uint32_t *lines; // virtual offsets into arena
+	uint32_t head; // virtual write offset into arena
+	uint32_t first;
+	uint32_t nlines;
+	uint32_t offset; // number of lines scrolled back
+};
+
+struct _search_t {
+	bool active;
+	bool done;
+	size_t query_len;
+	char query [SEARCH_QUERY_MAX];
+	uint32_t scan; // line number to continue scanning downwards from
+	uint32_t match;
+	uint32_t nmatches;
+	uint32_t matches [SEARCH_MATCHES_MAX]; // line numbers, newest first
+};
+
+struct _ac_t {
+	uint64_t hash;
+	uint16_t (*delta)[0x100];
+	uint32_t *out; // pattern mask per state
+	size_t nstates;
+	uint16_t state;
+	uint32_t matches;
+};
+
+struct _out_t {
+	size_t head; // monotonic write offset into ring
+	size_t tail; // monotonic read offset into ring
+	char *paste;
+	size_t paste_len;
+	size_t paste_off;
+	char ring [OUT_RING_SIZE];
+};
+
+typedef struct _reaper_t reaper_t;
+
+struct _reaper_t {
+	pid_t pid;
+	int pidfd;
+	int signo;
+	uint64_t t0;
+};
+
+// children outlive their widget until they are reaped, hence process-wide
+static pthread_mutex_t reapers_lock = PTHREAD_MUTEX_INITIALIZER;
+static reaper_t reapers [REAPERS_MAX];
+static atomic_uint nreapers = ATOMIC_VAR_INIT(0);
+static pthread_t reapers_thread;
+static bool reapers_running = false; // thread is stepping the timeline
+static bool reapers_joinable = false; // thread has yet to be joined
+
+// child environment, prepared once per process
+static env_t env = {
+	.once = PTHREAD_ONCE_INIT,
+	.envp = NULL,
+	.block = NULL
 };
 
 struct _d2tk_atom_body_pty_t {
@@ -94,7 +267,9 @@ struct _d2tk_atom_body_pty_t {
 	bool hasmouse;
 
 	int fd;
+	int pidfd;
 	ptrdiff_t kid;
+	uint64_t spawn_ns;
 
 	thread_data_t thread_data;
 	bool is_threaded;
@@ -113,11 +288,21 @@ struct _d2tk_atom_body_pty_t {
 	col_t max_green;
 	col_t max_blue;
 
+	sb_t sb;
+	search_t search;
+	rec_t rec;
+	rec_t replay;
+	ac_t ac;
+	out_t out;
+	mouse_t mouse;
+	bool dirty;
+
 	cell_t cells [NROWS_MAX][NCOLS_MAX];
 };
 
 struct _d2tk_pty_t {
 	d2tk_state_t state;
+	uint32_t matches;
 	d2tk_atom_body_pty_t *vpty;
 };
 
@@ -130,134 +315,1498 @@ _term_dark(d2tk_atom_body_pty_t *vpty)
 	return vpty->dark;
 }
 
-static inline uint32_t
-_term_light(d2tk_atom_body_pty_t *vpty)
-{
-	return vpty->light;
+static inline uint32_t
+_term_light(d2tk_atom_body_pty_t *vpty)
+{
+	return vpty->light;
+}
+
+static void
+_ac_deinit(ac_t *ac)
+{
+	free(ac->delta);
+	free(ac->out);
+
+	memset(ac, 0x0, sizeof(ac_t));
+}
+
+// compile patterns into a full Aho-Corasick transition table
+static int
+_ac_init(ac_t *ac, const char **patterns, uint64_t hash)
+{
+	size_t nstates = 1; // root
+
+	_ac_deinit(ac);
+	ac->hash = hash;
+
+	for(unsigned i = 0; (i < AC_PATTERNS_MAX) && patterns[i]; i++)
+	{
+		nstates += strlen(patterns[i]);
+	}
+
+	if(nstates > AC_STATES_MAX)
+	{
+		fprintf(stderr, "[%s] patterns too long, truncating\n", __func__);
+		nstates = AC_STATES_MAX;
+	}
+
+	uint16_t *fail = calloc(nstates, sizeof(uint16_t));
+	uint16_t *queue = calloc(nstates, sizeof(uint16_t));
+	ac->delta = malloc(nstates * sizeof(*ac->delta));
+	ac->out = calloc(nstates, sizeof(uint32_t));
+
+	if(!fail || !queue || !ac->delta || !ac->out)
+	{
+		free(fail);
+		free(queue);
+		_ac_deinit(ac);
+		return 1;
+	}
+
+	memset(ac->delta, 0xff, nstates * sizeof(*ac->delta)); // AC_NONE
+	ac->nstates = 1;
+
+	// build trie
+	for(unsigned i = 0; (i < AC_PATTERNS_MAX) && patterns[i]; i++)
+	{
+		const uint8_t *pattern = (const uint8_t *)patterns[i];
+		uint16_t s = 0;
+
+		if(*pattern == '\0')
+		{
+			continue; // empty patterns never match
+		}
+
+		for( ; *pattern; pattern++)
+		{
+			if(ac->delta[s][*pattern] == AC_NONE)
+			{
+				if(ac->nstates == nstates)
+				{
+					break;
+				}
+
+				ac->delta[s][*pattern] = ac->nstates++;
+			}
+
+			s = ac->delta[s][*pattern];
+		}
+
+		if(*pattern == '\0')
+		{
+			ac->out[s] |= (1U << i);
+		}
+	}
+
+	// resolve failure links breadth-first into transitions
+	size_t head = 0;
+	size_t tail = 0;
+
+	for(unsigned c = 0; c < 0x100; c++)
+	{
+		const uint16_t u = ac->delta[0][c];
+
+		if(u == AC_NONE)
+		{
+			ac->delta[0][c] = 0;
+		}
+		else
+		{
+			fail[u] = 0;
+			queue[tail++] = u;
+		}
+	}
+
+	while(head < tail)
+	{
+		const uint16_t r = queue[head++];
+
+		ac->out[r] |= ac->out[fail[r]];
+
+		for(unsigned c = 0; c < 0x100; c++)
+		{
+			const uint16_t u = ac->delta[r][c];
+
+			if(u == AC_NONE)
+			{
+				ac->delta[r][c] = ac->delta[fail[r]][c];
+			}
+			else
+			{
+				fail[u] = ac->delta[fail[r]][c];
+				queue[tail++] = u;
+			}
+		}
+	}
+
+	free(fail);
+	free(queue);
+
+	return 0;
+}
+
+static inline void
+_ac_feed(ac_t *ac, const char *buf, size_t len)
+{
+	if(!ac->delta)
+	{
+		return;
+	}
+
+	const uint8_t *src = (const uint8_t *)buf;
+	uint16_t s = ac->state;
+	uint32_t matches = 0;
+
+	for(size_t i = 0; i < len; i++)
+	{
+		s = ac->delta[s][src[i]];
+		matches |= ac->out[s];
+	}
+
+	ac->state = s;
+	ac->matches |= matches;
+}
+
+static inline uint64_t
+_now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+static void
+_rec_deinit(rec_t *rec)
+{
+	if(rec->map)
+	{
+		munmap(rec->map, rec->size);
+	}
+
+	if(rec->fd > 0)
+	{
+		if(!rec->replay && (rec->off < rec->size) )
+		{
+			// drop unused tail of the last chunk
+			if(ftruncate(rec->fd, rec->off) == -1)
+			{
+				fprintf(stderr, "[%s] ftruncate failed '%s'\n", __func__, strerror(errno));
+			}
+		}
+
+		close(rec->fd);
+	}
+
+	memset(rec, 0x0, sizeof(rec_t));
+}
+
+static int
+_rec_reserve(rec_t *rec, size_t len)
+{
+	if(rec->off + len <= rec->size)
+	{
+		return 0;
+	}
+
+	const size_t size = (rec->off + len + REC_CHUNK - 1) & ~(size_t)(REC_CHUNK - 1);
+
+	if(ftruncate(rec->fd, size) == -1)
+	{
+		fprintf(stderr, "[%s] ftruncate failed '%s'\n", __func__, strerror(errno));
+		return 1;
+	}
+
+	uint8_t *map = rec->map
+		? mremap(rec->map, rec->size, size, MREMAP_MAYMOVE)
+		: mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, rec->fd, 0);
+
+	if(map == MAP_FAILED)
+	{
+		fprintf(stderr, "[%s] mmap failed '%s'\n", __func__, strerror(errno));
+		return 1;
+	}
+
+	rec->map = map;
+	rec->size = size;
+
+	return 0;
+}
+
+static void
+_rec_append(rec_t *rec, rec_type_t type, const void *buf, size_t len)
+{
+	if(!rec->map)
+	{
+		return;
+	}
+
+	const size_t sz = (sizeof(rec_evt_t) + len + REC_ALIGN - 1)
+		& ~(size_t)(REC_ALIGN - 1);
+
+	if(_rec_reserve(rec, sz) != 0)
+	{
+		_rec_deinit(rec);
+		return;
+	}
+
+	rec_evt_t *evt = (rec_evt_t *)&rec->map[rec->off];
+
+	evt->time = _now() - rec->t0;
+	evt->type = type;
+	evt->len = len;
+	memcpy(evt->buf, buf, len);
+
+	rec->off += sz;
+}
+
+static int
+_rec_init(rec_t *rec, const char *path, d2tk_coord_t ncols, d2tk_coord_t nrows)
+{
+	rec->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+	if(rec->fd == -1)
+	{
+		fprintf(stderr, "[%s] open failed '%s'\n", __func__, strerror(errno));
+		rec->fd = 0;
+		return 1;
+	}
+
+	if(_rec_reserve(rec, sizeof(rec_hdr_t)) != 0)
+	{
+		_rec_deinit(rec);
+		return 1;
+	}
+
+	rec_hdr_t *hdr = (rec_hdr_t *)rec->map;
+
+	memcpy(hdr->magic, REC_MAGIC, sizeof(hdr->magic));
+	hdr->ncols = ncols;
+	hdr->nrows = nrows;
+
+	rec->off = sizeof(rec_hdr_t);
+	rec->t0 = _now();
+
+	return 0;
+}
+
+static int
+_replay_init(rec_t *rec, const char *path, bool fast,
+	d2tk_coord_t *ncols, d2tk_coord_t *nrows)
+{
+	struct stat st;
+
+	rec->replay = true;
+	rec->fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if(rec->fd == -1)
+	{
+		fprintf(stderr, "[%s] open failed '%s'\n", __func__, strerror(errno));
+		rec->fd = 0;
+		return 1;
+	}
+
+	if( (fstat(rec->fd, &st) == -1) || ((size_t)st.st_size < sizeof(rec_hdr_t)) )
+	{
+		fprintf(stderr, "[%s] invalid log '%s'\n", __func__, path);
+		_rec_deinit(rec);
+		return 1;
+	}
+
+	rec->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, rec->fd, 0);
+
+	if(rec->map == MAP_FAILED)
+	{
+		fprintf(stderr, "[%s] mmap failed '%s'\n", __func__, strerror(errno));
+		rec->map = NULL;
+		_rec_deinit(rec);
+		return 1;
+	}
+
+	rec->size = st.st_size;
+
+	const rec_hdr_t *hdr = (const rec_hdr_t *)rec->map;
+
+	if(  (memcmp(hdr->magic, REC_MAGIC, sizeof(hdr->magic)) != 0)
+		|| (hdr->ncols == 0) || (hdr->ncols > NCOLS_MAX)
+		|| (hdr->nrows == 0) || (hdr->nrows > NROWS_MAX) )
+	{
+		fprintf(stderr, "[%s] invalid log '%s'\n", __func__, path);
+		_rec_deinit(rec);
+		return 1;
+	}
+
+	*ncols = hdr->ncols;
+	*nrows = hdr->nrows;
+
+	rec->fast = fast;
+	rec->off = sizeof(rec_hdr_t);
+	rec->t0 = _now();
+
+	return 0;
+}
+
+static inline bool
+_replay_done(rec_t *rec)
+{
+	return rec->off + sizeof(rec_evt_t) > rec->size;
+}
+
+static inline int
+_term_read(d2tk_atom_body_pty_t *vpty,
+	void (*cb)(const char *buf, size_t len, void *data), void *data)
+{
+	char buf [4096];
+	int count = 0;
+
+	while(true)
+	{
+		const ssize_t len = read(vpty->fd, buf, sizeof(buf));
+
+		if(len == -1)
+		{
+			if(errno != EAGAIN)
+			{
+				//FIXME fprintf(stderr, "[%s] read failed '%s'\n", __func__, strerror(errno));
+			}
+			break;
+		}
+
+		if(len == 0)
+		{
+			break;;
+		}
+
+		_ac_feed(&vpty->ac, buf, len);
+		_rec_append(&vpty->rec, REC_TYPE_INPUT, buf, len);
+
+		cb(buf, len, data);
+		count += 1;
+	}
+
+	return count;
+}
+
+static inline void
+_term_clear(d2tk_atom_body_pty_t *vpty)
+{
+	vpty->kid = 0;
+	atomic_store(&vpty->thread_data.running, false);;
+}
+
+static inline int
+_pidfd_open(pid_t pid)
+{
+#if defined(SYS_pidfd_open)
+	const int pidfd = syscall(SYS_pidfd_open, pid, 0);
+
+	if(pidfd > 0)
+	{
+		return pidfd; // always close-on-exec
+	}
+#else
+	(void)pid;
+#endif
+
+	return 0; // fall back to waitpid polling
+}
+
+static inline bool
+_pidfd_ready(int pidfd)
+{
+	struct pollfd fds = {
+		.fd = pidfd,
+		.events = POLLIN,
+		.revents = 0
+	};
+
+	return (poll(&fds, 1, 0) == 1) && (fds.revents & POLLIN);
+}
+
+static inline bool
+_reap(pid_t pid, int pidfd)
+{
+	if( (pidfd > 0) && !_pidfd_ready(pidfd) )
+	{
+		return false;
+	}
+
+	int stat = 0;
+	const pid_t kid = waitpid(pid, &stat, WNOHANG);
+
+	if(kid == 0)
+	{
+		return false;
+	}
+
+	if(kid == -1)
+	{
+		// e.g. ECHILD, nothing left to wait for
+		return (errno != EINTR);
+	}
+
+	// has exited
+	if(WIFSIGNALED(stat))
+	{
+#if D2TK_DEBUG == 1
+		fprintf(stderr, "[%s] child with pid %d has exited with signal %d\n",
+			__func__, pid, WTERMSIG(stat));
+#endif
+	}
+	else if(WIFEXITED(stat))
+	{
+#if D2TK_DEBUG == 1
+		fprintf(stderr, "[%s] child with pid %d has exited with status %d\n",
+			__func__, pid, WEXITSTATUS(stat));
+#endif
+	}
+
+	return true;
+}
+
+// advance the escalation timeline of orphaned children, never blocks
+static void
+_reapers_step()
+{
+	if(atomic_load(&nreapers) == 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&reapers_lock);
+
+	const uint64_t now = _now();
+	unsigned n = atomic_load(&nreapers);
+
+	for(unsigned i = 0; i < n; )
+	{
+		reaper_t *reaper = &reapers[i];
+
+		if(_reap(reaper->pid, reaper->pidfd))
+		{
+			if(reaper->pidfd > 0)
+			{
+				close(reaper->pidfd);
+			}
+
+			reapers[i] = reapers[--n];
+			continue;
+		}
+
+		const uint64_t dt = now - reaper->t0;
+		const int signo = (dt >= REAP_KILL_NS)
+			? SIGKILL
+			: (dt >= REAP_TERM_NS)
+				? SIGTERM
+				: 0;
+
+		if(signo && (signo != reaper->signo) )
+		{
+			kill(reaper->pid, signo);
+			reaper->signo = signo;
+		}
+
+		i++;
+	}
+
+	atomic_store(&nreapers, n);
+
+	pthread_mutex_unlock(&reapers_lock);
+}
+
+// time left until the next escalation step or reap attempt
+static uint64_t
+_reapers_timeout(uint64_t now, struct pollfd *fds, nfds_t *nfds)
+{
+	const unsigned n = atomic_load(&nreapers);
+	uint64_t timeout = REAP_KILL_NS;
+
+	*nfds = 0;
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		const reaper_t *reaper = &reapers[i];
+		const uint64_t dt = now - reaper->t0;
+		const uint64_t deadline = (reaper->signo == 0)
+			? REAP_TERM_NS
+			: (reaper->signo == SIGTERM)
+				? REAP_KILL_NS
+				: UINT64_MAX;
+		uint64_t left = (deadline == UINT64_MAX)
+			? REAP_KILL_NS
+			: (dt < deadline)
+				? deadline - dt
+				: 0;
+
+		if(reaper->pidfd > 0)
+		{
+			fds[*nfds].fd = reaper->pidfd;
+			fds[*nfds].events = POLLIN;
+			fds[*nfds].revents = 0;
+			*nfds += 1;
+		}
+		else if(left > REAP_POLL_NS)
+		{
+			left = REAP_POLL_NS;
+		}
+
+		if(left < timeout)
+		{
+			timeout = left;
+		}
+	}
+
+	return timeout;
+}
+
+// steps the timeline independent of frames, exits once all children are gone
+static void *
+_reapers_thread(void *data __attribute__((unused)))
+{
+	struct pollfd fds [REAPERS_MAX];
+
+	while(true)
+	{
+		_reapers_step();
+
+		pthread_mutex_lock(&reapers_lock);
+
+		if(atomic_load(&nreapers) == 0)
+		{
+			reapers_running = false;
+			pthread_mutex_unlock(&reapers_lock);
+			break;
+		}
+
+		nfds_t nfds;
+		const uint64_t timeout = _reapers_timeout(_now(), fds, &nfds);
+
+		pthread_mutex_unlock(&reapers_lock);
+
+		// wakes up early on exit of a child with pidfd
+		poll(fds, nfds, (timeout + 999999) / 1000000);
+	}
+
+	return NULL;
+}
+
+static void
+_reapers_add(pid_t pid, int pidfd)
+{
+	pthread_mutex_lock(&reapers_lock);
+
+	const unsigned n = atomic_load(&nreapers);
+
+	if(n < REAPERS_MAX)
+	{
+		reapers[n] = (reaper_t){
+			.pid = pid,
+			.pidfd = pidfd,
+			.signo = 0,
+			.t0 = _now()
+		};
+
+		atomic_store(&nreapers, n + 1);
+		pid = 0;
+
+		if(!reapers_running)
+		{
+			// previous thread has left its loop already
+			if(reapers_joinable)
+			{
+				pthread_join(reapers_thread, NULL);
+				reapers_joinable = false;
+			}
+
+			if(pthread_create(&reapers_thread, NULL, _reapers_thread, NULL) == 0)
+			{
+				reapers_running = true;
+				reapers_joinable = true;
+			}
+			else
+			{
+				// nobody to step the timeline, escalate right away
+				pid = reapers[n].pid;
+				pidfd = reapers[n].pidfd;
+				atomic_store(&nreapers, n);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&reapers_lock);
+
+	if(pid)
+	{
+		fprintf(stderr, "[%s] too many pending children, killing %d\n",
+			__func__, pid);
+
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+
+		if(pidfd > 0)
+		{
+			close(pidfd);
+		}
+	}
+}
+
+// last resort on unload: the thread must be gone before the code is
+__attribute__((destructor)) static void
+_reapers_flush()
+{
+	pthread_mutex_lock(&reapers_lock);
+
+	for(unsigned i = 0; i < atomic_load(&nreapers); i++)
+	{
+		reaper_t *reaper = &reapers[i];
+
+		kill(reaper->pid, SIGKILL);
+		reaper->signo = SIGKILL;
+	}
+
+	const bool joinable = reapers_joinable;
+	reapers_joinable = false;
+
+	pthread_mutex_unlock(&reapers_lock);
+
+	// exits as soon as the killed children have been reaped
+	if(joinable)
+	{
+		pthread_join(reapers_thread, NULL);
+	}
+
+	pthread_mutex_lock(&reapers_lock);
+
+	const unsigned n = atomic_load(&nreapers);
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		reaper_t *reaper = &reapers[i];
+
+		kill(reaper->pid, SIGKILL);
+		waitpid(reaper->pid, NULL, 0);
+
+		if(reaper->pidfd > 0)
+		{
+			close(reaper->pidfd);
+		}
+	}
+
+	atomic_store(&nreapers, 0);
+
+	pthread_mutex_unlock(&reapers_lock);
+}
+
+static inline int
+_term_done_thread(d2tk_atom_body_pty_t *vpty)
+{
+	if(atomic_load(&vpty->thread_data.running))
+	{
+		return 0;
+	}
+
+	pthread_join(vpty->kid, NULL);
+
+#if D2TK_DEBUG == 1
+				fprintf(stderr, "[%s] child with pid %ld has exited\n",
+					__func__, vpty->kid);
+#endif
+
+	_term_clear(vpty);
+	return 1;
+}
+
+static inline int
+_term_done_fork(d2tk_atom_body_pty_t *vpty)
+{
+	// only touch waitpid once the pidfd has signaled the exit
+	if(!_reap(vpty->kid, vpty->pidfd))
+	{
+		return 0;
+	}
+
+	if(vpty->pidfd > 0)
+	{
+		close(vpty->pidfd);
+		vpty->pidfd = 0;
+	}
+
+	_term_clear(vpty);
+	return 1;
+}
+
+static inline int
+_term_done(d2tk_atom_body_pty_t *vpty)
+{
+	if(vpty->replay.map)
+	{
+		return _replay_done(&vpty->replay);
+	}
+
+	if(vpty->kid == 0)
+	{
+		return 1;
+	}
+
+	return vpty->is_threaded
+		? _term_done_thread(vpty)
+		: _term_done_fork(vpty);
+}
+
+static inline bool
+_term_pending(d2tk_atom_body_pty_t *vpty)
+{
+	return (vpty->out.head != vpty->out.tail) || vpty->out.paste;
+}
+
+static void
+_term_flush(d2tk_atom_body_pty_t *vpty)
+{
+	out_t *out = &vpty->out;
+
+	if(!vpty->fd)
+	{
+		out->tail = out->head; // nobody to talk to when replaying
+		return;
+	}
+
+	while(out->tail != out->head)
+	{
+		const size_t off = out->tail & OUT_RING_MASK;
+		size_t len = out->head - out->tail;
+
+		if(off + len > OUT_RING_SIZE)
+		{
+			len = OUT_RING_SIZE - off;
+		}
+
+		const ssize_t writ = write(vpty->fd, &out->ring[off], len);
+
+		if(writ == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			if(errno != EAGAIN)
+			{
+				fprintf(stderr, "[%s] write failed '%s'\n", __func__, strerror(errno));
+				out->tail = out->head;
+			}
+
+			break; // wait for POLLOUT
+		}
+
+		out->tail += writ;
+	}
+}
+
+static void
+_term_paste_free(out_t *out)
+{
+	free(out->paste);
+
+	out->paste = NULL;
+	out->paste_len = 0;
+	out->paste_off = 0;
+}
+
+static void
+_term_paste_fill(d2tk_atom_body_pty_t *vpty)
+{
+	out_t *out = &vpty->out;
+
+	if(!out->paste)
+	{
+		return;
+	}
+
+	size_t space = OUT_RING_SIZE - (out->head - out->tail);
+
+	while( (space > OUT_RING_RESERVE) && (out->paste_off < out->paste_len) )
+	{
+		const char *end = &out->paste[out->paste_off];
+
+		// drop embedded end markers, they would end bracketed mode early
+		if( (out->paste_len - out->paste_off >= PASTE_END_LEN)
+			&& !memcmp(end, PASTE_END, PASTE_END_LEN) )
+		{
+			out->paste_off += PASTE_END_LEN;
+			continue;
+		}
+
+		const char chr = out->paste[out->paste_off++];
+
+		out->ring[out->head++ & OUT_RING_MASK] = (chr == '\n') ? '\r' : chr;
+		space--;
+	}
+
+	if( (out->paste_off == out->paste_len) && (space > OUT_RING_RESERVE) )
+	{
+		_term_paste_free(out);
+
+		vterm_keyboard_end_paste(vpty->vterm);
+	}
+}
+
+static void
+_term_pump(d2tk_atom_body_pty_t *vpty)
+{
+	out_t *out = &vpty->out;
+	size_t tail;
+
+	// stream paste through ring until the pty stops accepting bytes
+	do {
+		_term_paste_fill(vpty);
+
+		tail = out->tail;
+		_term_flush(vpty);
+	} while(out->paste && (out->tail != tail));
+}
+
+static void
+_term_output(const char *buf, size_t len, void *data)
+{
+	d2tk_atom_body_pty_t *vpty = data;
+	out_t *out = &vpty->out;
+
+	if(out->head - out->tail + len > OUT_RING_SIZE)
+	{
+		fprintf(stderr, "[%s] output ring overflow, dropping %zu bytes\n",
+			__func__, len);
+		return;
+	}
+
+	for(size_t i = 0; i < len; )
+	{
+		const size_t off = out->head & OUT_RING_MASK;
+		const size_t chunk = (off + len - i > OUT_RING_SIZE)
+			? OUT_RING_SIZE - off
+			: len - i;
+
+		memcpy(&out->ring[off], &buf[i], chunk);
+		out->head += chunk;
+		i += chunk;
+	}
+
+	_term_flush(vpty);
+}
+
+static inline uint32_t
+_term_color_to_rgba(d2tk_atom_body_pty_t *vpty, const VTermColor *col, bool fg)
+{
+	VTermColor tmp = *col;
+
+	if(VTERM_COLOR_IS_RGB(&tmp))
+	{
+		// nothing to do
+	}
+	else if(VTERM_COLOR_IS_INDEXED(&tmp))
+	{
+		vterm_screen_convert_color_to_rgb(vpty->screen, &tmp);
+	}
+	else if(VTERM_COLOR_IS_DEFAULT_FG(&tmp))
+	{
+		return fg ? DEFAULT_FG : 0xffffffff;
+	}
+	else if(VTERM_COLOR_IS_DEFAULT_BG(&tmp))
+	{
+		return fg ? DEFAULT_BG : DEFAULT_BG_VTERM;
+	}
+	else
+	{
+		return 0x0;
+	}
+
+	return (tmp.rgb.red << 24)
+		| (tmp.rgb.green << 16)
+		| (tmp.rgb.blue << 8)
+		| 0xff;
+}
+
+static inline void
+_term_color_from_rgba(uint32_t rgba, VTermColor *col)
+{
+	vterm_color_rgb(col, (rgba >> 24) & 0xff, (rgba >> 16) & 0xff,
+		(rgba >> 8) & 0xff);
+}
+
+static inline void
+_term_cell_from_vterm(d2tk_atom_body_pty_t *vpty, const VTermScreenCell *cell,
+	cell_t *tar)
+{
+	if( cell->chars[0] && (cell->width == 1) )
+	{
+		if(cell->chars[0] != ' ')
+		{
+			const char *tail = utf8catcodepoint(tar->lbl,
+				cell->chars[0], sizeof(tar->lbl));
+
+			tar->lbl_len = tail - tar->lbl;
+		}
+	}
+
+	tar->bold = cell->attrs.bold;
+	tar->italic = cell->attrs.italic;
+	tar->reverse = cell->attrs.reverse;
+	tar->fg = _term_color_to_rgba(vpty, &cell->fg, true);
+	tar->bg = _term_color_to_rgba(vpty, &cell->bg, false);
+}
+
+static inline void
+_term_cell_to_vterm(const cell_t *src, VTermScreenCell *cell)
+{
+	memset(cell, 0x0, sizeof(VTermScreenCell));
+
+	if(src->lbl_len)
+	{
+		utf8_int32_t chr = 0;
+
+		utf8codepoint(src->lbl, &chr);
+		cell->chars[0] = chr;
+	}
+
+	cell->width = 1;
+	cell->attrs.bold = src->bold;
+	cell->attrs.italic = src->italic;
+	cell->attrs.reverse = src->reverse;
+	_term_color_from_rgba(src->fg, &cell->fg);
+	_term_color_from_rgba(src->bg, &cell->bg);
+}
+
+static inline void
+_term_cell_blank(cell_t *tar)
+{
+	memset(tar, 0x0, sizeof(cell_t));
+
+	tar->fg = DEFAULT_FG;
+	tar->bg = DEFAULT_BG_VTERM;
+}
+
+static inline uint16_t
+_sb_cell_attrs(const cell_t *cell)
+{
+	return (cell->bold ? SB_ATTR_BOLD : 0)
+		| (cell->italic ? SB_ATTR_ITALIC : 0)
+		| (cell->reverse ? SB_ATTR_REVERSE : 0);
+}
+
+static inline bool
+_sb_cell_is_blank(const cell_t *cell)
+{
+	return (cell->lbl_len == 0)
+		&& !cell->reverse
+		&& (cell->bg == DEFAULT_BG_VTERM);
+}
+
+static inline bool
+_sb_run_matches(const sb_run_t *run, const cell_t *cell)
+{
+	return (run->attrs == _sb_cell_attrs(cell))
+		&& (run->fg == cell->fg)
+		&& (run->bg == cell->bg);
+}
+
+static void
+_sb_deinit(sb_t *sb)
+{
+	free(sb->arena);
+	free(sb->lines);
+
+	memset(sb, 0x0, sizeof(sb_t));
+}
+
+static int
+_sb_init(sb_t *sb)
+{
+	memset(sb, 0x0, sizeof(sb_t));
+
+	// pages are only committed once touched
+	sb->arena = malloc(SB_ARENA_SIZE);
+	sb->lines = malloc(SB_LINES_MAX * sizeof(uint32_t));
+
+	if(!sb->arena || !sb->lines)
+	{
+		_sb_deinit(sb);
+		return 1;
+	}
+
+	return 0;
+}
+
+static inline uint32_t
+_sb_virt(const sb_t *sb, uint32_t idx)
+{
+	return sb->lines[(sb->first + idx) & SB_LINES_MASK];
+}
+
+static inline const char *
+_sb_text(const sb_line_t *line)
+{
+	return (const char *)&line->runs[line->nruns];
+}
+
+static inline uint32_t
+_sb_line_size(unsigned nruns, size_t len)
+{
+	return D2TK_PAD_SIZE(sizeof(sb_line_t) + nruns*sizeof(sb_run_t) + len);
+}
+
+static inline const sb_line_t *
+_sb_get(const sb_t *sb, uint32_t idx)
+{
+	return (const sb_line_t *)&sb->arena[_sb_virt(sb, idx) & SB_ARENA_MASK];
+}
+
+static void
+_sb_push(sb_t *sb, const cell_t *row, unsigned ncols)
+{
+	if(!sb->arena)
+	{
+		return;
+	}
+
+	unsigned ncells = ncols;
+
+	while( (ncells > 0) && _sb_cell_is_blank(&row[ncells - 1]) )
+	{
+		ncells--;
+	}
+
+	unsigned nruns = 0;
+	size_t len = 0;
+
+	for(unsigned x = 0; x < ncells; x++)
+	{
+		const cell_t *cell = &row[x];
+
+		if( (x == 0)
+			|| (_sb_cell_attrs(cell) != _sb_cell_attrs(&row[x - 1]))
+			|| (cell->fg != row[x - 1].fg)
+			|| (cell->bg != row[x - 1].bg) )
+		{
+			nruns++;
+		}
+
+		len += cell->lbl_len ? cell->lbl_len : 1;
+	}
+
+	const uint32_t sz = _sb_line_size(nruns, len);
+
+	// lines never wrap around the end of the arena
+	const uint32_t phys = sb->head & SB_ARENA_MASK;
+
+	if(phys + sz > SB_ARENA_SIZE)
+	{
+		sb->head += SB_ARENA_SIZE - phys;
+	}
+
+	// evict oldest lines until the new one fits
+	while( (sb->nlines > 0)
+		&& ( (sb->nlines == SB_LINES_MAX)
+			|| (sb->head + sz - sb->lines[sb->first & SB_LINES_MASK] > SB_ARENA_SIZE) ) )
+	{
+		sb->first++;
+		sb->nlines--;
+	}
+
+	sb_line_t *line = (sb_line_t *)&sb->arena[sb->head & SB_ARENA_MASK];
+	char *text = (char *)&line->runs[nruns];
+	sb_run_t *run = NULL;
+
+	line->ncols = ncols;
+	line->ncells = ncells;
+	line->nruns = nruns;
+	line->len = len;
+
+	for(unsigned x = 0; x < ncells; x++)
+	{
+		const cell_t *cell = &row[x];
+
+		if(!run || !_sb_run_matches(run, cell))
+		{
+			run = run ? run + 1 : line->runs;
+
+			run->ncells = 0;
+			run->attrs = _sb_cell_attrs(cell);
+			run->fg = cell->fg;
+			run->bg = cell->bg;
+		}
+
+		run->ncells++;
+
+		if(cell->lbl_len)
+		{
+			memcpy(text, cell->lbl, cell->lbl_len);
+			text += cell->lbl_len;
+		}
+		else
+		{
+			*text++ = ' ';
+		}
+	}
+
+	sb->lines[(sb->first + sb->nlines) & SB_LINES_MASK] = sb->head;
+	sb->nlines++;
+	sb->head += sz;
+}
+
+static const sb_line_t *
+_sb_pop(sb_t *sb)
+{
+	if(sb->nlines == 0)
+	{
+		return NULL;
+	}
+
+	const sb_line_t *line = _sb_get(sb, sb->nlines - 1);
+
+	// line stays valid until the next push
+	sb->nlines--;
+	sb->head = _sb_virt(sb, sb->nlines);
+
+	return line;
+}
+
+static void
+_sb_decode(const sb_line_t *line, cell_t *row, unsigned ncols)
+{
+	const char *text = _sb_text(line);
+	unsigned x = 0;
+
+	for(unsigned r = 0; r < line->nruns; r++)
+	{
+		const sb_run_t *run = &line->runs[r];
+
+		for(unsigned i = 0; i < run->ncells; i++, x++)
+		{
+			utf8_int32_t chr = 0;
+			const char *next = utf8codepoint(text, &chr);
+
+			if(x < ncols)
+			{
+				cell_t *tar = &row[x];
+
+				memset(tar, 0x0, sizeof(cell_t));
+
+				if(chr != ' ')
+				{
+					tar->lbl_len = next - text;
+					memcpy(tar->lbl, text, tar->lbl_len);
+				}
+
+				tar->bold = run->attrs & SB_ATTR_BOLD;
+				tar->italic = run->attrs & SB_ATTR_ITALIC;
+				tar->reverse = run->attrs & SB_ATTR_REVERSE;
+				tar->fg = run->fg;
+				tar->bg = run->bg;
+			}
+
+			text = next;
+		}
+	}
+
+	for( ; x < ncols; x++)
+	{
+		_term_cell_blank(&row[x]);
+	}
+}
+
+static inline void
+_term_scroll(d2tk_atom_body_pty_t *vpty, int32_t delta)
+{
+	int64_t offset = (int64_t)vpty->sb.offset + delta;
+
+	if(offset < 0)
+	{
+		offset = 0;
+	}
+	else if(offset > vpty->sb.nlines)
+	{
+		offset = vpty->sb.nlines;
+	}
+
+	if(offset != vpty->sb.offset)
+	{
+		vpty->sb.offset = offset;
+		vpty->dirty = true;
+	}
+}
+
+static void
+_search_reset(d2tk_atom_body_pty_t *vpty)
+{
+	search_t *search = &vpty->search;
+
+	search->done = (search->query_len == 0);
+	search->scan = vpty->sb.first + vpty->sb.nlines;
+	search->match = 0;
+	search->nmatches = 0;
+
+	vpty->dirty = true;
+}
+
+static void
+_search_jump(d2tk_atom_body_pty_t *vpty)
+{
+	const search_t *search = &vpty->search;
+
+	if(search->match >= search->nmatches)
+	{
+		return;
+	}
+
+	const uint32_t idx = search->matches[search->match] - vpty->sb.first;
+
+	// line may have been evicted or popped in the meantime
+	if(idx >= vpty->sb.nlines)
+	{
+		return;
+	}
+
+	// center matching line vertically
+	const int64_t offset = vpty->sb.nlines - idx + vpty->nrows/2;
+
+	_term_scroll(vpty, offset - vpty->sb.offset);
 }
 
-static inline int
-_term_read(d2tk_atom_body_pty_t *vpty,
-	void (*cb)(const char *buf, size_t len, void *data), void *data)
+static bool
+_search_step(d2tk_atom_body_pty_t *vpty)
 {
-	char buf [4096];
-	int count = 0;
+	search_t *search = &vpty->search;
+	const sb_t *sb = &vpty->sb;
 
-	while(true)
+	if(!search->active || search->done)
 	{
-		const ssize_t len = read(vpty->fd, buf, sizeof(buf));
+		return false;
+	}
 
-		if(len == -1)
+	uint32_t hi = search->scan - sb->first;
+
+	if( ((int32_t)hi <= 0) || !sb->arena)
+	{
+		search->done = true;
+		return false;
+	}
+
+	if(hi > sb->nlines)
+	{
+		hi = sb->nlines;
+	}
+
+	// gather a chunk of contiguous lines within budget
+	const sb_line_t *last = _sb_get(sb, hi - 1);
+	const uint32_t end = _sb_virt(sb, hi - 1)
+		+ _sb_line_size(last->nruns, last->len);
+	uint32_t lo = hi - 1;
+
+	while( (lo > 0)
+		&& (end - _sb_virt(sb, lo - 1) <= SEARCH_BUDGET)
+		&& ( (_sb_virt(sb, lo - 1) & SB_ARENA_MASK)
+			< (_sb_virt(sb, lo) & SB_ARENA_MASK) ) )
+	{
+		lo--;
+	}
+
+	const uint32_t start = _sb_virt(sb, lo);
+	const uint8_t *head = &sb->arena[start & SB_ARENA_MASK];
+	const uint8_t *from = head;
+	const uint8_t *to = head + (end - start);
+	const uint32_t nmatches = search->nmatches;
+
+	// scan whole chunk at once and map hits back to lines
+	for(uint32_t i = lo; search->nmatches < SEARCH_MATCHES_MAX; )
+	{
+		const uint8_t *hit = memmem(from, to - from,
+			search->query, search->query_len);
+
+		if(!hit)
 		{
-			if(errno != EAGAIN)
-			{
-				//FIXME fprintf(stderr, "[%s] read failed '%s'\n", __func__, strerror(errno));
-			}
 			break;
 		}
 
-		if(len == 0)
+		while( (i + 1 < hi) && (_sb_virt(sb, i + 1) - start <= (uint32_t)(hit - head)) )
 		{
-			break;;
+			i++;
 		}
 
-		cb(buf, len, data);
-		count += 1;
-	}
+		const sb_line_t *line = _sb_get(sb, i);
+		const uint8_t *text = (const uint8_t *)_sb_text(line);
 
-	return count;
-}
+		if( (hit >= text) && (hit + search->query_len <= text + line->len) )
+		{
+			search->matches[search->nmatches++] = sb->first + i;
 
-static inline void
-_term_clear(d2tk_atom_body_pty_t *vpty)
-{
-	vpty->kid = 0;
-	atomic_store(&vpty->thread_data.running, false);;
-}
+			from = text + line->len; // one match per line is enough
+		}
+		else // hit in line header
+		{
+			from = hit + 1;
+		}
+	}
 
-static inline int
-_term_done_thread(d2tk_atom_body_pty_t *vpty)
-{
-	if(atomic_load(&vpty->thread_data.running))
+	// keep newest matches first
+	for(uint32_t i = nmatches, j = search->nmatches; i + 1 < j; i++, j--)
 	{
-		return 0;
+		const uint32_t tmp = search->matches[i];
+
+		search->matches[i] = search->matches[j - 1];
+		search->matches[j - 1] = tmp;
 	}
 
-	pthread_join(vpty->kid, NULL);
+	search->scan = sb->first + lo;
 
-#if D2TK_DEBUG == 1
-				fprintf(stderr, "[%s] child with pid %ld has exited\n",
-					__func__, vpty->kid);
-#endif
+	if( (lo == 0) || (search->nmatches == SEARCH_MATCHES_MAX) )
+	{
+		search->done = true;
+	}
 
-	_term_clear(vpty);
-	return 1;
+	if( (nmatches == 0) && (search->nmatches > 0) )
+	{
+		_search_jump(vpty);
+	}
+
+	return !search->done;
 }
 
-static inline int
-_term_done_fork(d2tk_atom_body_pty_t *vpty)
+static void
+_search_highlight(d2tk_atom_body_pty_t *vpty, cell_t *row)
 {
-	int stat = 0;
-	const ptrdiff_t kid = waitpid(vpty->kid, NULL, WNOHANG);
-#if D2TK_DEBUG == 1
-	fprintf(stderr, "[%s] waitpid of child with pid %ld: %ld (%d)\n",
-		__func__, vpty->kid, kid, stat);
-#endif
+	const search_t *search = &vpty->search;
+	char buf [NCOLS_MAX*4];
+	uint16_t cols [NCOLS_MAX*4];
+	size_t len = 0;
 
-	if(kid == -1)
+	if(!search->active || (search->query_len == 0) )
 	{
-		return 0;
+		return;
 	}
 
-	if(kid == 0)
+	for(int x = 0; x < vpty->ncols; x++)
 	{
-		return 0;
-	}
+		const cell_t *cell = &row[x];
 
-	// has exited
-	if(WIFSIGNALED(stat))
-	{
-#if D2TK_DEBUG == 1
-		fprintf(stderr, "[%s] child with pid %ld has exited with signal %d\n",
-			__func__, vpty->kid, WTERMSIG(stat));
-#endif
+		if(cell->lbl_len)
+		{
+			memcpy(&buf[len], cell->lbl, cell->lbl_len);
+
+			for(size_t i = 0; i < cell->lbl_len; i++)
+			{
+				cols[len++] = x;
+			}
+		}
+		else
+		{
+			buf[len] = ' ';
+			cols[len++] = x;
+		}
 	}
-	else if(WIFEXITED(stat))
+
+	for(const char *from = buf; ; )
 	{
-#if D2TK_DEBUG == 1
-		fprintf(stderr, "[%s] child with pid %ld has exited with status %d\n",
-			__func__, vpty->kid, WEXITSTATUS(stat));
-#endif
-	}
+		const char *hit = memmem(from, buf + len - from,
+			search->query, search->query_len);
 
-	_term_clear(vpty);
-	return 1;
-}
+		if(!hit)
+		{
+			break;
+		}
 
-static inline int
-_term_done(d2tk_atom_body_pty_t *vpty)
-{
-	if(vpty->kid == 0)
-	{
-		return 1;
-	}
+		const size_t off = hit - buf;
 
-	return vpty->is_threaded
-		? _term_done_thread(vpty)
-		: _term_done_fork(vpty);
+		for(unsigned x = cols[off]; x <= cols[off + search->query_len - 1]; x++)
+		{
+			row[x].match = true;
+		}
+
+		from = hit + search->query_len;
+	}
 }
 
 static void
-_term_output(const char *buf, size_t len, void *data)
+_search_behave(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty)
 {
-	d2tk_atom_body_pty_t *vpty = data;
+	search_t *search = &vpty->search;
+
+	if(d2tk_base_get_keymask(base, D2TK_KEYMASK_UP, true))
+	{
+		if(search->match + 1 < search->nmatches)
+		{
+			search->match++;
+			_search_jump(vpty);
+		}
+	}
+	if(d2tk_base_get_keymask(base, D2TK_KEYMASK_DOWN, true))
+	{
+		if(search->match > 0)
+		{
+			search->match--;
+			_search_jump(vpty);
+		}
+	}
 
-	const ssize_t writ = write(vpty->fd, buf, len);
+	ssize_t len = 0;
+	const utf8_int32_t *utf8 = NULL;
 
-	if(writ == -1)
+	d2tk_base_get_utf8(base, &len, &utf8);
+
+	for(ssize_t i = 0; i < len; i++)
 	{
-		fprintf(stderr, "[%s] write failed '%s'\n", __func__, strerror(errno));
-		return;
+		switch(utf8[i])
+		{
+			case 0x1b: // escape, back to live view
+			{
+				search->active = false;
+				_term_scroll(vpty, -vpty->sb.offset);
+			} return;
+
+			case '\r': // enter, stay at match
+			{
+				search->active = false;
+			} return;
+
+			case 0x08: // backspace
+				// fall-through
+			case 0x7f:
+			{
+				while(search->query_len > 0)
+				{
+					const char chr = search->query[--search->query_len];
+
+					if( (chr & 0xc0) != 0x80) // first byte of codepoint
+					{
+						break;
+					}
+				}
+
+				search->query[search->query_len] = '\0';
+				_search_reset(vpty);
+			} break;
+
+			default:
+			{
+				if(utf8[i] < 0x20)
+				{
+					break; // ignore control characters
+				}
+
+				const size_t left = sizeof(search->query) - search->query_len;
+
+				if(utf8codepointsize(utf8[i]) >= left)
+				{
+					break;
+				}
+
+				char *tail = utf8catcodepoint(&search->query[search->query_len],
+					utf8[i], left);
+
+				search->query_len = tail - search->query;
+				search->query[search->query_len] = '\0';
+				_search_reset(vpty);
+			} break;
+		}
 	}
 }
 
@@ -276,9 +1825,9 @@ _screen_settermprop(VTermProp prop, VTermValue *val, void *data)
 		{
 			vpty->cursor_shape = val->number;
 		} break;
-		case VTERM_PROP_MOUSE:
+		case VTERM_PROP_MOUSE: // number
 		{
-			vpty->hasmouse = true;
+			vpty->hasmouse = (val->number != VTERM_PROP_MOUSE_NONE);
 		} break;
 
 		default:
@@ -295,6 +1844,17 @@ _screen_resize(int nrows, int ncols, void *data)
 {
 	d2tk_atom_body_pty_t *vpty = data;
 
+	// cells are fixed size
+	if(nrows > NROWS_MAX)
+	{
+		nrows = NROWS_MAX;
+	}
+
+	if(ncols > NCOLS_MAX)
+	{
+		ncols = NCOLS_MAX;
+	}
+
 	if( (nrows == vpty->nrows) && (ncols == vpty->ncols) )
 	{
 		return 0;
@@ -307,7 +1867,7 @@ _screen_resize(int nrows, int ncols, void *data)
 		.ws_ypixel = 0
 	};
 
-	if(ioctl(vpty->fd, TIOCSWINSZ, &winsize) == -1)
+	if(vpty->fd && (ioctl(vpty->fd, TIOCSWINSZ, &winsize) == -1) )
 	{
 		fprintf(stderr, "[%s] ioctl failed '%s'\n", __func__, strerror(errno));
 		return 1;
@@ -316,6 +1876,9 @@ _screen_resize(int nrows, int ncols, void *data)
 	vpty->nrows = nrows;
 	vpty->ncols = ncols;
 
+	const uint16_t dim [2] = { ncols, nrows };
+	_rec_append(&vpty->rec, REC_TYPE_RESIZE, dim, sizeof(dim));
+
 	return 0;
 }
 
@@ -329,64 +1892,126 @@ _screen_bell(void *data)
 	return 0;
 }
 
-static const VTermScreenCallbacks screen_callbacks = {
-	.settermprop = _screen_settermprop,
-	.bell = _screen_bell,
-  .resize = _screen_resize
-};
+static int
+_screen_sb_pushline(int ncols, const VTermScreenCell *cells, void *data)
+{
+	d2tk_atom_body_pty_t *vpty = data;
+	cell_t row [NCOLS_MAX];
+
+	if(ncols > NCOLS_MAX)
+	{
+		ncols = NCOLS_MAX;
+	}
+
+	memset(row, 0x0, ncols*sizeof(cell_t));
+
+	for(int x = 0; x < ncols; x++)
+	{
+		_term_cell_from_vterm(vpty, &cells[x], &row[x]);
+	}
+
+	_sb_push(&vpty->sb, row, ncols);
+
+	// keep view anchored while scrolled back
+	_term_scroll(vpty, vpty->sb.offset ? 1 : 0);
+
+	return 0;
+}
 
 static int
-_clone(void *data)
+_screen_sb_popline(int ncols, VTermScreenCell *cells, void *data)
 {
-	clone_data_t *clone_data = data;
+	d2tk_atom_body_pty_t *vpty = data;
+	cell_t row [NCOLS_MAX];
+
+	const sb_line_t *line = _sb_pop(&vpty->sb);
+
+	if(!line)
+	{
+		return 0;
+	}
 
-	close(clone_data->master);
+	_sb_decode(line, row, NCOLS_MAX);
 
-	if(login_tty(clone_data->slave) == -1)
+	for(int x = 0; x < ncols; x++)
 	{
-		_exit(1);
+		_term_cell_to_vterm(&row[x < NCOLS_MAX ? x : NCOLS_MAX - 1], &cells[x]);
 	}
 
-	/* Restore the ISIG signals back to defaults */
-	signal(SIGINT,  SIG_DFL);
-	signal(SIGQUIT, SIG_DFL);
-	signal(SIGTERM, SIG_DFL);
-	signal(SIGSTOP, SIG_DFL);
-	signal(SIGCONT, SIG_DFL);
+	_term_scroll(vpty, 0);
+
+	return 1;
+}
+
+static const VTermScreenCallbacks screen_callbacks = {
+	.settermprop = _screen_settermprop,
+	.bell = _screen_bell,
+  .resize = _screen_resize,
+	.sb_pushline = _screen_sb_pushline,
+	.sb_popline = _screen_sb_popline
+};
 
-	char **argv = (char **)clone_data->data;
+static void
+_env_init()
+{
+	static const char term [] = "TERM=xterm-256color";
+	size_t envc = 0;
+	size_t len = sizeof(term);
 
-	/* clone environment */
-	unsigned envc = 0;
-	for(char **env = environ; *env; env++)
+	for(char **e = environ; *e; e++)
 	{
 		envc++;
+		len += strlen(*e) + 1;
 	}
 
-	const size_t envs = envc + 2; // TERM + sentinel
-	char **envp = alloca(envs*sizeof(char *));
+	// filtered copy of the parent environment with a child TERM and sentinel
+	env.envp = calloc(envc + 2, sizeof(char *));
+	env.block = malloc(len);
+
+	if(!env.envp || !env.block)
+	{
+		free(env.envp);
+		free(env.block);
+		env.envp = NULL;
+		env.block = NULL;
+		return;
+	}
 
+	char *dst = env.block;
 	envc = 0;
-	for(char **env = environ; *env; env++)
+
+	for(char **e = environ; *e; e++)
 	{
-		if(strstr(*env, "TERM=") == *env)
-		{
-			/* ignore parent TERM */
-		}
-		else
+		if(strstr(*e, "TERM=") == *e)
 		{
-			envp[envc++] = *env;
+			continue; // ignore parent TERM
 		}
+
+		const size_t sz = strlen(*e) + 1;
+
+		memcpy(dst, *e, sz);
+		env.envp[envc++] = dst;
+		dst += sz;
 	}
 
-	/* add child TERM and sentinel */
-	envp[envc++] = "TERM=xterm-256color";
-	envp[envc] = NULL;
+	memcpy(dst, term, sizeof(term));
+	env.envp[envc++] = dst;
+	env.envp[envc] = NULL;
+}
 
-	execvpe(argv[0], argv, envp);
-	_exit(EXIT_FAILURE);
+__attribute__((destructor)) static void
+_env_deinit()
+{
+	free(env.envp);
+	free(env.block);
+}
 
-	return 0;
+static char **
+_env_get()
+{
+	pthread_once(&env.once, _env_init);
+
+	return env.envp ? env.envp : environ;
 }
 
 static void *
@@ -439,40 +2064,71 @@ static ptrdiff_t
 _forkpty(int *amaster, const struct termios *termp, const struct winsize *winp,
 	void *data)
 {
-	clone_data_t clone_data = {
-		.master = 0,
-		.slave = 0,
-		.data = data
-	};
+	char **argv = data;
+	char **envp = _env_get();
+	char name [PATH_MAX];
+	int master = 0;
+	int slave = 0;
+	pid_t pid = -1;
+
+	if(openpty(&master, &slave, name, termp, winp) == -1)
+	{
+		return -1;
+	}
 
-	if(openpty(&clone_data.master, &clone_data.slave, NULL, termp, winp) == -1)
+	posix_spawnattr_t attr;
+	posix_spawn_file_actions_t actions;
+	sigset_t sigdef;
+	sigset_t sigmask;
+
+	posix_spawnattr_init(&attr);
+	posix_spawn_file_actions_init(&actions);
+
+	// restore the ISIG signals back to defaults
+	sigemptyset(&sigdef);
+	sigaddset(&sigdef, SIGINT);
+	sigaddset(&sigdef, SIGQUIT);
+	sigaddset(&sigdef, SIGTERM);
+	sigaddset(&sigdef, SIGCONT);
+	sigemptyset(&sigmask);
+
+	posix_spawnattr_setsigdefault(&attr, &sigdef);
+	posix_spawnattr_setsigmask(&attr, &sigmask);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID
+		| POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+	// login_tty equivalent: as a fresh session leader, opening the slave by name
+	// makes it the controlling terminal
+	posix_spawn_file_actions_addclose(&actions, master);
+	posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, name, O_RDWR, 0);
+	posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDOUT_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDERR_FILENO);
+	if(slave > STDERR_FILENO)
 	{
-    return -1;
+		posix_spawn_file_actions_addclose(&actions, slave);
 	}
 
-	const int pid = vfork();
+	const int err = posix_spawnp(&pid, argv[0], &actions, &attr, argv, envp);
+
+	posix_spawn_file_actions_destroy(&actions);
+	posix_spawnattr_destroy(&attr);
+	close(slave);
 
-	switch(pid)
+	if(err != 0)
 	{
-		case -1:
-		{
-			close(clone_data.master);
-			close(clone_data.slave);
-		} return -1;
+		fprintf(stderr, "[%s] posix_spawnp failed: '%s'\n", __func__, strerror(err));
+		close(master);
+		return -1;
+	}
 
-    case 0: //child
-		{
-			// everything is done in _clone
-		} return _clone(&clone_data);
+	*amaster = master;
 
-		default: // parent
-		{
-			*amaster = clone_data.master;
-			close(clone_data.slave);
-		} return pid;
-	}
+	return pid;
 }
 
+static int
+_term_init_vterm(d2tk_atom_body_pty_t *vpty);
+
 static int
 _term_init(d2tk_atom_body_pty_t *vpty, d2tk_base_pty_cb_t cb, void *data,
 	d2tk_coord_t height, d2tk_coord_t ncols, d2tk_coord_t nrows)
@@ -544,28 +2200,76 @@ _term_init(d2tk_atom_body_pty_t *vpty, d2tk_base_pty_cb_t cb, void *data,
 		.ws_ypixel = 0
 	};
 
+	const uint64_t t0 = _now();
+
 	vpty->kid =vpty->is_threaded
 		? _threadpty(&vpty->fd, &termios, &winsize, cb, data, &vpty->thread_data)
 		: _forkpty(&vpty->fd, &termios, &winsize, data);
 
+	vpty->spawn_ns = _now() - t0;
+
 	if(vpty->kid == -1)
 	{
 		_term_clear(vpty);
 		return 1;
 	}
 
+	if(!vpty->is_threaded)
+	{
+		vpty->pidfd = _pidfd_open(vpty->kid);
+	}
+
 #if D2TK_DEBUG == 1
-	fprintf(stderr, "[%s] child with pid %ld has spawned\n", __func__, vpty->kid);
+	fprintf(stderr, "[%s] child with pid %ld has spawned in %"PRIu64" us\n",
+		__func__, vpty->kid, vpty->spawn_ns / 1000);
 #endif
 
   fcntl(vpty->fd, F_SETFL, fcntl(vpty->fd, F_GETFL) | O_NONBLOCK);
 
+	return _term_init_vterm(vpty);
+}
+
+static int
+_term_init_replay(d2tk_atom_body_pty_t *vpty, const char *path, bool fast,
+	d2tk_coord_t height)
+{
+	if(_replay_init(&vpty->replay, path, fast, &vpty->ncols, &vpty->nrows) != 0)
+	{
+		return 1;
+	}
+
+	if(_term_init_vterm(vpty) != 0)
+	{
+		_rec_deinit(&vpty->replay);
+		return 1;
+	}
+
+	// only mark as initialized once there is a vterm to resize and draw
+	vpty->height = height;
+
+	return 0;
+}
+
+static int
+_term_init_vterm(d2tk_atom_body_pty_t *vpty)
+{
 	vpty->vterm = vterm_new(vpty->nrows, vpty->ncols);
+	if(!vpty->vterm)
+	{
+		fprintf(stderr, "[%s] vterm_new failed\n", __func__);
+		return 1;
+	}
+
 	vterm_set_utf8(vpty->vterm, 1);
 	vterm_output_set_callback(vpty->vterm, _term_output, vpty);
 
 	vpty->state = vterm_obtain_state(vpty->vterm);
 
+	if(_sb_init(&vpty->sb) != 0)
+	{
+		fprintf(stderr, "[%s] scrollback allocation failed\n", __func__);
+	}
+
 	vpty->screen = vterm_obtain_screen(vpty->vterm);
 	vterm_screen_set_callbacks(vpty->screen, &screen_callbacks, vpty);
 	vterm_screen_reset(vpty->screen, 1);
@@ -585,7 +2289,10 @@ _term_deinit_thread(d2tk_atom_body_pty_t *vpty)
 	if(vpty->kid != 0)
 	{
 		// send CTRL-C
-		vterm_keyboard_unichar(vpty->vterm, 0x3, VTERM_MOD_NONE);
+		if(vpty->vterm)
+		{
+			vterm_keyboard_unichar(vpty->vterm, 0x3, VTERM_MOD_NONE);
+		}
 
 		pthread_join(vpty->kid, NULL);
 
@@ -605,51 +2312,17 @@ _term_deinit_fork(d2tk_atom_body_pty_t *vpty)
 {
 	if(vpty->kid != 0)
 	{
-		while(true)
+		// send CTRL-C, closing the master will hang up the session, the rest of
+		// the escalation is up to the reapers thread
+		if(vpty->vterm)
 		{
-			// send CTRL-C
 			vterm_keyboard_unichar(vpty->vterm, 0x3, VTERM_MOD_NONE);
+		}
 
-			usleep(1000);;
-
-			kill(vpty->kid, SIGINT);
-			kill(vpty->kid, SIGQUIT);
-			kill(vpty->kid, SIGTERM);
-			kill(vpty->kid, SIGKILL);
-
-			int stat = 0;
-			const int kid = waitpid(vpty->kid, &stat, 0);
-
-			if(kid == -1)
-			{
-				continue;
-			}
-
-			if(kid == 0)
-			{
-				// no change
-				continue;
-			}
-
-			// has exited
-			if(WIFSIGNALED(stat))
-			{
-#if D2TK_DEBUG == 1
-				fprintf(stderr, "[%s] child with pid %ld has exited with signal %d\n",
-					__func__, vpty->kid, WTERMSIG(stat));
-#endif
-			}
-			else if(WIFEXITED(stat))
-			{
-#if D2TK_DEBUG == 1
-				fprintf(stderr, "[%s] child with pid %ld has exited with status %d\n",
-					__func__, vpty->kid, WEXITSTATUS(stat));
-#endif
-			}
+		_reapers_add(vpty->kid, vpty->pidfd);
 
-			_term_clear(vpty);
-			break;
-		}
+		vpty->pidfd = 0;
+		_term_clear(vpty);
 	}
 
 	return 0;
@@ -679,6 +2352,12 @@ _term_deinit(d2tk_atom_body_pty_t *vpty)
 		vpty->fd = 0;
 	}
 
+	_sb_deinit(&vpty->sb);
+	_ac_deinit(&vpty->ac);
+	_rec_deinit(&vpty->rec);
+	_rec_deinit(&vpty->replay);
+	_term_paste_free(&vpty->out);
+
 	memset(vpty, 0x0, sizeof(d2tk_atom_body_pty_t));
 
 	return ret;
@@ -695,6 +2374,18 @@ _term_event(d2tk_atom_event_type_t event, void *data)
 		{
 			return _term_fd(vpty);
 		} break;
+		case D2TK_ATOM_EVENT_EVENTS:
+		{
+			return POLLIN | (_term_pending(vpty) ? POLLOUT : 0);
+		} break;
+		case D2TK_ATOM_EVENT_WRITE:
+		{
+			_term_pump(vpty);
+		} break;
+		case D2TK_ATOM_EVENT_FD_AUX:
+		{
+			return vpty->pidfd;
+		} break;
 		case D2TK_ATOM_EVENT_DEINIT:
 		{
 			return _term_deinit(vpty);
@@ -813,9 +2504,21 @@ _term_update(d2tk_atom_body_pty_t *vpty)
 
 	memset(vpty->cells, 0x0, sizeof(vpty->cells));
 
+	const int offset = vpty->sb.offset;
+
 	for(int y = 0; y < vpty->nrows; y++)
 	{
-		pos.row = y;
+		// rows scrolled back into view come from scrollback
+		if(y < offset)
+		{
+			const sb_line_t *line = _sb_get(&vpty->sb, vpty->sb.nlines - offset + y);
+
+			_sb_decode(line, vpty->cells[y], vpty->ncols);
+			_search_highlight(vpty, vpty->cells[y]);
+			continue;
+		}
+
+		pos.row = y - offset;
 
 		for(int x = 0; x < vpty->ncols; x++)
 		{
@@ -827,93 +2530,15 @@ _term_update(d2tk_atom_body_pty_t *vpty)
 			memset(&cell, 0x0, sizeof(cell));
 			vterm_screen_get_cell(vpty->screen, pos, &cell);
 
-			if( cell.chars[0] && (cell.width == 1) )
-			{
-				if(cell.chars[0] != ' ')
-				{
-					const char *tail = utf8catcodepoint(tar->lbl,
-						cell.chars[0], sizeof(tar->lbl));
-
-					tar->lbl_len = tail - tar->lbl;
-				}
-			}
-
-			if(cell.attrs.bold)
-			{
-				tar->bold = true;
-			}
-
-			if(cell.attrs.italic)
-			{
-				tar->italic = true;
-			}
-
-			uint32_t fg_rgba = 0x0;
-			uint32_t bg_rgba = 0x0;
-
-			if(VTERM_COLOR_IS_RGB(&cell.fg))
-			{
-				const VTermColor tmp = cell.fg;
-
-				fg_rgba = (tmp.rgb.red << 24)
-					| (tmp.rgb.green << 16)
-					| (tmp.rgb.blue << 8)
-					| 0xff;
-			}
-			else if(VTERM_COLOR_IS_INDEXED(&cell.fg))
-			{
-				VTermColor tmp = cell.fg;
-				vterm_screen_convert_color_to_rgb(vpty->screen, &tmp);
-
-				fg_rgba = (tmp.rgb.red << 24)
-					| (tmp.rgb.green << 16)
-					| (tmp.rgb.blue << 8)
-					| 0xff;
-			}
-			else if(VTERM_COLOR_IS_DEFAULT_FG(&cell.fg))
-			{
-				fg_rgba = DEFAULT_FG;
-			}
-			else if(VTERM_COLOR_IS_DEFAULT_BG(&cell.fg))
-			{
-				fg_rgba = DEFAULT_BG;
-			}
-
-			if(VTERM_COLOR_IS_RGB(&cell.bg))
-			{
-				const VTermColor tmp = cell.bg;
-
-				bg_rgba = (tmp.rgb.red << 24)
-					| (tmp.rgb.green << 16)
-					| (tmp.rgb.blue << 8)
-					| 0xff;
-			}
-			else if(VTERM_COLOR_IS_INDEXED(&cell.bg))
-			{
-				VTermColor tmp = cell.bg;
-				vterm_screen_convert_color_to_rgb(vpty->screen, &tmp);
-
-				bg_rgba = (tmp.rgb.red << 24)
-					| (tmp.rgb.green << 16)
-					| (tmp.rgb.blue << 8)
-					| 0xff;
-			}
-			else if(VTERM_COLOR_IS_DEFAULT_FG(&cell.bg))
-			{
-				bg_rgba = 0xffffffff;
-			}
-			else if(VTERM_COLOR_IS_DEFAULT_BG(&cell.bg))
-			{
-				bg_rgba = 0x000000ff;
-			}
+			_term_cell_from_vterm(vpty, &cell, tar);
 
-			tar->cursor = (y == cursor.row) && (x == cursor.col) && vpty->cursor_visible;
-			tar->reverse = cell.attrs.reverse;
-			tar->fg = fg_rgba;
-			tar->bg = bg_rgba;
+			tar->cursor = (pos.row == cursor.row) && (x == cursor.col)
+				&& vpty->cursor_visible;
 
-			_term_set_colors(vpty, fg_rgba);
+			_term_set_colors(vpty, tar->fg);
 		}
+
+		_search_highlight(vpty, vpty->cells[y]);
 	}
 }
 
@@ -921,6 +2546,11 @@ static void
 _term_resize(d2tk_atom_body_pty_t *vpty, d2tk_coord_t ncols,
 	d2tk_coord_t nrows)
 {
+	if(vpty->replay.map)
+	{
+		return; // size is dictated by the log
+	}
+
 	if( (nrows != vpty->nrows) || (ncols != vpty->ncols) )
 	{
 		vterm_set_size(vpty->vterm, nrows, ncols);
@@ -935,12 +2565,90 @@ _term_input_cb(const char *buf, size_t len, void *data)
 	vterm_input_write(vpty->vterm, buf, len);
 }
 
+static inline int
+_term_replay(d2tk_atom_body_pty_t *vpty)
+{
+	rec_t *rec = &vpty->replay;
+	const uint64_t now = _now() - rec->t0;
+	size_t budget = 0;
+	int count = 0;
+
+	while(!_replay_done(rec) && (budget < REPLAY_BUDGET) )
+	{
+		const rec_evt_t *evt = (const rec_evt_t *)&rec->map[rec->off];
+		const size_t sz = (sizeof(rec_evt_t) + evt->len + REC_ALIGN - 1)
+			& ~(size_t)(REC_ALIGN - 1);
+
+		if(rec->off + sizeof(rec_evt_t) + evt->len > rec->size)
+		{
+			rec->off = rec->size; // truncated log
+			break;
+		}
+
+		if(!rec->fast && (evt->time > now) )
+		{
+			break;
+		}
+
+		switch((rec_type_t)evt->type)
+		{
+			case REC_TYPE_INPUT:
+			{
+				_ac_feed(&vpty->ac, (const char *)evt->buf, evt->len);
+
+				_term_input_cb((const char *)evt->buf, evt->len, vpty);
+				count += 1;
+			} break;
+			case REC_TYPE_RESIZE:
+			{
+				uint16_t dim [2];
+
+				if(evt->len == sizeof(dim))
+				{
+					memcpy(dim, evt->buf, sizeof(dim));
+
+					// logs are untrusted, end replay like with a truncated one
+					if( (dim[0] == 0) || (dim[0] > NCOLS_MAX)
+						|| (dim[1] == 0) || (dim[1] > NROWS_MAX) )
+					{
+						rec->off = rec->size;
+						return count;
+					}
+
+					vterm_set_size(vpty->vterm, dim[1], dim[0]);
+					count += 1;
+				}
+			} break;
+		}
+
+		rec->off += sz;
+
+		if(rec->fast)
+		{
+			budget += evt->len;
+		}
+	}
+
+	return count;
+}
+
 static inline void
 _term_input(d2tk_atom_body_pty_t *vpty)
 {
-	if(_term_read(vpty, _term_input_cb, vpty) )
+	const int count = vpty->replay.map
+		? _term_replay(vpty)
+		: _term_read(vpty, _term_input_cb, vpty);
+
+	if(count)
+	{
+		vpty->dirty = true;
+	}
+
+	if(vpty->dirty)
 	{
 		_term_update(vpty);
+
+		vpty->dirty = false;
 	}
 }
 
@@ -949,8 +2657,14 @@ _term_behave(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 	d2tk_state_t state, d2tk_flag_t flags, const d2tk_rect_t *rect)
 {
 	VTermModifier mod = VTERM_MOD_NONE;
+	const bool shift = d2tk_base_get_modmask(base, D2TK_MODMASK_SHIFT, false);
+	const bool ctrl = d2tk_base_get_modmask(base, D2TK_MODMASK_CTRL, false);
 
-	if(d2tk_state_is_focused(state))
+	if(d2tk_state_is_focused(state) && vpty->search.active)
+	{
+		_search_behave(base, vpty);
+	}
+	else if(d2tk_state_is_focused(state))
 	{
 		if(d2tk_base_get_keymask(base, D2TK_KEYMASK_UP, true))
 		{
@@ -987,11 +2701,25 @@ _term_behave(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 		}
 		if(d2tk_base_get_keymask(base, D2TK_KEYMASK_PAGEUP, true))
 		{
-			vterm_keyboard_key(vpty->vterm, VTERM_KEY_PAGEUP, mod);
+			if(shift) // scroll back one page
+			{
+				_term_scroll(vpty, vpty->nrows);
+			}
+			else
+			{
+				vterm_keyboard_key(vpty->vterm, VTERM_KEY_PAGEUP, mod);
+			}
 		}
 		if(d2tk_base_get_keymask(base, D2TK_KEYMASK_PAGEDOWN, true))
 		{
-			vterm_keyboard_key(vpty->vterm, VTERM_KEY_PAGEDOWN, mod);
+			if(shift) // scroll forth one page
+			{
+				_term_scroll(vpty, -vpty->nrows);
+			}
+			else
+			{
+				vterm_keyboard_key(vpty->vterm, VTERM_KEY_PAGEDOWN, mod);
+			}
 		}
 
 		{
@@ -1000,14 +2728,33 @@ _term_behave(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 
 			d2tk_base_get_utf8(base, &len, &utf8);
 
-			for(ssize_t i = 0; i < len; i++)
+			// CTRL+SHIFT+F starts a scrollback search
+			if( (len == 1) && (utf8[0] == (0x1f & 'F')) && shift && ctrl)
+			{
+				vpty->search.active = true;
+				_search_reset(vpty);
+			}
+			// CTRL+SHIFT+V requests a paste via d2tk_pty_paste
+			else if( (len == 1) && (utf8[0] == (0x1f & 'V')) && shift && ctrl)
+			{
+				state |= D2TK_STATE_PASTE;
+			}
+			else
 			{
-				vterm_keyboard_unichar(vpty->vterm, utf8[i], mod);
+				if(len > 0) // jump back to live view
+				{
+					_term_scroll(vpty, -vpty->sb.offset);
+				}
+
+				for(ssize_t i = 0; i < len; i++)
+				{
+					vterm_keyboard_unichar(vpty->vterm, utf8[i], mod);
+				}
 			}
 		}
 	}
 
-	if(d2tk_base_get_modmask(base, D2TK_MODMASK_SHIFT, false))
+	if(shift)
 	{
 		mod |= VTERM_MOD_SHIFT;
 	}
@@ -1015,7 +2762,7 @@ _term_behave(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 	{
 		mod |= VTERM_MOD_ALT;
 	}
-	if(d2tk_base_get_modmask(base, D2TK_MODMASK_CTRL, false))
+	if(ctrl)
 	{
 		mod |= VTERM_MOD_CTRL;
 	}
@@ -1032,60 +2779,114 @@ _term_behave(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 
 	if( !vpty->hasmouse || (flags & D2TK_FLAG_PTY_NOMOUSE) )
 	{
+		// mouse wheel navigates scrollback instead
+		if(d2tk_state_is_hot(state))
+		{
+			int32_t dy;
+			d2tk_base_get_mouse_scroll(base, NULL, &dy, false);
+
+			_term_scroll(vpty, dy*SB_SCROLL_STEP);
+		}
+
 		return state;
 	}
 
-	if(d2tk_state_is_hot(state))
+	mouse_t *mouse = &vpty->mouse;
+
+	if(!d2tk_state_is_hot(state))
 	{
-		d2tk_coord_t mx, my;
-		int dx, dy;
-		d2tk_base_get_mouse_pos(base, &mx, &my);
-		d2tk_base_get_mouse_scroll(base, &dx, &dy, false);
+		mouse->hot = false;
+		mouse->scroll = 0;
+
+		return state;
+	}
 
-		const int row = (my - rect->y) * vpty->nrows / rect->h;
-		const int col = (mx - rect->x) * vpty->ncols / rect->w;
+	// only report transitions, vterm encodes every call it gets
+	d2tk_coord_t mx, my;
+	int dy;
+	d2tk_base_get_mouse_pos(base, &mx, &my);
+	d2tk_base_get_mouse_scroll(base, NULL, &dy, false);
 
+	const int row = (my - rect->y) * vpty->nrows / rect->h;
+	const int col = (mx - rect->x) * vpty->ncols / rect->w;
+
+	if(!mouse->hot || (row != mouse->row) || (col != mouse->col) )
+	{
 		vterm_mouse_move(vpty->vterm, row, col, mod);
 
-		const bool btn_l = d2tk_base_get_butmask(base, D2TK_BUTMASK_LEFT, false);
-		const bool btn_m = d2tk_base_get_butmask(base, D2TK_BUTMASK_MIDDLE, false);
-		const bool btn_r = d2tk_base_get_butmask(base, D2TK_BUTMASK_RIGHT, false);
+		mouse->hot = true;
+		mouse->row = row;
+		mouse->col = col;
+	}
 
-		vterm_mouse_button(vpty->vterm, 1, btn_l, mod);
-		vterm_mouse_button(vpty->vterm, 2, btn_m, mod);
-		vterm_mouse_button(vpty->vterm, 3, btn_r, mod);
+	const bool btn [MOUSE_BUTTONS] = {
+		d2tk_base_get_butmask(base, D2TK_BUTMASK_LEFT, false),
+		d2tk_base_get_butmask(base, D2TK_BUTMASK_MIDDLE, false),
+		d2tk_base_get_butmask(base, D2TK_BUTMASK_RIGHT, false)
+	};
 
-		if(dy > 0)
-		{
-			vterm_mouse_button(vpty->vterm, 4, true, mod);
-		}
-		else if(dy < 0)
+	for(unsigned i = 0; i < MOUSE_BUTTONS; i++)
+	{
+		if(btn[i] != mouse->btn[i])
 		{
-			vterm_mouse_button(vpty->vterm, 5, true, mod);
+			vterm_mouse_button(vpty->vterm, i + 1, btn[i], mod);
+
+			mouse->btn[i] = btn[i];
 		}
 	}
 
+	mouse->scroll += dy;
+
+	for(unsigned i = 0; (mouse->scroll != 0) && (i < MOUSE_SCROLL_MAX); i++)
+	{
+		const bool up = (mouse->scroll > 0);
+
+		vterm_mouse_button(vpty->vterm, up ? 4 : 5, true, mod);
+
+		mouse->scroll += up ? -1 : 1;
+	}
+
+	if(mouse->scroll != 0)
+	{
+		d2tk_base_set_again(base);
+	}
+
 	return state;
 }
 
+// cell styles only differ in font face and text colors
+static inline uint64_t
+_term_style_hash(uint64_t hash, const d2tk_style_t *style)
+{
+	return d2tk_hash_foreach(&hash, sizeof(uint64_t),
+		&style->font_face, sizeof(const char *),
+		&style->text_fill_color[D2TK_TRIPLE_NONE], sizeof(uint32_t),
+		&style->text_stroke_color[D2TK_TRIPLE_NONE], sizeof(uint32_t),
+		NULL);
+}
+
 static inline void
 _term_draw(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 	const d2tk_rect_t *rect, bool focus)
 {
+	const d2tk_style_t *old_style = d2tk_base_get_style(base);
+	const uint64_t old_hash = d2tk_base_get_style_hash(base);
+	d2tk_style_t style = *old_style;
+
+	style.border_width = 0;
+	style.padding = 0;
+	style.rounding = 0;
+
+	const uint64_t hash = d2tk_hash(&style, sizeof(d2tk_style_t));
+
 	D2TK_BASE_TABLE(rect, vpty->ncols, vpty->nrows, D2TK_FLAG_TABLE_REL, tab)
 	{
 		const int x = d2tk_table_get_index_x(tab);
 		const int y = d2tk_table_get_index_y(tab);
 		const d2tk_rect_t *trect = d2tk_table_get_rect(tab);
 
-		const d2tk_style_t *old_style = d2tk_base_get_style(base);
-		d2tk_style_t style = *old_style;
 		cell_t *cell = &vpty->cells[y][x];
 
-		style.border_width = 0;
-		style.padding = 0;
-		style.rounding = 0;
-
 		uint32_t fg = cell->fg;
 		uint32_t bg = cell->bg;
 
@@ -1098,6 +2899,11 @@ _term_draw(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 				bg = focus ? DEFAULT_FG : DEFAULT_FG_LIGHT;
 			}
 		}
+		else if(cell->match)
+		{
+			fg = MATCH_FG;
+			bg = MATCH_BG;
+		}
 		else if(cell->reverse)
 		{
 			const uint32_t tmp = fg;
@@ -1122,13 +2928,11 @@ _term_draw(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 			style.font_face = FONT_CODE_REGULAR;
 		}
 
-		d2tk_base_set_style(base, &style);
+		_d2tk_base_set_style_hash(base, &style, _term_style_hash(hash, &style));
 
 		d2tk_base_label(base, cell->lbl_len, cell->lbl, 1.f, trect,
 			D2TK_ALIGN_LEFT | D2TK_ALIGN_BOTTOM);
 
-		d2tk_base_set_style(base, old_style);
-
 		if(cell->cursor)
 		{
 			style.font_face = FONT_CODE_BOLD;
@@ -1136,7 +2940,7 @@ _term_draw(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 			style.text_stroke_color[D2TK_TRIPLE_NONE] = focus
 				? DEFAULT_FG
 				: DEFAULT_FG_LIGHT;
-			d2tk_base_set_style(base, &style);
+			_d2tk_base_set_style_hash(base, &style, _term_style_hash(hash, &style));
 
 			// draw underline cursor overlay
 			if(vpty->cursor_shape == VTERM_PROP_CURSORSHAPE_UNDERLINE)
@@ -1157,10 +2961,35 @@ _term_draw(d2tk_base_t *base, d2tk_atom_body_pty_t *vpty,
 				d2tk_base_label(base, sizeof(lbl), lbl, 1.f, &bnd,
 					D2TK_ALIGN_LEFT | D2TK_ALIGN_TOP);
 			}
-
-			d2tk_base_set_style(base, old_style);
 		}
 	}
+
+	_d2tk_base_set_style_hash(base, old_style, old_hash);
+
+	if(vpty->search.active)
+	{
+		const search_t *search = &vpty->search;
+		char lbl [SEARCH_QUERY_MAX + 64];
+
+		const size_t lbl_len = snprintf(lbl, sizeof(lbl), "search: %s [%"PRIu32"/%"PRIu32"%s]",
+			search->query, search->nmatches ? search->match + 1 : 0, search->nmatches,
+			search->done ? "" : "+");
+
+		// draw search bar overlay over last row
+		d2tk_rect_t bnd = *rect;
+		bnd.h = rect->h / vpty->nrows;
+		bnd.y = rect->y + rect->h - bnd.h;
+
+		style.font_face = FONT_CODE_BOLD;
+		style.text_fill_color[D2TK_TRIPLE_NONE] = focus ? DEFAULT_FG : DEFAULT_FG_LIGHT;
+		style.text_stroke_color[D2TK_TRIPLE_NONE] = DEFAULT_BG;
+		_d2tk_base_set_style_hash(base, &style, _term_style_hash(hash, &style));
+
+		d2tk_base_label(base, lbl_len, lbl, 1.f, &bnd,
+			D2TK_ALIGN_LEFT | D2TK_ALIGN_BOTTOM);
+
+		_d2tk_base_set_style_hash(base, old_style, old_hash);
+	}
 }
 
 d2tk_pty_t *
@@ -1189,7 +3018,14 @@ d2tk_pty_begin_state(d2tk_base_t *base, d2tk_id_t id, d2tk_state_t state,
 		_term_deinit(vpty);
 	}
 
-	if(vpty->height == 0)
+	if( (vpty->height == 0) && (flags & D2TK_FLAG_PTY_REPLAY) )
+	{
+		if(_term_init_replay(vpty, data, flags & D2TK_FLAG_PTY_FAST, height) != 0)
+		{
+			fprintf(stderr, "[%s] _term_init_replay failed\n", __func__);
+		}
+	}
+	else if(vpty->height == 0)
 	{
 		if(_term_init(vpty, cb, data, height, ncols, nrows) != 0)
 		{
@@ -1197,6 +3033,14 @@ d2tk_pty_begin_state(d2tk_base_t *base, d2tk_id_t id, d2tk_state_t state,
 		}
 	}
 
+	// nothing to resize, behave or draw, e.g. with a missing or invalid log
+	if(!vpty->vterm)
+	{
+		pty->state = D2TK_STATE_CLOSE;
+
+		return pty;
+	}
+
 	const d2tk_style_t *old_style = d2tk_base_get_style(base);
 	d2tk_style_t style = *old_style;
 
@@ -1211,8 +3055,29 @@ d2tk_pty_begin_state(d2tk_base_t *base, d2tk_id_t id, d2tk_state_t state,
 
 	pty->state = _term_behave(base, vpty, state, flags, rect);
 
+	if(_search_step(vpty))
+	{
+		d2tk_base_set_again(base);
+	}
+
+	if(_term_pending(vpty))
+	{
+		_term_pump(vpty);
+
+		// idle frontends only wake up on readability, keep probing for POLLOUT
+		if(_term_pending(vpty))
+		{
+			d2tk_base_set_again(base);
+		}
+	}
+
 	_term_input(vpty);
 
+	if(vpty->replay.map && !_replay_done(&vpty->replay))
+	{
+		d2tk_base_set_again(base);
+	}
+
 	_term_draw(base, vpty, rect, d2tk_state_is_focused(pty->state));
 
 	if(_term_done(vpty))
@@ -1229,6 +3094,14 @@ d2tk_pty_begin_state(d2tk_base_t *base, d2tk_id_t id, d2tk_state_t state,
 		vpty->bell = 0;
 	}
 
+	if(vpty->ac.matches)
+	{
+		pty->state |= D2TK_STATE_MATCH;
+		pty->matches = vpty->ac.matches;
+
+		vpty->ac.matches = 0;
+	}
+
 	d2tk_base_set_style(base, old_style);
 
 	return pty;
@@ -1310,3 +3183,102 @@ d2tk_pty_get_max_blue(d2tk_pty_t *pty)
 
 	return _col_to_uint32(&pty->vpty->max_blue);
 }
+
+D2TK_API void
+d2tk_pty_set_patterns(d2tk_pty_t *pty, const char **patterns)
+{
+	ac_t *ac = &pty->vpty->ac;
+	uint64_t hash = 0;
+
+	for(unsigned i = 0; (i < AC_PATTERNS_MAX) && patterns[i]; i++)
+	{
+		hash = (hash << 1 | hash >> 63) ^ d2tk_hash(patterns[i], strlen(patterns[i]));
+	}
+
+	if(hash == ac->hash)
+	{
+		return;
+	}
+
+	if(_ac_init(ac, patterns, hash) != 0)
+	{
+		fprintf(stderr, "[%s] _ac_init failed\n", __func__);
+	}
+}
+
+D2TK_API uint32_t
+d2tk_pty_get_matches(d2tk_pty_t *pty)
+{
+	return pty->matches;
+}
+
+D2TK_API void
+d2tk_pty_paste(d2tk_pty_t *pty, size_t len, const char *buf)
+{
+	d2tk_atom_body_pty_t *vpty = pty->vpty;
+	out_t *out = &vpty->out;
+
+	if(!vpty->vterm || (len == 0) )
+	{
+		return;
+	}
+
+	// append to a paste still in progress, its end marker is not sent yet
+	const bool appending = (out->paste != NULL);
+	const size_t rest = out->paste_len - out->paste_off;
+	char *paste = malloc(rest + len);
+
+	if(!paste)
+	{
+		return;
+	}
+
+	if(rest)
+	{
+		memcpy(paste, &out->paste[out->paste_off], rest);
+	}
+
+	if(!appending)
+	{
+		vterm_keyboard_start_paste(vpty->vterm);
+	}
+
+	memcpy(&paste[rest], buf, len);
+
+	free(out->paste);
+	out->paste = paste;
+	out->paste_len = rest + len;
+	out->paste_off = 0;
+
+	_term_pump(vpty);
+}
+
+D2TK_API uint64_t
+d2tk_pty_get_spawn_latency(d2tk_pty_t *pty)
+{
+	return pty->vpty->spawn_ns;
+}
+
+D2TK_API int
+d2tk_pty_record(d2tk_pty_t *pty, const char *path)
+{
+	d2tk_atom_body_pty_t *vpty = pty->vpty;
+
+	if(!path)
+	{
+		_rec_deinit(&vpty->rec);
+		return 0;
+	}
+
+	if(vpty->rec.map)
+	{
+		return 0; // already recording
+	}
+
+	if(!vpty->vterm)
+	{
+		return 1;
+	}
+
+	return _rec_init(&vpty->rec, path, vpty->ncols, vpty->nrows);
+}
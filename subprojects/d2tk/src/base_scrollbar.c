@@ -75,14 +75,14 @@ d2tk_scrollbar_not_end(d2tk_scrollbar_t *scrollbar)
 static void
 _d2tk_draw_scrollbar(d2tk_core_t *core, d2tk_state_t hstate, d2tk_state_t vstate,
 	const d2tk_rect_t *hbar, const d2tk_rect_t *vbar, const d2tk_style_t *style,
-	d2tk_flag_t flags)
+	uint64_t style_hash, d2tk_flag_t flags)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ &hstate, sizeof(d2tk_state_t) },
 		{ &vstate, sizeof(d2tk_state_t) },
 		{ hbar, sizeof(d2tk_rect_t) },
 		{ vbar, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &flags, sizeof(d2tk_flag_t) },
 		{ NULL, 0 }
 	};
@@ -168,6 +168,7 @@ D2TK_API d2tk_scrollbar_t *
 d2tk_scrollbar_next(d2tk_base_t *base, d2tk_scrollbar_t *scrollbar)
 {
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 	const d2tk_coord_t s = 10; //FIXME
 	const d2tk_coord_t s2 = s*2;
 
@@ -306,7 +307,8 @@ d2tk_scrollbar_next(d2tk_base_t *base, d2tk_scrollbar_t *scrollbar)
 
 	d2tk_core_t *core = base->core;
 
-	_d2tk_draw_scrollbar(core, hstate, vstate, &hbar, &vbar, style, flags);
+	_d2tk_draw_scrollbar(core, hstate, vstate, &hbar, &vbar, style, style_hash,
+		flags);
 
 	//return state; //FIXME
 	return NULL;
@@ -23,10 +23,11 @@ D2TK_API d2tk_state_t
 d2tk_base_separator(d2tk_base_t *base, const d2tk_rect_t *rect, d2tk_flag_t flag)
 {
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	const d2tk_hash_dict_t dict [] = {
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &flag, sizeof(d2tk_flag_t) },
 		{ NULL, 0 }
 	};
@@ -25,12 +25,12 @@
 
 static inline void
 _d2tk_base_spinner_draw_dec(d2tk_core_t *core, const d2tk_rect_t *rect,
-	d2tk_triple_t triple, const d2tk_style_t *style)
+	d2tk_triple_t triple, const d2tk_style_t *style, uint64_t style_hash)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ &triple, sizeof(d2tk_triple_t) },
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ NULL, 0 }
 	};
 	const uint64_t hash = d2tk_hash_dict(dict);
@@ -80,12 +80,12 @@ _d2tk_base_spinner_draw_dec(d2tk_core_t *core, const d2tk_rect_t *rect,
 
 static inline void
 _d2tk_base_spinner_draw_inc(d2tk_core_t *core, const d2tk_rect_t *rect,
-	d2tk_triple_t triple, const d2tk_style_t *style)
+	d2tk_triple_t triple, const d2tk_style_t *style, uint64_t style_hash)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ &triple, sizeof(d2tk_triple_t) },
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ NULL, 0 }
 	};
 	const uint64_t hash = d2tk_hash_dict(dict);
@@ -161,7 +161,7 @@ _d2tk_base_spinner_dec(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect)
 	}
 
 	_d2tk_base_spinner_draw_dec(base->core, rect, triple,
-		d2tk_base_get_style(base));
+		d2tk_base_get_style(base), d2tk_base_get_style_hash(base));
 
 	return state;
 }
@@ -194,7 +194,7 @@ _d2tk_base_spinner_inc(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect)
 	}
 
 	_d2tk_base_spinner_draw_inc(base->core, rect, triple,
-		d2tk_base_get_style(base));
+		d2tk_base_get_style(base), d2tk_base_get_style_hash(base));
 
 	return state;
 }
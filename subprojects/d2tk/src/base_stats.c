@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2018-2019 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "base_internal.h"
+
+#define NLINES 11
+
+D2TK_API void
+d2tk_base_stats(d2tk_base_t *base, const d2tk_rect_t *rect)
+{
+	const d2tk_core_stats_t *stats = d2tk_core_get_stats(base->core);
+	char lines [NLINES][128];
+	int lens [NLINES];
+	unsigned n = 0;
+
+	lens[n] = snprintf(lines[n], sizeof(lines[n]), "frame %"PRIu64"%s",
+		stats->frame, stats->full_refresh ? " (full refresh)" : "");
+	n++;
+	lens[n] = snprintf(lines[n], sizeof(lines[n]), "%"PRIu32" commands, %"PRIu32" bytes",
+		stats->commands, stats->bytes);
+	n++;
+	lens[n] = snprintf(lines[n], sizeof(lines[n]),
+		"buffer %"PRIu32" bytes, %"PRIu32" high-water, %"PRIu32" cleared, %"PRIu32
+		" grows, %"PRIu32" shrinks",
+		stats->mem.size, stats->mem.high_water, stats->mem.cleared,
+		stats->mem.grows, stats->mem.shrinks);
+	n++;
+	lens[n] = snprintf(lines[n], sizeof(lines[n]),
+		"bboxes %"PRIu32" matched, %"PRIu32" appeared, %"PRIu32" disappeared",
+		stats->matched, stats->appeared, stats->disappeared);
+	n++;
+	lens[n] = snprintf(lines[n], sizeof(lines[n]),
+		"dirty %"PRIu32" rects, %"PRIu64" px",
+		stats->dirty_rects, stats->dirty_area);
+	n++;
+	lens[n] = snprintf(lines[n], sizeof(lines[n]),
+		"sprites %"PRIu32" hits, %"PRIu32" misses, %"PRIu32" evictions, %"PRIu32" entries",
+		stats->sprites.hits, stats->sprites.misses, stats->sprites.evictions,
+		stats->sprites.entries);
+	n++;
+	lens[n] = snprintf(lines[n], sizeof(lines[n]),
+		"memcaches %"PRIu32" hits, %"PRIu32" misses, %"PRIu32" evictions, %"PRIu32" entries",
+		stats->memcaches.hits, stats->memcaches.misses, stats->memcaches.evictions,
+		stats->memcaches.entries);
+	n++;
+	lens[n] = snprintf(lines[n], sizeof(lines[n]),
+		"extents %"PRIu32" hits, %"PRIu32" misses, %"PRIu32" evictions, %"PRIu32" entries",
+		stats->extents.hits, stats->extents.misses, stats->extents.evictions,
+		stats->extents.entries);
+	n++;
+	lens[n] = snprintf(lines[n], sizeof(lines[n]),
+		"build %.1f us, diff %.1f us, end %.1f us",
+		stats->build*1e-3, stats->diff*1e-3, stats->end*1e-3);
+	n++;
+
+	for(unsigned pass = 0; pass < 2; pass++)
+	{
+		const d2tk_core_pass_stats_t *pstats = &stats->pass[pass];
+
+		lens[n] = snprintf(lines[n], sizeof(lines[n]),
+			"pass %u pre %.1f us, process %.1f us, post %.1f us",
+			pass, pstats->pre*1e-3, pstats->process*1e-3, pstats->post*1e-3);
+		n++;
+	}
+
+	const d2tk_coord_t h = rect->h / NLINES;
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		const d2tk_rect_t line = D2TK_RECT(rect->x, rect->y + i*h, rect->w, h);
+		const ssize_t len = lens[i] < (int)sizeof(lines[i])
+			? lens[i]
+			: (ssize_t)sizeof(lines[i]) - 1;
+
+		d2tk_base_label(base, len, lines[i], 1.f, &line,
+			D2TK_ALIGN_LEFT | D2TK_ALIGN_MIDDLE);
+	}
+}
+
+#undef NLINES
@@ -22,13 +22,13 @@
 
 static void
 _d2tk_base_draw_text_field(d2tk_core_t *core, d2tk_state_t state,
-	const d2tk_rect_t *rect, const d2tk_style_t *style, char *value,
-	d2tk_align_t align)
+	const d2tk_rect_t *rect, const d2tk_style_t *style, uint64_t style_hash,
+	char *value, d2tk_align_t align)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ &state, sizeof(d2tk_state_t) },
 		{ rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &align, sizeof(d2tk_align_t) },
 		{ value, strlen(value) },
 		{ NULL, 0 }
@@ -122,6 +122,7 @@ d2tk_base_text_field(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 	size_t maxlen, char *value, d2tk_align_t align, const char *accept)
 {
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	d2tk_state_t state = d2tk_base_is_active_hot(base, id, rect, D2TK_FLAG_NONE);
 
@@ -206,7 +207,8 @@ d2tk_base_text_field(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 
 	d2tk_core_t *core = base->core;
 
-	_d2tk_base_draw_text_field(core, state, rect, style, value, align);
+	_d2tk_base_draw_text_field(core, state, rect, style, style_hash, value,
+		align);
 
 	return state;
 }
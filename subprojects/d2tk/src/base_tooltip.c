@@ -31,6 +31,7 @@ _d2tk_base_tooltip_draw(d2tk_base_t *base, ssize_t lbl_len, const char *lbl,
 	}
 
 	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const uint64_t style_hash = d2tk_base_get_style_hash(base);
 
 	d2tk_core_t *core = base->core;
 
@@ -47,7 +48,7 @@ _d2tk_base_tooltip_draw(d2tk_base_t *base, ssize_t lbl_len, const char *lbl,
 
 	const d2tk_hash_dict_t dict [] = {
 		{ &rect, sizeof(d2tk_rect_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ lbl, lbl_len },
 		{ NULL, 0 }
 	};
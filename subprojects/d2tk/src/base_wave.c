@@ -23,13 +23,14 @@
 
 static inline void
 _d2tk_base_draw_wave(d2tk_core_t *core, const d2tk_rect_t *rect,
-	d2tk_state_t state, const d2tk_style_t *style, float min,
+	d2tk_state_t state, const d2tk_style_t *style, uint64_t style_hash,
+	float min,
 	const float *value, int32_t nelem, float max)
 {
 	const d2tk_hash_dict_t dict [] = {
 		{ rect, sizeof(d2tk_rect_t) },
 		{ &state , sizeof(d2tk_state_t) },
-		{ style, sizeof(d2tk_style_t) },
+		{ &style_hash, sizeof(uint64_t) },
 		{ &min, sizeof(float) },
 		{ value, sizeof(float)*nelem },
 		{ &max, sizeof(float) },
@@ -140,7 +141,7 @@ d2tk_base_wave_float(d2tk_base_t *base, d2tk_id_t id, const d2tk_rect_t *rect,
 		D2TK_FLAG_SCROLL);
 
 	_d2tk_base_draw_wave(base->core, rect, state, d2tk_base_get_style(base),
-		min, value, nelem, max);
+		d2tk_base_get_style_hash(base), min, value, nelem, max);
 
 	return state;
 }
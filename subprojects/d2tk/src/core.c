@@ -24,6 +24,8 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <assert.h>
+#include <time.h>
+#include <pthread.h>
 #if defined(_WIN32)
 #	include <winsock2.h>
 #else
@@ -37,57 +39,128 @@
 #	include <fontconfig/fontconfig.h>
 #endif
 
-#define _D2TK_SPRITES_MAX			0x10000 //FIXME how big?
-#define _D2TK_SPRITES_MASK		(_D2TK_SPRITES_MAX - 1)
 #define _D2TK_SPRITES_TTL			0x100
-
-#define _D2TK_MEMCACHES_MAX		0x10000 //FIXME how big?
-#define _D2TK_MEMCACHES_MASK	(_D2TK_MEMCACHES_MAX - 1)
 #define _D2TK_MEMCACHES_TTL		0x100
 
+#define _D2TK_TILE_BITS				4
+#define _D2TK_TILE_SIZE				(1 << _D2TK_TILE_BITS) // 16x16 px
+
+#define _D2TK_CACHE_SLOTS_MIN		0x400 // must be a power of two
+#define _D2TK_CACHE_CHUNK_BITS	10
+#define _D2TK_CACHE_CHUNK_SIZE	(1 << _D2TK_CACHE_CHUNK_BITS)
+#define _D2TK_CACHE_CHUNK_MASK	(_D2TK_CACHE_CHUNK_SIZE - 1)
+
+#define _D2TK_MEM_SIZE_MIN		0x2000 // 8K
+#define _D2TK_MEM_WINDOW			0x40 // frames to shrink over
+
+#define _D2TK_SLAB_SIZE				0x10000 // 64K
+#define _D2TK_SLAB_MIN_BITS		6 // smallest block is 64 bytes
+#define _D2TK_SLAB_CLASSES		10 // largest block is 32K, beyond is malloc'ed
+
+#define _D2TK_FONT_PATHS_MAX	32
+
 typedef struct _d2tk_mem_t d2tk_mem_t;
 typedef struct _d2tk_bitmap_t d2tk_bitmap_t;
-typedef struct _d2tk_sprite_t d2tk_sprite_t;
-typedef struct _d2tk_memcache_t d2tk_memcache_t;
+typedef struct _d2tk_entry_t d2tk_entry_t;
+typedef struct _d2tk_slot_t d2tk_slot_t;
+typedef struct _d2tk_cache_t d2tk_cache_t;
+typedef struct _d2tk_diff_slot_t d2tk_diff_slot_t;
+typedef struct _d2tk_diff_t d2tk_diff_t;
 typedef struct _d2tk_widget_body_t d2tk_widget_body_t;
+typedef struct _d2tk_slab_t d2tk_slab_t;
 
 struct _d2tk_mem_t {
 	size_t size;
 	size_t offset;
+	size_t used; // bytes possibly written since reset, beyond is zero
+	size_t high_water; // of current window
+	uint32_t frames; // in current window
+	uint32_t grows;
+	uint32_t shrinks;
 	uint8_t *buf;
 };
 
 struct _d2tk_bitmap_t {
-	size_t size;
-	uint32_t *pixels;
-	uint32_t *template;
+	uint64_t *tiles; // one bit per tile, row-major
+	size_t stride; // words per tile row
+	d2tk_coord_t ncols;
+	d2tk_coord_t nrows;
 	size_t nfills;
-	d2tk_coord_t x0;
+	d2tk_coord_t x0; // dirty bounds in tiles, x1/y1 exclusive
 	d2tk_coord_t x1;
 	d2tk_coord_t y0;
 	d2tk_coord_t y1;
+	d2tk_rect_t *rects; // dirty rectangles in px
+	size_t nrects;
+	size_t maxrects;
+	uint32_t *open; // rects extendable from the previous tile row
+	uint32_t *next;
 };
 
-struct _d2tk_sprite_t {
+typedef void (*d2tk_release_t)(d2tk_core_t *core, const d2tk_entry_t *entry);
+
+struct _d2tk_entry_t {
 	uint64_t hash;
 	uintptr_t body;
 	uint32_t type;
-	uint32_t ttl;
+	uint32_t used; // generation of last use
+	uint32_t prev; // lru list, most recent first, 0 is none
+	uint32_t next; // also links the free list
 };
 
-struct _d2tk_memcache_t {
-	uint64_t hash;
-	uintptr_t body;
+struct _d2tk_slot_t {
+	uint64_t key;
+	uint32_t idx; // 0 is empty
+};
+
+struct _d2tk_cache_t {
+	d2tk_slot_t *slots;
+	uint32_t mask;
+	uint32_t nentries;
+	d2tk_entry_t **chunks; // entries never move, body pointers stay valid
+	uint32_t nchunks;
+	uint32_t free;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t gen;
 	uint32_t ttl;
+	d2tk_core_cache_stats_t stats; // of current frame
+};
+
+struct _d2tk_diff_slot_t {
+	d2tk_coord_t x0;
+	d2tk_coord_t y0;
+	uint32_t head; // first bbox at this position, index + 1, 0 is empty
+};
+
+struct _d2tk_diff_t {
+	d2tk_com_t **coms;
+	uint32_t *next; // next bbox at the same position, index + 1
+	size_t ncoms;
+	size_t maxcoms;
+	d2tk_diff_slot_t *slots;
+	size_t nslots;
+	size_t maxslots;
 };
 
 struct _d2tk_widget_body_t {
-	size_t size;
+	d2tk_widget_body_t *next; // retired list
+	uint64_t hash; // of buf
+	uint32_t commands;
+	uint32_t class; // slab size class
+	size_t size; // keeps buf 8-byte aligned
 	uint8_t buf [];
 };
 
+struct _d2tk_slab_t {
+	void *free [_D2TK_SLAB_CLASSES]; // blocks per size class, never returned
+	uint8_t **slabs;
+	uint32_t nslabs;
+};
+
 struct _d2tk_widget_t {
 	size_t ref;
+	uint32_t commands;
 	uintptr_t *body;
 };
 
@@ -112,15 +185,21 @@ struct _d2tk_core_t {
 
 	uint32_t bg_color;
 
-	struct {
-		uint32_t sprites;
-		uint32_t memcaches;
-	} ttl;
+	d2tk_cache_t sprites;
+	d2tk_cache_t memcaches;
+	d2tk_cache_t extents;
+	d2tk_slab_t slab;
+	d2tk_widget_body_t *retired; // released in this frame
+	d2tk_widget_body_t *limbo; // released in previous frame
+	uint32_t recording; // nesting depth of widgets being cached
 
-	d2tk_sprite_t sprites [_D2TK_SPRITES_MAX];
-	d2tk_memcache_t memcaches [_D2TK_MEMCACHES_MAX];
+	d2tk_diff_t diff;
 
 	ssize_t parent;
+
+	d2tk_core_stats_t cur; // in progress
+	d2tk_core_stats_t stats; // of last frame
+	uint64_t t0;
 };
 
 const size_t d2tk_widget_sz = sizeof(d2tk_widget_t);
@@ -158,94 +237,478 @@ d2tk_rect_shrink(d2tk_rect_t *dst, const d2tk_rect_t *src,
 	dst->h = src->h - brd;
 }
 
-uintptr_t *
-d2tk_core_get_sprite(d2tk_core_t *core, uint64_t hash, uint8_t type)
+static inline uint64_t
+_d2tk_now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+static inline d2tk_entry_t *
+_d2tk_cache_entry(d2tk_cache_t *cache, uint32_t idx)
+{
+	return &cache->chunks[idx >> _D2TK_CACHE_CHUNK_BITS][idx & _D2TK_CACHE_CHUNK_MASK];
+}
+
+static inline uint64_t
+_d2tk_cache_key(uint64_t hash, uint32_t type)
+{
+	return hash ^ (type * 0x9e3779b97f4a7c15ULL);
+}
+
+static inline uint32_t
+_d2tk_cache_dist(d2tk_cache_t *cache, uint32_t pos, uint64_t key)
+{
+	return (pos - key) & cache->mask;
+}
+
+static inline void
+_d2tk_cache_unlink(d2tk_cache_t *cache, d2tk_entry_t *entry)
+{
+	if(entry->prev)
+	{
+		_d2tk_cache_entry(cache, entry->prev)->next = entry->next;
+	}
+	else
+	{
+		cache->head = entry->next;
+	}
+
+	if(entry->next)
+	{
+		_d2tk_cache_entry(cache, entry->next)->prev = entry->prev;
+	}
+	else
+	{
+		cache->tail = entry->prev;
+	}
+
+	entry->prev = 0;
+	entry->next = 0;
+}
+
+static inline void
+_d2tk_cache_push(d2tk_cache_t *cache, uint32_t idx, d2tk_entry_t *entry)
+{
+	entry->prev = 0;
+	entry->next = cache->head;
+
+	if(cache->head)
+	{
+		_d2tk_cache_entry(cache, cache->head)->prev = idx;
+	}
+	else
+	{
+		cache->tail = idx;
+	}
+
+	cache->head = idx;
+}
+
+static inline void
+_d2tk_cache_place(d2tk_cache_t *cache, uint64_t key, uint32_t idx)
 {
-	for(unsigned i = 0; i < _D2TK_SPRITES_MAX; i++)
+	d2tk_slot_t cur = {
+		.key = key,
+		.idx = idx
+	};
+	uint32_t pos = key & cache->mask;
+
+	// robin hood: the richer slot gives way
+	for(uint32_t dist = 0; ; dist++, pos = (pos + 1) & cache->mask)
 	{
-		const unsigned j = (hash + i*i) & _D2TK_SPRITES_MASK;
-		d2tk_sprite_t *sprite = &core->sprites[j];
+		d2tk_slot_t *slot = &cache->slots[pos];
 
-		if(sprite->body) // sprite is already taken
+		if(!slot->idx)
 		{
-			// is this the sprite we're looking for?
-			if( (sprite->hash == hash) && (sprite->type == type) )
-			{
-				sprite->ttl = core->ttl.sprites;
-				sprite->type = type;
-				return &sprite->body;
-			}
-			else // not our sprite
+			*slot = cur;
+			return;
+		}
+
+		const uint32_t d = _d2tk_cache_dist(cache, pos, slot->key);
+
+		if(d < dist)
+		{
+			const d2tk_slot_t tmp = *slot;
+
+			*slot = cur;
+			cur = tmp;
+			dist = d;
+		}
+	}
+}
+
+static inline int
+_d2tk_cache_grow_slots(d2tk_cache_t *cache)
+{
+	const uint32_t nslots = cache->slots
+		? (cache->mask + 1) << 1
+		: _D2TK_CACHE_SLOTS_MIN;
+	d2tk_slot_t *slots = calloc(nslots, sizeof(d2tk_slot_t));
+
+	if(!slots)
+	{
+		return 1;
+	}
+
+	d2tk_slot_t *old = cache->slots;
+	const uint32_t nold = old ? cache->mask + 1 : 0;
+
+	cache->slots = slots;
+	cache->mask = nslots - 1;
+
+	for(uint32_t i = 0; i < nold; i++)
+	{
+		if(old[i].idx)
+		{
+			_d2tk_cache_place(cache, old[i].key, old[i].idx);
+		}
+	}
+
+	free(old);
+
+	return 0;
+}
+
+static inline uint32_t
+_d2tk_cache_alloc(d2tk_cache_t *cache)
+{
+	if(!cache->free)
+	{
+		d2tk_entry_t **chunks = realloc(cache->chunks,
+			(cache->nchunks + 1) * sizeof(d2tk_entry_t *));
+
+		if(!chunks)
+		{
+			return 0;
+		}
+
+		cache->chunks = chunks;
+
+		d2tk_entry_t *chunk = calloc(_D2TK_CACHE_CHUNK_SIZE, sizeof(d2tk_entry_t));
+
+		if(!chunk)
+		{
+			return 0;
+		}
+
+		const uint32_t base = cache->nchunks << _D2TK_CACHE_CHUNK_BITS;
+
+		cache->chunks[cache->nchunks++] = chunk;
+
+		// hand out ascending indices, index 0 is reserved as none
+		for(uint32_t i = _D2TK_CACHE_CHUNK_SIZE; i-- > (base ? 0 : 1); )
+		{
+			chunk[i].next = cache->free;
+			cache->free = base + i;
+		}
+	}
+
+	const uint32_t idx = cache->free;
+
+	cache->free = _d2tk_cache_entry(cache, idx)->next;
+
+	return idx;
+}
+
+static inline uint32_t
+_d2tk_cache_find(d2tk_cache_t *cache, uint64_t key, uint64_t hash,
+	uint32_t type)
+{
+	if(!cache->slots)
+	{
+		return UINT32_MAX;
+	}
+
+	uint32_t pos = key & cache->mask;
+
+	for(uint32_t dist = 0; ; dist++, pos = (pos + 1) & cache->mask)
+	{
+		const d2tk_slot_t *slot = &cache->slots[pos];
+
+		if(!slot->idx || (_d2tk_cache_dist(cache, pos, slot->key) < dist) )
+		{
+			return UINT32_MAX;
+		}
+
+		if(slot->key == key)
+		{
+			const d2tk_entry_t *entry = _d2tk_cache_entry(cache, slot->idx);
+
+			if( (entry->hash == hash) && (entry->type == type) )
 			{
-				continue;
+				return pos;
 			}
 		}
+	}
+}
+
+static inline uintptr_t *
+_d2tk_cache_get(d2tk_cache_t *cache, uint64_t hash, uint32_t type)
+{
+	const uint64_t key = _d2tk_cache_key(hash, type);
+	const uint32_t pos = _d2tk_cache_find(cache, key, hash, type);
+
+	if(pos != UINT32_MAX)
+	{
+		const uint32_t idx = cache->slots[pos].idx;
+		d2tk_entry_t *entry = _d2tk_cache_entry(cache, idx);
+
+		entry->used = cache->gen;
+		cache->stats.hits += 1;
+
+		if(cache->head != idx)
+		{
+			_d2tk_cache_unlink(cache, entry);
+			_d2tk_cache_push(cache, idx, entry);
+		}
 
-		// empty sprite, ready to be taken
-		sprite->hash = hash;
-		sprite->ttl = core->ttl.sprites;
-		sprite->type = type;
-		return &sprite->body;
+		return &entry->body;
 	}
 
-	return NULL; // out of memory FIXME increase memory and remap existing sprites
+	// keep load factor below 3/4
+	if( (!cache->slots || ( (cache->nentries + 1) * 4 > (cache->mask + 1) * 3) )
+		&& (_d2tk_cache_grow_slots(cache) != 0) )
+	{
+		return NULL;
+	}
+
+	const uint32_t idx = _d2tk_cache_alloc(cache);
+
+	if(!idx)
+	{
+		return NULL;
+	}
+
+	d2tk_entry_t *entry = _d2tk_cache_entry(cache, idx);
+
+	entry->hash = hash;
+	entry->body = 0;
+	entry->type = type;
+	entry->used = cache->gen;
+
+	_d2tk_cache_push(cache, idx, entry);
+	_d2tk_cache_place(cache, key, idx);
+	cache->nentries += 1;
+	cache->stats.misses += 1;
+
+	return &entry->body;
 }
 
 static inline void
-_d2tk_sprites_free(d2tk_core_t *core)
+_d2tk_cache_evict(d2tk_core_t *core, d2tk_cache_t *cache, uint32_t idx,
+	d2tk_release_t release)
 {
-	for(unsigned i = 0; i < _D2TK_SPRITES_MAX; i++)
-	{
-		d2tk_sprite_t *sprite = &core->sprites[i];
+	d2tk_entry_t *entry = _d2tk_cache_entry(cache, idx);
+	const uint64_t key = _d2tk_cache_key(entry->hash, entry->type);
+	uint32_t pos = _d2tk_cache_find(cache, key, entry->hash, entry->type);
 
-		if(!sprite->hash)
+	if(pos != UINT32_MAX)
+	{
+		// backward shift deletion, no tombstones
+		for(uint32_t nxt = (pos + 1) & cache->mask;
+			cache->slots[nxt].idx && _d2tk_cache_dist(cache, nxt, cache->slots[nxt].key);
+			pos = nxt, nxt = (nxt + 1) & cache->mask)
 		{
-			continue;
+			cache->slots[pos] = cache->slots[nxt];
 		}
 
-		if(sprite->body)
+		cache->slots[pos].idx = 0;
+	}
+
+	_d2tk_cache_unlink(cache, entry);
+
+	if(entry->body)
+	{
+		release(core, entry);
+	}
+
+	memset(entry, 0x0, sizeof(d2tk_entry_t));
+	entry->next = cache->free;
+	cache->free = idx;
+	cache->nentries -= 1;
+	cache->stats.evictions += 1;
+}
+
+static inline void
+_d2tk_cache_free(d2tk_core_t *core, d2tk_cache_t *cache, d2tk_release_t release)
+{
+	while(cache->head)
+	{
+		_d2tk_cache_evict(core, cache, cache->head, release);
+	}
+}
+
+static inline void
+_d2tk_cache_gc(d2tk_core_t *core, d2tk_cache_t *cache, d2tk_release_t release)
+{
+	cache->gen += 1;
+
+	// only the least recently used entries are ever visited
+	while(cache->tail)
+	{
+		const d2tk_entry_t *entry = _d2tk_cache_entry(cache, cache->tail);
+
+		if(cache->gen - entry->used < cache->ttl)
 		{
-			core->driver->sprite_free(core->data, sprite->type, sprite->body);
-			sprite->type = 0;
-			sprite->body = 0;
+			break;
 		}
 
-		sprite->hash = 0;
+		_d2tk_cache_evict(core, cache, cache->tail, release);
+	}
+}
+
+static inline void
+_d2tk_cache_deinit(d2tk_core_t *core, d2tk_cache_t *cache, d2tk_release_t release)
+{
+	_d2tk_cache_free(core, cache, release);
+
+	for(uint32_t i = 0; i < cache->nchunks; i++)
+	{
+		free(cache->chunks[i]);
 	}
+
+	free(cache->chunks);
+	free(cache->slots);
+	memset(cache, 0x0, sizeof(d2tk_cache_t));
+}
+
+static void
+_d2tk_sprite_release(d2tk_core_t *core, const d2tk_entry_t *entry)
+{
+#if D2TK_DEBUG
+	fprintf(stderr, "\tgc sprites (%08"PRIx64")\n", entry->hash);
+#endif
+	core->driver->sprite_free(core->data, entry->type, entry->body);
+}
+
+uintptr_t *
+d2tk_core_get_sprite(d2tk_core_t *core, uint64_t hash, uint8_t type)
+{
+	return _d2tk_cache_get(&core->sprites, hash, type);
+}
+
+static inline void
+_d2tk_sprites_free(d2tk_core_t *core)
+{
+	_d2tk_cache_free(core, &core->sprites, _d2tk_sprite_release);
 }
 
 static inline void
 _d2tk_sprites_gc(d2tk_core_t *core)
 {
-	for(unsigned i = 0; i < _D2TK_SPRITES_MAX; i++)
+	_d2tk_cache_gc(core, &core->sprites, _d2tk_sprite_release);
+}
+
+static void
+_d2tk_extent_release(d2tk_core_t *core __attribute__((unused)),
+	const d2tk_entry_t *entry __attribute__((unused)))
+{
+	// extents are stored inline
+}
+
+static inline void
+_d2tk_extents_free(d2tk_core_t *core)
+{
+	_d2tk_cache_free(core, &core->extents, _d2tk_extent_release);
+}
+
+static inline void
+_d2tk_extents_gc(d2tk_core_t *core)
+{
+	_d2tk_cache_gc(core, &core->extents, _d2tk_extent_release);
+}
+
+static inline void *
+_d2tk_slab_alloc(d2tk_slab_t *slab, size_t size, uint32_t *class)
+{
+	uint32_t cls = 0;
+
+	while( (cls < _D2TK_SLAB_CLASSES)
+		&& ( ((size_t)1 << (_D2TK_SLAB_MIN_BITS + cls)) < size) )
+	{
+		cls++;
+	}
+
+	*class = cls;
+
+	if(cls == _D2TK_SLAB_CLASSES)
 	{
-		d2tk_sprite_t *sprite = &core->sprites[i];
+		return malloc(size);
+	}
 
-		if(!sprite->hash || (--sprite->ttl > 0) )
+	if(!slab->free[cls])
+	{
+		uint8_t **slabs = realloc(slab->slabs,
+			(slab->nslabs + 1) * sizeof(uint8_t *));
+
+		if(!slabs)
 		{
-			continue;
+			return NULL;
 		}
 
-		if(sprite->body)
+		slab->slabs = slabs;
+
+		uint8_t *chunk = malloc(_D2TK_SLAB_SIZE);
+
+		if(!chunk)
 		{
-#if D2TK_DEBUG
-			fprintf(stderr, "\tgc sprites (%08"PRIx64")\n", sprite->hash);
-#endif
-			core->driver->sprite_free(core->data, sprite->type, sprite->body);
-			sprite->type = 0;
-			sprite->body = 0;
+			return NULL;
 		}
 
-		sprite->hash = 0;
+		slab->slabs[slab->nslabs++] = chunk;
+
+		// carve slab into blocks of this class
+		const size_t len = (size_t)1 << (_D2TK_SLAB_MIN_BITS + cls);
+
+		for(size_t off = _D2TK_SLAB_SIZE; off >= len; )
+		{
+			off -= len;
+			*(void **)&chunk[off] = slab->free[cls];
+			slab->free[cls] = &chunk[off];
+		}
+	}
+
+	void *block = slab->free[cls];
+	slab->free[cls] = *(void **)block;
+
+	return block;
+}
+
+static inline void
+_d2tk_slab_free(d2tk_slab_t *slab, void *block, uint32_t class)
+{
+	if(class == _D2TK_SLAB_CLASSES)
+	{
+		free(block);
+		return;
+	}
+
+	*(void **)block = slab->free[class];
+	slab->free[class] = block;
+}
+
+static inline void
+_d2tk_slab_deinit(d2tk_slab_t *slab)
+{
+	for(uint32_t i = 0; i < slab->nslabs; i++)
+	{
+		free(slab->slabs[i]);
 	}
+
+	free(slab->slabs);
+	memset(slab, 0x0, sizeof(d2tk_slab_t));
 }
 
 static inline void
 _d2tk_mem_init(d2tk_mem_t *mem, size_t size)
 {
+	memset(mem, 0x0, sizeof(d2tk_mem_t));
 	mem->size = size;
-	mem->offset = 0;
-	mem->buf = malloc(mem->size);
+	mem->buf = calloc(1, mem->size);
 }
 
 static inline void
@@ -257,195 +720,299 @@ _d2tk_mem_deinit(d2tk_mem_t *mem)
 	mem->buf = NULL;
 }
 
-static inline void
+static inline size_t
 _d2tk_mem_reset(d2tk_mem_t *mem)
 {
+	const size_t cleared = mem->used;
+
+	// only clear what has been written, padding must be zero for hashing
+	memset(mem->buf, 0x0, cleared);
 	mem->offset = 0;
-	memset(mem->buf, 0x0, mem->size);
+	mem->used = 0;
+
+	return cleared;
 }
 
-static inline uintptr_t *
-_d2tk_core_get_memcache(d2tk_core_t *core, uint64_t hash)
+static void
+_d2tk_memcache_release(d2tk_core_t *core, const d2tk_entry_t *entry)
 {
-	for(unsigned i = 0; i < _D2TK_MEMCACHES_MAX; i++)
-	{
-		const unsigned j = (hash + i*i) & _D2TK_MEMCACHES_MASK;
-		d2tk_memcache_t *memcache = &core->memcaches[j];
+	d2tk_widget_body_t *body = (d2tk_widget_body_t *)entry->body;
 
-		if(memcache->body) // memcache is already taken
-		{
-			// is this the memcache we're looking for?
-			if(memcache->hash == hash)
-			{
-				memcache->ttl = core->ttl.memcaches;
-				return &memcache->body;
-			}
-			else // not our memcache
-			{
-				continue;
-			}
-		}
+#if D2TK_DEBUG
+	fprintf(stderr, "\tgc memcaches (%08"PRIx64")\n", entry->hash);
+#endif
+
+	// current and previous frame may still refer to it via segments
+	body->next = core->retired;
+	core->retired = body;
+}
 
-		// empty memcache, ready to be taken
-		memcache->hash = hash;
-		memcache->ttl = core->ttl.memcaches;
-		return &memcache->body;
+static inline void
+_d2tk_memcaches_retire(d2tk_core_t *core)
+{
+	for(d2tk_widget_body_t *body = core->limbo, *next; body; body = next)
+	{
+		next = body->next;
+
+		_d2tk_slab_free(&core->slab, body, body->class);
 	}
 
-	return NULL; // out of memory FIXME increase memory and remap existing memcaches
+	core->limbo = core->retired;
+	core->retired = NULL;
+}
+
+static inline uintptr_t *
+_d2tk_core_get_memcache(d2tk_core_t *core, uint64_t hash)
+{
+	return _d2tk_cache_get(&core->memcaches, hash, 0);
 }
 
 static inline void
 _d2tk_memcaches_free(d2tk_core_t *core)
 {
-	for(unsigned i = 0; i < _D2TK_MEMCACHES_MAX; i++)
+	_d2tk_cache_free(core, &core->memcaches, _d2tk_memcache_release);
+}
+
+static inline void
+_d2tk_memcaches_gc(d2tk_core_t *core)
+{
+	_d2tk_cache_gc(core, &core->memcaches, _d2tk_memcache_release);
+}
+
+static inline void
+_d2tk_bitmap_clear(d2tk_bitmap_t *bitmap)
+{
+	bitmap->nfills = 0;
+	bitmap->nrects = 0;
+	bitmap->x0 = INT_MAX;
+	bitmap->x1 = INT_MIN;
+	bitmap->y0 = INT_MAX;
+	bitmap->y1 = INT_MIN;
+}
+
+static inline void
+_d2tk_bitmap_resize(d2tk_core_t *core, d2tk_coord_t w, d2tk_coord_t h)
+{
+	d2tk_bitmap_t *bitmap = &core->bitmap;
+
+	bitmap->ncols = (w + _D2TK_TILE_SIZE - 1) >> _D2TK_TILE_BITS;
+	bitmap->nrows = (h + _D2TK_TILE_SIZE - 1) >> _D2TK_TILE_BITS;
+	bitmap->stride = (bitmap->ncols + 63) >> 6;
+
+	free(bitmap->tiles);
+	bitmap->tiles = calloc(bitmap->nrows*bitmap->stride, sizeof(uint64_t));
+
+	// at most every other tile of a row starts a new rect
+	const size_t nopen = (bitmap->ncols >> 1) + 1;
+	bitmap->open = realloc(bitmap->open, nopen*sizeof(uint32_t));
+	bitmap->next = realloc(bitmap->next, nopen*sizeof(uint32_t));
+
+	_d2tk_bitmap_clear(bitmap);
+}
+
+static inline void
+_d2tk_bitmap_deinit(d2tk_bitmap_t *bitmap)
+{
+	free(bitmap->tiles);
+	bitmap->tiles = NULL;
+	free(bitmap->rects);
+	bitmap->rects = NULL;
+	free(bitmap->open);
+	bitmap->open = NULL;
+	free(bitmap->next);
+	bitmap->next = NULL;
+	bitmap->maxrects = 0;
+	_d2tk_bitmap_clear(bitmap);
+}
+
+static inline void
+_d2tk_bitmap_reset(d2tk_core_t *core)
+{
+	d2tk_bitmap_t *bitmap = &core->bitmap;
+
+	if(bitmap->nfills)
 	{
-		d2tk_memcache_t *memcache = &core->memcaches[i];
+		// only clear the words touched since the last reset
+		const size_t w0 = bitmap->x0 >> 6;
+		const size_t w1 = ((bitmap->x1 - 1) >> 6) + 1;
 
-		if(!memcache->hash)
+		for(d2tk_coord_t y = bitmap->y0; y < bitmap->y1; y++)
 		{
-			continue;
+			memset(&bitmap->tiles[y*bitmap->stride + w0], 0x0,
+				(w1 - w0)*sizeof(uint64_t));
 		}
+	}
 
-		if(memcache->body)
-		{
-			d2tk_widget_body_t *body = (d2tk_widget_body_t *)memcache->body;
+	_d2tk_bitmap_clear(bitmap);
+}
 
-			free(body);
-			memcache->body = 0;
-		}
+// mask of bits x0..x1 (exclusive) within word w
+static inline uint64_t
+_d2tk_bitmap_mask(d2tk_coord_t w, d2tk_coord_t x0, d2tk_coord_t x1)
+{
+	uint64_t mask = UINT64_MAX;
+
+	if(w == (x0 >> 6))
+	{
+		mask &= UINT64_MAX << (x0 & 63);
+	}
 
-		memcache->hash = 0;
+	if(w == ((x1 - 1) >> 6))
+	{
+		mask &= UINT64_MAX >> (63 - ((x1 - 1) & 63));
 	}
+
+	return mask;
 }
 
-static inline void
-_d2tk_memcaches_gc(d2tk_core_t *core)
+// first tile >= x in x..x1 with given state, x1 if none
+static inline d2tk_coord_t
+_d2tk_bitmap_scan(const uint64_t *row, d2tk_coord_t x, d2tk_coord_t x1,
+	bool set)
 {
-	for(unsigned i = 0; i < _D2TK_MEMCACHES_MAX; i++)
+	while(x < x1)
 	{
-		d2tk_memcache_t *memcache = &core->memcaches[i];
-
-		if(!memcache->hash || (--memcache->ttl > 0) )
-		{
-			continue;
-		}
+		const uint64_t word = set
+			? row[x >> 6]
+			: ~row[x >> 6];
+		const uint64_t bits = word & (UINT64_MAX << (x & 63));
 
-		if(memcache->body)
+		if(bits)
 		{
-#if D2TK_DEBUG
-			fprintf(stderr, "\tgc memcaches (%08"PRIx64")\n", memcache->hash);
-#endif
-			d2tk_widget_body_t *body = (d2tk_widget_body_t *)memcache->body;
+			x = (x & ~63) + __builtin_ctzll(bits);
 
-			free(body);
-			memcache->body = 0;
+			return x < x1
+				? x
+				: x1;
 		}
 
-		memcache->hash = 0;
+		x = (x & ~63) + 64;
 	}
+
+	return x1;
 }
 
-static inline void
-_d2tk_bitmap_template_refill(d2tk_core_t *core)
+// convert pixel clip to tile range, false if empty
+static inline bool
+_d2tk_bitmap_tiles(d2tk_core_t *core, const d2tk_clip_t *clip,
+	d2tk_clip_t *dst)
 {
-	d2tk_bitmap_t *bitmap = &core->bitmap;
+	const d2tk_coord_t x0 = clip->x0 < 0
+		? 0
+		: clip->x0;
+	const d2tk_coord_t y0 = clip->y0 < 0
+		? 0
+		: clip->y0;
+	const d2tk_coord_t x1 = clip->x1 > core->w
+		? core->w
+		: clip->x1;
+	const d2tk_coord_t y1 = clip->y1 > core->h
+		? core->h
+		: clip->y1;
 
-	for(d2tk_coord_t x = 0; x < core->w; x++)
+	if( (x0 >= x1) || (y0 >= y1) )
 	{
-		bitmap->template[x] = core->bg_color;
+		return false;
 	}
-}
 
-static inline void
-_d2tk_bitmap_resize(d2tk_core_t *core, d2tk_coord_t w, d2tk_coord_t h)
-{
-	d2tk_bitmap_t *bitmap = &core->bitmap;
+	dst->x0 = x0 >> _D2TK_TILE_BITS;
+	dst->y0 = y0 >> _D2TK_TILE_BITS;
+	dst->x1 = ((x1 - 1) >> _D2TK_TILE_BITS) + 1;
+	dst->y1 = ((y1 - 1) >> _D2TK_TILE_BITS) + 1;
+	dst->w = dst->x1 - dst->x0;
+	dst->h = dst->y1 - dst->y0;
 
-	const size_t stride = w*sizeof(uint32_t);
-	bitmap->size = h*stride;
-	bitmap->pixels = realloc(bitmap->pixels, bitmap->size);
-	bitmap->template = realloc(bitmap->template, stride);
-	_d2tk_bitmap_template_refill(core);
+	return true;
 }
 
 static inline void
-_d2tk_bitmap_deinit(d2tk_bitmap_t *bitmap)
+_d2tk_bitmap_rects_push(d2tk_bitmap_t *bitmap, d2tk_coord_t x0,
+	d2tk_coord_t x1, d2tk_coord_t y)
 {
-	free(bitmap->pixels);
-	bitmap->pixels = NULL;
-	free(bitmap->template);
-	bitmap->template = NULL;
-	bitmap->size = 0;
-	bitmap->nfills = 0;
+	if(bitmap->nrects == bitmap->maxrects)
+	{
+		bitmap->maxrects = bitmap->maxrects
+			? bitmap->maxrects << 1
+			: 64;
+		bitmap->rects = realloc(bitmap->rects,
+			bitmap->maxrects*sizeof(d2tk_rect_t));
+		assert(bitmap->rects);
+	}
+
+	d2tk_rect_t *rect = &bitmap->rects[bitmap->nrects++];
+
+	rect->x = x0;
+	rect->y = y;
+	rect->w = x1 - x0;
+	rect->h = 1;
 }
 
+// merge runs of dirty tiles into rectangles, vertically if runs line up
 static inline void
-_d2tk_bitmap_reset(d2tk_core_t *core)
+_d2tk_bitmap_rects(d2tk_core_t *core)
 {
 	d2tk_bitmap_t *bitmap = &core->bitmap;
+	size_t nopen = 0;
 
-	// x1/y1 may be wrong after window shrink
-	const d2tk_coord_t x1 = bitmap->x1 < core->w
-		? bitmap->x1
-		: core->w;
-	const d2tk_coord_t y1 = bitmap->y1 < core->h
-		? bitmap->y1
-		: core->h;
+	bitmap->nrects = 0;
 
-	const size_t stride = (x1 - bitmap->x0)*sizeof(uint32_t);
-
-	for(d2tk_coord_t y = bitmap->y0, Y = y*core->w; y < y1; y++, Y+=core->w)
+	for(d2tk_coord_t y = bitmap->y0; y < bitmap->y1; y++)
 	{
-		memset(&bitmap->pixels[Y + bitmap->x0], 0x0, stride);
-	}
+		const uint64_t *row = &bitmap->tiles[y*bitmap->stride];
+		size_t nnext = 0;
+		size_t o = 0;
 
-	bitmap->nfills = 0;
-	bitmap->x0 = INT_MAX;
-	bitmap->x1 = INT_MIN;
-	bitmap->y0 = INT_MAX;
-	bitmap->y1 = INT_MIN;
-}
+		for(d2tk_coord_t x = bitmap->x0; ; )
+		{
+			const d2tk_coord_t x0 = _d2tk_bitmap_scan(row, x, bitmap->x1, true);
 
-static inline void
-_d2tk_clip_clip(d2tk_core_t *core, d2tk_clip_t *dst, const d2tk_clip_t *src)
-{
-	*dst = *src;
+			if(x0 >= bitmap->x1)
+			{
+				break;
+			}
 
-	if(dst->x0 < 0)
-	{
-		dst->x0 = 0;
-	}
-	if(dst->x1 < 0)
-	{
-		dst->x1 = 0;
-	}
+			const d2tk_coord_t x1 = _d2tk_bitmap_scan(row, x0, bitmap->x1, false);
 
-	if(dst->y0 < 0)
-	{
-		dst->y0 = 0;
-	}
-	if(dst->y1 < 0)
-	{
-		dst->y1 = 0;
-	}
+			while( (o < nopen) && (bitmap->rects[bitmap->open[o]].x < x0) )
+			{
+				o++;
+			}
 
-	if(dst->x0 >= core->w)
-	{
-		dst->x0 = core->w - 1;
-	}
-	if(dst->x1 >= core->w)
-	{
-		dst->x1 = core->w - 1;
-	}
+			d2tk_rect_t *rect = (o < nopen)
+				? &bitmap->rects[bitmap->open[o]]
+				: NULL;
 
-	if(dst->y0 >= core->h)
-	{
-		dst->y0 = core->h - 1;
+			if(rect && (rect->x == x0) && (rect->w == x1 - x0) )
+			{
+				rect->h++;
+				bitmap->next[nnext++] = bitmap->open[o++];
+			}
+			else
+			{
+				bitmap->next[nnext++] = bitmap->nrects;
+				_d2tk_bitmap_rects_push(bitmap, x0, x1, y);
+			}
+
+			x = x1;
+		}
+
+		uint32_t *tmp = bitmap->open;
+		bitmap->open = bitmap->next;
+		bitmap->next = tmp;
+		nopen = nnext;
 	}
-	if(dst->y1 >= core->h)
+
+	// convert from tiles to px
+	for(size_t i = 0; i < bitmap->nrects; i++)
 	{
-		dst->y1 = core->h - 1;
+		d2tk_rect_t *rect = &bitmap->rects[i];
+		const d2tk_coord_t x1 = (rect->x + rect->w) << _D2TK_TILE_BITS;
+		const d2tk_coord_t y1 = (rect->y + rect->h) << _D2TK_TILE_BITS;
+
+		rect->x <<= _D2TK_TILE_BITS;
+		rect->y <<= _D2TK_TILE_BITS;
+		rect->w = (x1 > core->w ? core->w : x1) - rect->x;
+		rect->h = (y1 > core->h ? core->h : y1) - rect->y;
 	}
 }
 
@@ -455,13 +1022,22 @@ _d2tk_bitmap_fill(d2tk_core_t *core, const d2tk_clip_t *clip)
 	d2tk_bitmap_t *bitmap = &core->bitmap;
 
 	d2tk_clip_t dst;
-	_d2tk_clip_clip(core, &dst, clip);
+	if(!_d2tk_bitmap_tiles(core, clip, &dst))
+	{
+		return;
+	}
 
-	const size_t stride = (dst.x1 - dst.x0)*sizeof(uint32_t);
+	const d2tk_coord_t w0 = dst.x0 >> 6;
+	const d2tk_coord_t w1 = ((dst.x1 - 1) >> 6) + 1;
 
-	for(d2tk_coord_t y = dst.y0, Y = y*core->w; y < dst.y1; y++, Y+=core->w)
+	for(d2tk_coord_t y = dst.y0; y < dst.y1; y++)
 	{
-		memcpy(&bitmap->pixels[Y + dst.x0], bitmap->template, stride);
+		uint64_t *row = &bitmap->tiles[y*bitmap->stride];
+
+		for(d2tk_coord_t w = w0; w < w1; w++)
+		{
+			row[w] |= _d2tk_bitmap_mask(w, dst.x0, dst.x1);
+		}
 	}
 
 	// update area of interest
@@ -504,12 +1080,6 @@ _d2tk_com_get_end(d2tk_com_t *com)
 		+ com->size);
 }
 
-static inline bool
-_d2tk_com_not_end(d2tk_com_t *end, d2tk_com_t *bbox)
-{
-	return bbox < end;
-}
-
 static inline d2tk_com_t *
 _d2tk_com_next(d2tk_com_t *bbox)
 {
@@ -519,41 +1089,71 @@ _d2tk_com_next(d2tk_com_t *bbox)
 	return nxt;
 }
 
-const d2tk_com_t *
-d2tk_com_begin_const(const d2tk_com_t *com)
+static inline d2tk_com_t *
+_d2tk_com_iter_step(d2tk_com_iter_t *iter, d2tk_com_t *nxt)
 {
-	return _d2tk_com_begin((d2tk_com_t *)com);
+	while(true)
+	{
+		if(iter->seg)
+		{
+			if(nxt < iter->seg->body->segment.end)
+			{
+				return nxt;
+			}
+
+			// resume after segment
+			nxt = _d2tk_com_next((d2tk_com_t *)iter->seg);
+			iter->seg = NULL;
+		}
+
+		if(nxt >= iter->end)
+		{
+			return NULL;
+		}
+
+		if(nxt->instr != D2TK_INSTR_SEGMENT)
+		{
+			return nxt;
+		}
+
+		// descend into segment
+		iter->seg = nxt;
+		nxt = (d2tk_com_t *)nxt->body->segment.begin;
+	}
 }
 
-const d2tk_com_t *
-d2tk_com_get_end_const(const d2tk_com_t *com)
+static inline d2tk_com_t *
+_d2tk_com_iter_begin(d2tk_com_iter_t *iter, d2tk_com_t *com)
 {
-	return _d2tk_com_get_end((d2tk_com_t *)com);
+	iter->end = _d2tk_com_get_end(com);
+	iter->seg = NULL;
+
+	return _d2tk_com_iter_step(iter, _d2tk_com_begin(com));
 }
 
-bool
-d2tk_com_not_end_const(const d2tk_com_t *end, const d2tk_com_t *bbox)
+static inline d2tk_com_t *
+_d2tk_com_iter_next(d2tk_com_iter_t *iter, d2tk_com_t *bbox)
 {
-	return _d2tk_com_not_end((d2tk_com_t *)end, (d2tk_com_t *)bbox);
+	return _d2tk_com_iter_step(iter, _d2tk_com_next(bbox));
 }
 
 const d2tk_com_t *
-d2tk_com_next_const(const d2tk_com_t *bbox)
+d2tk_com_iter_begin_const(d2tk_com_iter_t *iter, const d2tk_com_t *com)
 {
-	return _d2tk_com_next((d2tk_com_t *)bbox);
+	return _d2tk_com_iter_begin(iter, (d2tk_com_t *)com);
 }
 
-#define D2TK_COM_FOREACH_FROM(COM, FROM, BBOX) \
-	for(d2tk_com_t *(BBOX) = (FROM), \
-			*__end = _d2tk_com_get_end((COM)); \
-		_d2tk_com_not_end(__end, (BBOX)); \
-		(BBOX) = _d2tk_com_next((BBOX)))
+const d2tk_com_t *
+d2tk_com_iter_next_const(d2tk_com_iter_t *iter, const d2tk_com_t *bbox)
+{
+	return _d2tk_com_iter_next(iter, (d2tk_com_t *)bbox);
+}
 
 #define D2TK_COM_FOREACH(COM, BBOX) \
-	for(d2tk_com_t *(BBOX) = _d2tk_com_begin((COM)), \
-			*__end = _d2tk_com_get_end((COM)); \
-		_d2tk_com_not_end(__end, (BBOX)); \
-		(BBOX) = _d2tk_com_next((BBOX)))
+	for(d2tk_com_iter_t __iter = { .once = true }; __iter.once; __iter.once = false) \
+		for(d2tk_com_t *(BBOX) = _d2tk_com_iter_begin(&__iter, (COM)); \
+			(BBOX); \
+			(BBOX) = _d2tk_com_iter_next(&__iter, (BBOX)))
 
 static inline void
 _d2tk_bbox_mask(d2tk_core_t *core, d2tk_com_t *com)
@@ -575,33 +1175,61 @@ _d2tk_bbox_mask(d2tk_core_t *core, d2tk_com_t *com)
 	body->dirty = true;
 }
 
-uint32_t *
-d2tk_core_get_pixels(d2tk_core_t *core, d2tk_rect_t *rect)
+const d2tk_rect_t *
+d2tk_core_get_dirty_rects(d2tk_core_t *core, size_t *nrects, d2tk_rect_t *rect)
 {
+	d2tk_bitmap_t *bitmap = &core->bitmap;
+
 	if(rect)
 	{
-		rect->x = core->bitmap.x0;
-		rect->y = core->bitmap.y0;
-		rect->w = core->bitmap.x1 - core->bitmap.x0;
-		rect->h = core->bitmap.y1 - core->bitmap.y0;
+		if(bitmap->nrects)
+		{
+			const d2tk_coord_t x1 = bitmap->x1 << _D2TK_TILE_BITS;
+			const d2tk_coord_t y1 = bitmap->y1 << _D2TK_TILE_BITS;
+
+			rect->x = bitmap->x0 << _D2TK_TILE_BITS;
+			rect->y = bitmap->y0 << _D2TK_TILE_BITS;
+			rect->w = (x1 > core->w ? core->w : x1) - rect->x;
+			rect->h = (y1 > core->h ? core->h : y1) - rect->y;
+		}
+		else
+		{
+			rect->x = 0;
+			rect->y = 0;
+			rect->w = 0;
+			rect->h = 0;
+		}
+	}
+
+	if(nrects)
+	{
+		*nrects = bitmap->nrects;
 	}
 
-	return core->bitmap.pixels;
+	return bitmap->rects;
 }
 
 static inline bool
 _d2tk_bitmap_query(d2tk_core_t *core, d2tk_body_bbox_t *body)
 {
-	const d2tk_clip_t *clip = &body->clip;
+	d2tk_bitmap_t *bitmap = &core->bitmap;
 
 	d2tk_clip_t dst;
-	_d2tk_clip_clip(core, &dst, clip);
+	if(!_d2tk_bitmap_tiles(core, &body->clip, &dst))
+	{
+		return false;
+	}
+
+	const d2tk_coord_t w0 = dst.x0 >> 6;
+	const d2tk_coord_t w1 = ((dst.x1 - 1) >> 6) + 1;
 
-	for(d2tk_coord_t y = dst.y0, Y = y*core->w; y < dst.y1; y++, Y+=core->w)
+	for(d2tk_coord_t y = dst.y0; y < dst.y1; y++)
 	{
-		for(d2tk_coord_t x = dst.x0; x < dst.x1; x++)
+		const uint64_t *row = &bitmap->tiles[y*bitmap->stride];
+
+		for(d2tk_coord_t w = w0; w < w1; w++)
 		{
-			if(core->bitmap.pixels[Y + x])
+			if(row[w] & _d2tk_bitmap_mask(w, dst.x0, dst.x1))
 			{
 				body->dirty = true;
 				return true;
@@ -615,21 +1243,43 @@ _d2tk_bitmap_query(d2tk_core_t *core, d2tk_body_bbox_t *body)
 static inline void
 _d2tk_mem_compact(d2tk_mem_t *mem)
 {
-	if(mem->offset == 0)
+	if(mem->offset > mem->high_water)
+	{
+		mem->high_water = mem->offset;
+	}
+
+	if(++mem->frames < _D2TK_MEM_WINDOW)
 	{
 		return;
 	}
 
-	for(size_t nsize = (mem->size >> 1);
-		mem->offset <= nsize;
-		nsize >>= 1)
+	// only shrink when a whole window fitted into a quarter
+	size_t nsize = mem->size;
+
+	while( (nsize > _D2TK_MEM_SIZE_MIN) && (mem->high_water <= (nsize >> 2)) )
+	{
+		nsize >>= 1;
+	}
+
+	if(nsize != mem->size)
 	{
 		uint8_t *nbuf = realloc(mem->buf, nsize);
-		assert(nbuf);
 
-		mem->buf = nbuf;
-		mem->size = nsize;
+		if(nbuf)
+		{
+			mem->buf = nbuf;
+			mem->size = nsize;
+			mem->shrinks += 1;
+
+			if(mem->used > nsize)
+			{
+				mem->used = nsize;
+			}
+		}
 	}
+
+	mem->high_water = 0;
+	mem->frames = 0;
 }
 
 static inline d2tk_com_t *
@@ -650,10 +1300,16 @@ _d2tk_mem_append_request(d2tk_mem_t *mem, size_t len)
 		uint8_t *nbuf = realloc(mem->buf, nsize);
 		assert(nbuf);
 
-		memset(&nbuf[mem->size], 0x0, mem->size);
+		memset(&nbuf[mem->size], 0x0, nsize - mem->size);
 
 		mem->buf = nbuf;
 		mem->size = nsize;
+		mem->grows += 1;
+	}
+
+	if(mem->offset + padlen > mem->used)
+	{
+		mem->used = mem->offset + padlen;
 	}
 
 	return &mem->buf[mem->offset];
@@ -680,6 +1336,7 @@ _d2tk_append_simple(d2tk_core_t *core, d2tk_instr_t type)
 		com->instr = type;
 
 		_d2tk_mem_append_advance(mem, len);
+		core->cur.commands += 1;
 	}
 }
 
@@ -708,6 +1365,7 @@ _d2tk_append_advance(d2tk_core_t *core, size_t size)
 	d2tk_mem_t *mem = &core->mem[core->curmem];
 
 	_d2tk_mem_append_advance(mem, len);
+	core->cur.commands += 1;
 }
 
 D2TK_API void
@@ -843,7 +1501,6 @@ void
 d2tk_core_set_bg_color(d2tk_core_t *core, uint32_t rgba)
 {
 	core->bg_color = htonl(rgba);
-	_d2tk_bitmap_template_refill(core);
 }
 
 uint32_t
@@ -929,6 +1586,24 @@ d2tk_core_rotate(d2tk_core_t *core, d2tk_coord_t deg)
 	}
 }
 
+static inline void
+_d2tk_append_segment(d2tk_core_t *core, const d2tk_widget_body_t *widget)
+{
+	const size_t len = sizeof(d2tk_body_segment_t);
+	d2tk_body_t *body = _d2tk_append_request(core, len, D2TK_INSTR_SEGMENT);
+
+	if(body)
+	{
+		d2tk_mem_t *mem = &core->mem[core->curmem];
+
+		body->segment.hash = widget->hash;
+		body->segment.begin = (const d2tk_com_t *)widget->buf;
+		body->segment.end = (const d2tk_com_t *)&widget->buf[widget->size];
+
+		_d2tk_mem_append_advance(mem, sizeof(d2tk_com_t) + len);
+	}
+}
+
 D2TK_API d2tk_widget_t *
 d2tk_core_widget_begin(d2tk_core_t *core, uint64_t hash, d2tk_widget_t *widget)
 {
@@ -939,18 +1614,39 @@ d2tk_core_widget_begin(d2tk_core_t *core, uint64_t hash, d2tk_widget_t *widget)
 		return NULL;
 	}
 
-	if(*widget->body) // bluntly use cached widget instruction buffer
+	if(*widget->body) // bluntly reuse cached widget instruction buffer
 	{
-		d2tk_mem_t *mem = &core->mem[core->curmem];
-		const d2tk_widget_body_t *body = (const d2tk_widget_body_t *)*widget->body;
-		uint8_t *dst = _d2tk_mem_append_request(mem, body->size);
+		d2tk_widget_body_t *body = (d2tk_widget_body_t *)*widget->body;
 
-		if(dst)
+		// clear dirty flags of earlier frames
+		for(d2tk_com_t *com = (d2tk_com_t *)body->buf;
+			com < (d2tk_com_t *)&body->buf[body->size];
+			com = _d2tk_com_next(com))
 		{
-			memcpy(dst, body->buf, body->size);
-			_d2tk_mem_append_advance(mem, body->size);
+			if(com->instr == D2TK_INSTR_BBOX)
+			{
+				com->body->bbox.dirty = false;
+			}
+		}
+
+		if(core->recording) // copy, as cached bodies must not refer to others
+		{
+			d2tk_mem_t *mem = &core->mem[core->curmem];
+			uint8_t *dst = _d2tk_mem_append_request(mem, body->size);
+
+			if(dst)
+			{
+				memcpy(dst, body->buf, body->size);
+				_d2tk_mem_append_advance(mem, body->size);
+			}
+		}
+		else if(body->size)
+		{
+			_d2tk_append_segment(core, body);
 		}
 
+		core->cur.commands += body->commands;
+
 		widget->ref = 0;
 
 		return NULL;
@@ -961,6 +1657,8 @@ d2tk_core_widget_begin(d2tk_core_t *core, uint64_t hash, d2tk_widget_t *widget)
 	const size_t ref = mem->offset;
 
 	widget->ref = ref;
+	widget->commands = core->cur.commands;
+	core->recording += 1;
 
 	return widget;
 }
@@ -980,11 +1678,18 @@ d2tk_core_widget_next(d2tk_core_t *core, d2tk_widget_t *widget)
 
 	const size_t buf_sz = ref - widget->ref;
 	const size_t body_sz = sizeof(d2tk_widget_body_t) + buf_sz;
-	d2tk_widget_body_t *body = malloc(body_sz);
+	uint32_t class;
+	d2tk_widget_body_t *body = _d2tk_slab_alloc(&core->slab, body_sz, &class);
+
+	core->recording -= 1;
 
 	// copy widget instruction buffer to cache
 	if(body)
 	{
+		body->next = NULL;
+		body->hash = d2tk_hash(&mem->buf[widget->ref], buf_sz);
+		body->commands = core->cur.commands - widget->commands;
+		body->class = class;
 		body->size = buf_sz;
 		memcpy(body->buf, &mem->buf[widget->ref], buf_sz);
 
@@ -1237,66 +1942,270 @@ d2tk_core_stroke_width(d2tk_core_t *core, d2tk_coord_t width)
 	}
 }
 
-D2TK_API int
-d2tk_core_pre(d2tk_core_t *core, void *pctx)
+D2TK_API int
+d2tk_core_pre(d2tk_core_t *core, void *pctx)
+{
+	d2tk_mem_t *curmem = &core->mem[core->curmem];
+
+	core->t0 = _d2tk_now();
+	core->recording = 0;
+
+	core->cur.mem.cleared = _d2tk_mem_reset(curmem);
+
+	core->parent = d2tk_core_bbox_container_push(core, 0,
+		&D2TK_RECT(0, 0, core->w, core->h));
+
+	return core->driver->context(core->data, pctx);
+}
+
+static inline bool
+_d2tk_com_equal_container(const d2tk_com_t *curcom, const d2tk_com_t *oldcom)
+{
+	const d2tk_body_bbox_t *curbbox = &curcom->body->bbox;
+	const d2tk_body_bbox_t *oldbbox = &oldcom->body->bbox;
+
+	if(  (curcom->instr == oldcom->instr)
+		&& (curbbox->clip.x0 == oldbbox->clip.x0)
+		&& (curbbox->clip.y0 == oldbbox->clip.y0) )
+	{
+		if(  (curcom->size == oldcom->size)
+			&& (curbbox->hash == oldbbox->hash) )
+		{
+			return true;
+		}
+		else if(curbbox->container && oldbbox->container)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static inline bool
+_d2tk_com_equal(const d2tk_com_t *curcom, const d2tk_com_t *oldcom)
+{
+	const d2tk_body_bbox_t *curbbox = &curcom->body->bbox;
+	const d2tk_body_bbox_t *oldbbox = &oldcom->body->bbox;
+
+	if(  (curcom->instr == oldcom->instr)
+		&& (curbbox->clip.x0 == oldbbox->clip.x0)
+		&& (curbbox->clip.y0 == oldbbox->clip.y0)
+		&& (curcom->size == oldcom->size)
+		&& (curbbox->hash == oldbbox->hash) )
+	{
+		return true;
+	}
+
+	return false;
+}
+
+static inline int
+_d2tk_diff_reserve(d2tk_diff_t *diff, size_t ncoms, size_t nslots)
+{
+	if(diff->ncoms + ncoms > diff->maxcoms)
+	{
+		size_t maxcoms = diff->maxcoms ? diff->maxcoms : 0x400;
+
+		while(diff->ncoms + ncoms > maxcoms)
+		{
+			maxcoms <<= 1;
+		}
+
+		d2tk_com_t **coms = realloc(diff->coms, maxcoms * sizeof(d2tk_com_t *));
+		if(!coms)
+		{
+			return 1;
+		}
+		diff->coms = coms;
+
+		uint32_t *next = realloc(diff->next, maxcoms * sizeof(uint32_t));
+		if(!next)
+		{
+			return 1;
+		}
+		diff->next = next;
+
+		diff->maxcoms = maxcoms;
+	}
+
+	if(diff->nslots + nslots > diff->maxslots)
+	{
+		size_t maxslots = diff->maxslots ? diff->maxslots : 0x800;
+
+		while(diff->nslots + nslots > maxslots)
+		{
+			maxslots <<= 1;
+		}
+
+		d2tk_diff_slot_t *slots = realloc(diff->slots,
+			maxslots * sizeof(d2tk_diff_slot_t));
+		if(!slots)
+		{
+			return 1;
+		}
+		diff->slots = slots;
+
+		diff->maxslots = maxslots;
+	}
+
+	return 0;
+}
+
+static inline void
+_d2tk_diff_deinit(d2tk_diff_t *diff)
+{
+	free(diff->coms);
+	free(diff->next);
+	free(diff->slots);
+	memset(diff, 0x0, sizeof(d2tk_diff_t));
+}
+
+static inline d2tk_diff_slot_t *
+_d2tk_diff_slot(d2tk_diff_slot_t *slots, size_t mask, const d2tk_clip_t *clip,
+	bool insert)
+{
+	const uint32_t x0 = clip->x0;
+	const uint32_t y0 = clip->y0;
+
+	for(size_t pos = ( (x0 * 0x9e3779b1U) ^ (y0 * 0x85ebca6bU) ) & mask;
+		;
+		pos = (pos + 1) & mask)
+	{
+		d2tk_diff_slot_t *slot = &slots[pos];
+
+		if(!slot->head)
+		{
+			if(insert)
+			{
+				slot->x0 = clip->x0;
+				slot->y0 = clip->y0;
+				return slot;
+			}
+
+			return NULL;
+		}
+
+		if( (slot->x0 == clip->x0) && (slot->y0 == clip->y0) )
+		{
+			return slot;
+		}
+	}
+}
+
+static inline void
+_d2tk_diff_appeared(d2tk_core_t *core, d2tk_com_t *curcom)
 {
-	d2tk_mem_t *curmem = &core->mem[core->curmem];
+#if D2TK_DEBUG
+	d2tk_body_bbox_t *curbbox = &curcom->body->bbox;
+
+	fprintf(stderr,
+		"\t   appeared (%i %i %i %i %i %i 0x%08"PRIx32")\n",
+		curbbox->clip.x0, curbbox->clip.y0,
+		curbbox->clip.x1, curbbox->clip.y1,
+		curcom->size, curcom->instr,
+		curbbox->hash);
+#endif
 
-	_d2tk_mem_reset(curmem);
+	core->cur.appeared += 1;
+	_d2tk_bbox_mask(core, curcom);
+}
 
-	core->parent = d2tk_core_bbox_container_push(core, 0,
-		&D2TK_RECT(0, 0, core->w, core->h));
+static inline void
+_d2tk_diff_disappeared(d2tk_core_t *core, d2tk_com_t *oldcom)
+{
+#if D2TK_DEBUG
+	d2tk_body_bbox_t *oldbbox = &oldcom->body->bbox;
+
+	fprintf(stderr,
+		"\tdisappeared (%i %i %i %i %i %i 0x%08"PRIx32")\n",
+		oldbbox->clip.x0, oldbbox->clip.y0,
+		oldbbox->clip.x1, oldbbox->clip.y1,
+		oldcom->size, oldcom->instr,
+		oldbbox->hash);
+#endif
 
-	return core->driver->context(core->data, pctx);
+	core->cur.disappeared += 1;
+	_d2tk_bbox_mask(core, oldcom);
 }
 
-static inline bool
-_d2tk_com_equal_container(const d2tk_com_t *curcom, const d2tk_com_t *oldcom)
+static inline void
+_d2tk_diff(d2tk_core_t *core, d2tk_com_t *curcom_ref, d2tk_com_t *oldcom_ref)
 {
-	const d2tk_body_bbox_t *curbbox = &curcom->body->bbox;
-	const d2tk_body_bbox_t *oldbbox = &oldcom->body->bbox;
+	d2tk_diff_t *diff = &core->diff;
+	size_t ncoms = 0;
 
-	if(  (curcom->instr == oldcom->instr)
-		&& (curbbox->clip.x0 == oldbbox->clip.x0)
-		&& (curbbox->clip.y0 == oldbbox->clip.y0) )
+	D2TK_COM_FOREACH(curcom_ref, curcom)
 	{
-		if(  (curcom->size == oldcom->size)
-			&& (curbbox->hash == oldbbox->hash) )
+		if(curcom->instr == D2TK_INSTR_BBOX)
 		{
-			return true;
+			ncoms += 1;
 		}
-		else if(curbbox->container && oldbbox->container)
+	}
+
+	size_t nslots = 0x10;
+
+	while(nslots < (ncoms << 1))
+	{
+		nslots <<= 1;
+	}
+
+	if(_d2tk_diff_reserve(diff, ncoms, nslots) != 0)
+	{
+		// out-of-memory, redraw everything
+		D2TK_COM_FOREACH(oldcom_ref, oldcom)
 		{
-			return true;
+			if(oldcom->instr == D2TK_INSTR_BBOX)
+			{
+				_d2tk_diff_disappeared(core, oldcom);
+			}
+		}
+
+		D2TK_COM_FOREACH(curcom_ref, curcom)
+		{
+			if(curcom->instr == D2TK_INSTR_BBOX)
+			{
+				_d2tk_diff_appeared(core, curcom);
+			}
 		}
+
+		return;
 	}
 
-	return false;
-}
+	// claim a region of the scratch space, nested containers stack on top
+	const size_t coms0 = diff->ncoms;
+	const size_t slots0 = diff->nslots;
+	const size_t mask = nslots - 1;
 
-static inline bool
-_d2tk_com_equal(const d2tk_com_t *curcom, const d2tk_com_t *oldcom)
-{
-	const d2tk_body_bbox_t *curbbox = &curcom->body->bbox;
-	const d2tk_body_bbox_t *oldbbox = &oldcom->body->bbox;
+	diff->ncoms += ncoms;
+	diff->nslots += nslots;
 
-	if(  (curcom->instr == oldcom->instr)
-		&& (curbbox->clip.x0 == oldbbox->clip.x0)
-		&& (curbbox->clip.y0 == oldbbox->clip.y0)
-		&& (curcom->size == oldcom->size)
-		&& (curbbox->hash == oldbbox->hash) )
 	{
-		return true;
+		size_t i = coms0;
+
+		D2TK_COM_FOREACH(curcom_ref, curcom)
+		{
+			if(curcom->instr == D2TK_INSTR_BBOX)
+			{
+				diff->coms[i++] = curcom;
+			}
+		}
 	}
 
-	return false;
-}
+	// index current bboxes by position, chains are in drawing order
+	memset(&diff->slots[slots0], 0x0, nslots * sizeof(d2tk_diff_slot_t));
+
+	for(size_t i = ncoms; i-- > 0; )
+	{
+		d2tk_diff_slot_t *slot = _d2tk_diff_slot(&diff->slots[slots0], mask,
+			&diff->coms[coms0 + i]->body->bbox.clip, true);
+
+		diff->next[coms0 + i] = slot->head;
+		slot->head = i + 1;
+	}
 
-static inline void
-_d2tk_diff(d2tk_core_t *core, d2tk_com_t *curcom_ref, d2tk_com_t *oldcom_ref)
-{
 	// look for (dis)appeared instructions
-	d2tk_com_t *tmpcom = _d2tk_com_begin(curcom_ref);
+	size_t tmp = 0;
 
 	D2TK_COM_FOREACH(oldcom_ref, oldcom)
 	{
@@ -1305,93 +2214,89 @@ _d2tk_diff(d2tk_core_t *core, d2tk_com_t *curcom_ref, d2tk_com_t *oldcom_ref)
 			continue;
 		}
 
-		bool match = false;
+		d2tk_diff_slot_t *slot = _d2tk_diff_slot(&diff->slots[slots0], mask,
+			&oldcom->body->bbox.clip, false);
+		size_t match = 0;
 
-		D2TK_COM_FOREACH_FROM(curcom_ref, tmpcom, curcom)
+		if(slot)
 		{
-			if(curcom->instr != D2TK_INSTR_BBOX)
+			// drop candidates which already have been passed
+			while(slot->head && (slot->head - 1 < tmp) )
 			{
-				continue;
+				slot->head = diff->next[coms0 + slot->head - 1];
 			}
 
 			// check for matching size, instruction, hash and position
-			if(_d2tk_com_equal_container(curcom, oldcom))
+			for(uint32_t j = slot->head; j; j = diff->next[coms0 + j - 1])
 			{
-				for(d2tk_com_t *curcom2 = tmpcom;
-					curcom2 != curcom;
-					curcom2 = _d2tk_com_next(curcom2))
-				{
-					if(curcom2->instr != D2TK_INSTR_BBOX)
-					{
-						continue;
-					}
-
-#if D2TK_DEBUG
-					d2tk_body_bbox_t *curbbox2 = &curcom2->body->bbox;
-
-					fprintf(stderr,
-						"\t   appeared (%i %i %i %i %i %i 0x%08"PRIx32")\n",
-						curbbox2->clip.x0, curbbox2->clip.y0,
-						curbbox2->clip.x1, curbbox2->clip.y1,
-						curcom2->size, curcom2->instr,
-						curbbox2->hash);
-#endif
-
-					_d2tk_bbox_mask(core, curcom2);
-				}
-
-				if(curcom->body->bbox.container && oldcom->body->bbox.container)
+				if(_d2tk_com_equal_container(diff->coms[coms0 + j - 1], oldcom))
 				{
-#if D2TK_DEBUG
-					fprintf(stderr, "\t   comparing nested containers\n");
-#endif
-					_d2tk_diff(core, curcom, oldcom);
+					match = j;
+					break;
 				}
-
-				match = true;
-				tmpcom = _d2tk_com_next(curcom);
-
-				break;
 			}
 		}
 
 		if(!match)
 		{
-#if D2TK_DEBUG
-			d2tk_body_bbox_t *oldbbox = &oldcom->body->bbox;
-
-			fprintf(stderr,
-				"\tdisappeared (%i %i %i %i %i %i 0x%08"PRIx32")\n",
-				oldbbox->clip.x0, oldbbox->clip.y0,
-				oldbbox->clip.x1, oldbbox->clip.y1,
-				oldcom->size, oldcom->instr,
-				oldbbox->hash);
-#endif
-
-			_d2tk_bbox_mask(core, oldcom);
+			_d2tk_diff_disappeared(core, oldcom);
+			continue;
 		}
-	}
 
-	D2TK_COM_FOREACH_FROM(curcom_ref, tmpcom, curcom2)
-	{
-		if(curcom2->instr != D2TK_INSTR_BBOX)
+		for( ; tmp < match - 1; tmp++)
 		{
-			continue;
+			_d2tk_diff_appeared(core, diff->coms[coms0 + tmp]);
 		}
 
-#if D2TK_DEBUG
-		d2tk_body_bbox_t *curbbox2 = &curcom2->body->bbox;
+		d2tk_com_t *curcom = diff->coms[coms0 + tmp];
 
-		fprintf(stderr,
-			"\t   appeared (%i %i %i %i %i %i 0x%08"PRIx32")\n",
-			curbbox2->clip.x0, curbbox2->clip.y0,
-			curbbox2->clip.x1, curbbox2->clip.y1,
-			curcom2->size, curcom2->instr,
-			curbbox2->hash);
+		core->cur.matched += 1;
+
+		if(curcom->body->bbox.container && oldcom->body->bbox.container)
+		{
+#if D2TK_DEBUG
+			fprintf(stderr, "\t   comparing nested containers\n");
 #endif
+			_d2tk_diff(core, curcom, oldcom);
+		}
+
+		tmp += 1;
+	}
 
-		_d2tk_bbox_mask(core, curcom2);
+	for( ; tmp < ncoms; tmp++)
+	{
+		_d2tk_diff_appeared(core, diff->coms[coms0 + tmp]);
 	}
+
+	diff->ncoms = coms0;
+	diff->nslots = slots0;
+}
+
+static inline void
+_d2tk_core_stats_publish(d2tk_core_t *core)
+{
+	d2tk_core_stats_t *cur = &core->cur;
+	const d2tk_mem_t *mem = &core->mem[core->curmem];
+	const d2tk_mem_t *alt = &core->mem[!core->curmem];
+
+	cur->frame = core->stats.frame + 1;
+	cur->mem.size = mem->size;
+	cur->mem.high_water = mem->high_water;
+	cur->mem.grows = mem->grows + alt->grows;
+	cur->mem.shrinks = mem->shrinks + alt->shrinks;
+	cur->sprites = core->sprites.stats;
+	cur->sprites.entries = core->sprites.nentries;
+	cur->memcaches = core->memcaches.stats;
+	cur->memcaches.entries = core->memcaches.nentries;
+	cur->extents = core->extents.stats;
+	cur->extents.entries = core->extents.nentries;
+
+	core->stats = *cur;
+
+	memset(cur, 0x0, sizeof(d2tk_core_stats_t));
+	memset(&core->sprites.stats, 0x0, sizeof(d2tk_core_cache_stats_t));
+	memset(&core->memcaches.stats, 0x0, sizeof(d2tk_core_cache_stats_t));
+	memset(&core->extents.stats, 0x0, sizeof(d2tk_core_cache_stats_t));
 }
 
 D2TK_API void
@@ -1403,6 +2308,9 @@ d2tk_core_post(d2tk_core_t *core)
 
 	d2tk_core_bbox_pop(core, core->parent);
 
+	core->cur.build = _d2tk_now() - core->t0;
+	core->cur.bytes = curmem->offset;
+
 	_d2tk_mem_compact(curmem);
 
 	d2tk_com_t *curcom = _d2tk_mem_get_com(curmem);
@@ -1421,10 +2329,17 @@ d2tk_core_post(d2tk_core_t *core)
 
 		_d2tk_sprites_free(core);
 		_d2tk_memcaches_free(core);
+		_d2tk_extents_free(core);
+
+		core->cur.full_refresh = true;
 	}
 	else if(!_d2tk_com_equal(curcom, oldcom))
 	{
+		const uint64_t t0 = _d2tk_now();
+
 		_d2tk_diff(core, curcom, oldcom);
+
+		core->cur.diff = _d2tk_now() - t0;
 	}
 
 	if(bitmap->nfills || core->full_refresh)
@@ -1443,28 +2358,50 @@ d2tk_core_post(d2tk_core_t *core)
 			tmp.h = core->h;
 
 			_d2tk_bitmap_fill(core, &tmp);
+			_d2tk_bitmap_rects(core);
 		}
 		else
 		{
 			static d2tk_clip_t tmp;
+			d2tk_rect_t rect;
+
+			_d2tk_bitmap_rects(core);
+			d2tk_core_get_dirty_rects(core, NULL, &rect);
 
-			tmp.x0 = bitmap->x0;
-			tmp.y0 = bitmap->y0;
-			tmp.x1 = bitmap->x1;
-			tmp.y1 = bitmap->y1;
-			tmp.w = bitmap->x1 - bitmap->x0;
-			tmp.h = bitmap->y1 - bitmap->y0;
+			tmp.x0 = rect.x;
+			tmp.y0 = rect.y;
+			tmp.x1 = rect.x + rect.w;
+			tmp.y1 = rect.y + rect.h;
+			tmp.w = rect.w;
+			tmp.h = rect.h;
 
 			aoi = &tmp;
 		}
 
+		core->cur.dirty_rects = bitmap->nrects;
+
+		for(size_t i = 0; i < bitmap->nrects; i++)
+		{
+			const d2tk_rect_t *rect = &bitmap->rects[i];
+
+			core->cur.dirty_area += (uint64_t)rect->w * rect->h;
+		}
+
 #if D2TK_DEBUG
-		fprintf(stderr, "\tnfills: %zu\n", bitmap->nfills);
+		fprintf(stderr, "\tnfills: %zu, nrects: %zu\n", bitmap->nfills,
+			bitmap->nrects);
 #endif
 		for(unsigned pass = 0; pass < 2; pass++)
 		{
+			d2tk_core_pass_stats_t *stats = &core->cur.pass[pass];
+			const uint64_t t0 = _d2tk_now();
+
 			core->driver->pre(core->data, core, core->w, core->h, pass);
 
+			const uint64_t t1 = _d2tk_now();
+
+			stats->pre = t1 - t0;
+
 			d2tk_com_t *curcom = _d2tk_mem_get_com(curmem);
 
 			D2TK_COM_FOREACH(curcom, com)
@@ -1541,22 +2478,123 @@ d2tk_core_post(d2tk_core_t *core)
 					body->clip.y0, clip, pass);
 			}
 
-			if(!core->driver->post(core->data, core, core->w, core->h, pass))
+			const uint64_t t2 = _d2tk_now();
+			const bool again = core->driver->post(core->data, core, core->w, core->h,
+				pass);
+
+			stats->process = t2 - t1;
+			stats->post = _d2tk_now() - t2;
+
+			if(!again)
 			{
 				break; // does NOT need 2nd pass
 			}
 		}
 	}
 
+	const uint64_t t0 = _d2tk_now();
+
 	core->driver->end(core->data, core, core->w, core->h);
 
+	core->cur.end = _d2tk_now() - t0;
+
 	_d2tk_sprites_gc(core);
 	_d2tk_memcaches_gc(core);
+	_d2tk_memcaches_retire(core);
+	_d2tk_extents_gc(core);
+
+	_d2tk_core_stats_publish(core);
 
 	core->full_refresh = false;
 	core->curmem = !core->curmem;
 }
 
+#if D2TK_FONTCONFIG
+typedef struct _d2tk_font_path_t d2tk_font_path_t;
+typedef struct _d2tk_fonts_t d2tk_fonts_t;
+
+struct _d2tk_font_path_t {
+	uint64_t hash;
+	char *rel_path;
+	char *abs_path;
+};
+
+struct _d2tk_fonts_t {
+	pthread_mutex_t lock;
+	FcConfig *config;
+	unsigned npaths;
+	d2tk_font_path_t paths [_D2TK_FONT_PATHS_MAX];
+};
+
+// process-wide, shared by all cores and the font preloader, kept alive until
+// unload, so reopening a UI does not have to scan the font directories again
+static d2tk_fonts_t _d2tk_fonts = {
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+__attribute__((destructor)) static void
+_d2tk_fonts_deinit()
+{
+	d2tk_fonts_t *fonts = &_d2tk_fonts;
+
+	for(unsigned i = 0; i < fonts->npaths; i++)
+	{
+		d2tk_font_path_t *path = &fonts->paths[i];
+
+		free(path->rel_path);
+		free(path->abs_path);
+	}
+
+	fonts->npaths = 0;
+
+	if(fonts->config)
+	{
+		FcConfigDestroy(fonts->config);
+		fonts->config = NULL;
+	}
+}
+
+static int
+_d2tk_fonts_match(d2tk_fonts_t *fonts, const char *rel_path, size_t abs_len,
+	char *abs_path)
+{
+	int ret = 1;
+	FcChar8 pattern [PATH_MAX];
+
+	snprintf((char *)pattern, sizeof(pattern), "%s:fontformat=TrueType", rel_path);
+
+	// scanning the font directories is by far the most expensive part
+	if(!fonts->config)
+	{
+		fonts->config = FcInitLoadConfigAndFonts();
+	}
+
+	FcPattern *pat = FcNameParse(pattern);
+	FcConfigSubstitute(fonts->config, pat, FcMatchPattern);
+	FcDefaultSubstitute(pat);
+
+	//FcPatternPrint(pat);
+
+	FcResult result;
+	FcPattern *font = FcFontMatch(fonts->config, pat, &result);
+	if(font)
+	{
+		FcChar8 *file = NULL;
+		if(FcPatternGetString(font, FC_FILE, 0, &file) == FcResultMatch)
+		{
+			snprintf(abs_path, abs_len, "%s", file);
+			ret = 0;
+		}
+
+		FcPatternDestroy(font);
+	}
+
+	FcPatternDestroy(pat);
+
+	return ret;
+}
+#endif
+
 D2TK_API d2tk_core_t *
 d2tk_core_new(const d2tk_core_driver_t *driver, void *data)
 {
@@ -1569,8 +2607,8 @@ d2tk_core_new(const d2tk_core_driver_t *driver, void *data)
 	core->driver = driver;
 	core->data = data;
 
-	_d2tk_mem_init(&core->mem[0], 8192);
-	_d2tk_mem_init(&core->mem[1], 8192);
+	_d2tk_mem_init(&core->mem[0], _D2TK_MEM_SIZE_MIN);
+	_d2tk_mem_init(&core->mem[1], _D2TK_MEM_SIZE_MIN);
 
 	{
 		core->curmem = 0;
@@ -1591,9 +2629,11 @@ d2tk_core_new(const d2tk_core_driver_t *driver, void *data)
 	}
 
 	core->curmem = 0;
+	memset(&core->cur, 0x0, sizeof(d2tk_core_stats_t));
 
-	core->ttl.sprites = _D2TK_SPRITES_TTL;
-	core->ttl.memcaches = _D2TK_MEMCACHES_TTL;
+	core->sprites.ttl = _D2TK_SPRITES_TTL;
+	core->memcaches.ttl = _D2TK_MEMCACHES_TTL;
+	core->extents.ttl = _D2TK_SPRITES_TTL;
 
 	return core;
 }
@@ -1601,8 +2641,9 @@ d2tk_core_new(const d2tk_core_driver_t *driver, void *data)
 D2TK_API void
 d2tk_core_set_ttls(d2tk_core_t *core, uint32_t sprites, uint32_t memcaches)
 {
-	core->ttl.sprites  = sprites;
-	core->ttl.memcaches = memcaches;
+	core->sprites.ttl = sprites;
+	core->memcaches.ttl = memcaches;
+	core->extents.ttl = sprites; // measured alongside the sprites they end up in
 }
 
 D2TK_API void
@@ -1611,8 +2652,13 @@ d2tk_core_free(d2tk_core_t *core)
 	_d2tk_mem_deinit(&core->mem[0]);
 	_d2tk_mem_deinit(&core->mem[1]);
 	_d2tk_bitmap_deinit(&core->bitmap);
-	_d2tk_sprites_free(core);
-	_d2tk_memcaches_free(core);
+	_d2tk_cache_deinit(core, &core->sprites, _d2tk_sprite_release);
+	_d2tk_cache_deinit(core, &core->memcaches, _d2tk_memcache_release);
+	_d2tk_cache_deinit(core, &core->extents, _d2tk_extent_release);
+	_d2tk_memcaches_retire(core);
+	_d2tk_memcaches_retire(core);
+	_d2tk_slab_deinit(&core->slab);
+	_d2tk_diff_deinit(&core->diff);
 
 	free(core);
 }
@@ -1655,34 +2701,48 @@ d2tk_core_get_font_path(d2tk_core_t *core, const char *bundle_path,
 #if D2TK_FONTCONFIG
 	(void)core;
 	(void)bundle_path;
-	FcChar8 pattern [PATH_MAX];
-
-	snprintf((char *)pattern, sizeof(pattern), "%s:fontformat=TrueType", rel_path);
-
-	FcConfig *config = FcInitLoadConfigAndFonts();
-	FcPattern *pat = FcNameParse(pattern);
-	FcConfigSubstitute(config, pat, FcMatchPattern);
-	FcDefaultSubstitute(pat);
+	d2tk_fonts_t *fonts = &_d2tk_fonts;
+	const uint64_t hash = d2tk_hash(rel_path, strlen(rel_path));
 
-	//FcPatternPrint(pat);
+	pthread_mutex_lock(&fonts->lock);
 
-	FcResult result;
-	FcPattern *font = FcFontMatch(config, pat, &result);
-	if(font)
+	for(unsigned i = 0; i < fonts->npaths; i++)
 	{
-		FcChar8 *file = NULL;
-		if(FcPatternGetString(font, FC_FILE, 0, &file) == FcResultMatch)
+		const d2tk_font_path_t *path = &fonts->paths[i];
+
+		if( (path->hash == hash) && !strcmp(path->rel_path, rel_path) )
 		{
-			snprintf(abs_path, abs_len, "%s", file);
+			snprintf(abs_path, abs_len, "%s", path->abs_path);
 			ret = 0;
+			break;
 		}
-
-		FcPatternDestroy(font);
 	}
 
-	FcPatternDestroy(pat);
+	if(ret != 0)
+	{
+		ret = _d2tk_fonts_match(fonts, rel_path, abs_len, abs_path);
+
+		if( (ret == 0) && (fonts->npaths < _D2TK_FONT_PATHS_MAX) )
+		{
+			d2tk_font_path_t *path = &fonts->paths[fonts->npaths];
+
+			path->rel_path = strdup(rel_path);
+			path->abs_path = strdup(abs_path);
 
-	FcConfigDestroy(config);
+			if(path->rel_path && path->abs_path)
+			{
+				path->hash = hash;
+				fonts->npaths += 1;
+			}
+			else
+			{
+				free(path->rel_path);
+				free(path->abs_path);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&fonts->lock);
 #else
 	(void)core;
 	snprintf(abs_path, abs_len, "%s%s.ttf", bundle_path, rel_path);
@@ -1692,9 +2752,108 @@ d2tk_core_get_font_path(d2tk_core_t *core, const char *bundle_path,
 	return ret;
 }
 
+struct _d2tk_font_preload_t {
+	pthread_t thread;
+	const char *bundle_path;
+	const char **faces;
+};
+
+// pull the font file into the page cache, so the backend's parse does not
+// have to wait on the disk
+static void
+_d2tk_font_preload_warm(const char *abs_path)
+{
+	FILE *f = fopen(abs_path, "rb");
+	if(!f)
+	{
+		return;
+	}
+
+	char buf [0x4000];
+	while(fread(buf, 1, sizeof(buf), f) == sizeof(buf))
+	{
+		// read until EOF
+	}
+
+	fclose(f);
+}
+
+static void *
+_d2tk_font_preload_thread(void *data)
+{
+	d2tk_font_preload_t *preload = data;
+
+	for(const char **face = preload->faces; *face; face++)
+	{
+		char abs_path [PATH_MAX];
+
+		if(d2tk_core_get_font_path(NULL, preload->bundle_path, *face,
+			sizeof(abs_path), abs_path) == 0)
+		{
+			_d2tk_font_preload_warm(abs_path);
+		}
+	}
+
+	return NULL;
+}
+
+d2tk_font_preload_t *
+d2tk_font_preload_new(const char *bundle_path, const char **faces)
+{
+	d2tk_font_preload_t *preload = calloc(1, sizeof(d2tk_font_preload_t));
+	if(!preload)
+	{
+		return NULL;
+	}
+
+	preload->bundle_path = bundle_path;
+	preload->faces = faces;
+
+	if(pthread_create(&preload->thread, NULL, _d2tk_font_preload_thread,
+		preload) != 0)
+	{
+		free(preload);
+		return NULL;
+	}
+
+	return preload;
+}
+
+void
+d2tk_font_preload_free(d2tk_font_preload_t *preload)
+{
+	pthread_join(preload->thread, NULL);
+	free(preload);
+}
+
+D2TK_API const d2tk_core_stats_t *
+d2tk_core_get_stats(d2tk_core_t *core)
+{
+	return &core->stats;
+}
+
 D2TK_API int
 d2tk_core_text_extent(d2tk_core_t *core, size_t len, const char *buf,
 	d2tk_coord_t h)
 {
-	return core->driver->text_extent(core->data, len, buf, h);
+	const d2tk_hash_dict_t dict [] = {
+		{ &h, sizeof(d2tk_coord_t) },
+		{ buf, len },
+		{ NULL, 0 }
+	};
+	const uint64_t hash = d2tk_hash_dict(dict);
+	uintptr_t *extent = _d2tk_cache_get(&core->extents, hash, 0);
+
+	if(!extent)
+	{
+		return core->driver->text_extent(core->data, len, buf, h);
+	}
+
+	// offset by one, as a zero body marks a fresh entry
+	if(!*extent)
+	{
+		*extent = core->driver->text_extent(core->data, len, buf, h) + 1;
+	}
+
+	return *extent - 1;
 }
@@ -64,7 +64,9 @@ typedef struct _d2tk_body_bitmap_t d2tk_body_bitmap_t;
 typedef struct _d2tk_body_custom_t d2tk_body_custom_t;
 typedef struct _d2tk_body_stroke_width_t d2tk_body_stroke_width_t;
 typedef struct _d2tk_body_bbox_t d2tk_body_bbox_t;
+typedef struct _d2tk_body_segment_t d2tk_body_segment_t;
 typedef union _d2tk_body_t d2tk_body_t;
+typedef struct _d2tk_com_iter_t d2tk_com_iter_t;
 
 struct _d2tk_clip_t {
 	d2tk_coord_t x0;
@@ -215,6 +217,13 @@ struct _d2tk_body_bbox_t {
 	d2tk_clip_t clip;
 };
 
+// reference to the commands of a cached widget, never nested
+struct _d2tk_body_segment_t {
+	uint64_t hash;
+	const d2tk_com_t *begin;
+	const d2tk_com_t *end;
+};
+
 union _d2tk_body_t {
 	d2tk_body_move_to_t move_to;
 	d2tk_body_line_to_t line_to;
@@ -234,6 +243,7 @@ union _d2tk_body_t {
 	d2tk_body_bitmap_t bitmap;
 	d2tk_body_stroke_width_t stroke_width;
 	d2tk_body_bbox_t bbox;
+	d2tk_body_segment_t segment;
 };
 
 typedef enum _d2tk_instr_t {
@@ -261,7 +271,8 @@ typedef enum _d2tk_instr_t {
 	D2TK_INSTR_IMAGE,
 	D2TK_INSTR_BITMAP,
 	D2TK_INSTR_CUSTOM,
-	D2TK_INSTR_STROKE_WIDTH
+	D2TK_INSTR_STROKE_WIDTH,
+	D2TK_INSTR_SEGMENT
 } d2tk_instr_t;
 
 struct _d2tk_com_t {
@@ -270,29 +281,30 @@ struct _d2tk_com_t {
 	d2tk_body_t body [] __attribute__((aligned(8)));
 };
 
+struct _d2tk_com_iter_t {
+	const d2tk_com_t *end;
+	const d2tk_com_t *seg; // segment currently walked, NULL if none
+	bool once;
+};
+
 uintptr_t *
 d2tk_core_get_sprite(d2tk_core_t *core, uint64_t hash, uint8_t type);
 
 const d2tk_com_t *
-d2tk_com_begin_const(const d2tk_com_t *com);
+d2tk_com_iter_begin_const(d2tk_com_iter_t *iter, const d2tk_com_t *com);
 
 const d2tk_com_t *
-d2tk_com_get_end_const(const d2tk_com_t *com);
-
-bool
-d2tk_com_not_end_const(const d2tk_com_t *end, const d2tk_com_t *bbox);
-
-const d2tk_com_t *
-d2tk_com_next_const(const d2tk_com_t *bbox);
+d2tk_com_iter_next_const(d2tk_com_iter_t *iter, const d2tk_com_t *bbox);
 
+// walks the children of a bbox, steps through segments transparently
 #define D2TK_COM_FOREACH_CONST(COM, BBOX) \
-	for(const d2tk_com_t *(BBOX) = d2tk_com_begin_const((COM)), \
-			*__end = d2tk_com_get_end_const((COM)); \
-		d2tk_com_not_end_const(__end, (BBOX)); \
-		(BBOX) = d2tk_com_next_const((BBOX)))
+	for(d2tk_com_iter_t __iter = { .once = true }; __iter.once; __iter.once = false) \
+		for(const d2tk_com_t *(BBOX) = d2tk_com_iter_begin_const(&__iter, (COM)); \
+			(BBOX); \
+			(BBOX) = d2tk_com_iter_next_const(&__iter, (BBOX)))
 
-uint32_t *
-d2tk_core_get_pixels(d2tk_core_t *core, d2tk_rect_t *rect);
+const d2tk_rect_t *
+d2tk_core_get_dirty_rects(d2tk_core_t *core, size_t *nrects, d2tk_rect_t *rect);
 
 void
 d2tk_core_set_bg_color(d2tk_core_t *core, uint32_t rgba);
@@ -304,6 +316,15 @@ int
 d2tk_core_get_font_path(d2tk_core_t *core, const char *bundle_path,
 	const char *rel_path, size_t abs_len, char *abs_path);
 
+typedef struct _d2tk_font_preload_t d2tk_font_preload_t;
+
+// resolves and reads the NULL-terminated faces on a background thread
+d2tk_font_preload_t *
+d2tk_font_preload_new(const char *bundle_path, const char **faces);
+
+void
+d2tk_font_preload_free(d2tk_font_preload_t *preload);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,7 +28,11 @@
 #include <libudev.h>
 #include <libinput.h>
 
-#include <cairo.h>
+#if defined(D2TK_BACKEND_SOFT)
+#	include <d2tk/backend_soft.h>
+#else
+#	include <cairo.h>
+#endif
 
 #include "core_internal.h"
 #include <d2tk/frontend_fbdev.h>
@@ -56,7 +60,11 @@ struct _d2tk_frontend_t {
 	} kbd;
 	d2tk_base_t *base;
 	void *ctx;
+#if defined(D2TK_BACKEND_SOFT)
+	d2tk_soft_target_t target;
+#else
 	cairo_t *cr;
+#endif
 };
 
 static int
@@ -112,11 +120,9 @@ _d2tk_frontend_destroy(void *data)
 	udev_unref(fbdev->udev);
 }
 
-static cairo_surface_t *
+static void *
 _d2tk_frontend_create(d2tk_frontend_t *fbdev, const char *fb_device)
 {
-	cairo_surface_t *surface;
-
 	fbdev->udev = udev_new();
 	if(!fbdev->udev)
 	{
@@ -159,10 +165,19 @@ _d2tk_frontend_create(d2tk_frontend_t *fbdev, const char *fb_device)
 		fprintf(stderr, "Error: failed to map framebuffer fbdev to memory\n");
 		goto handle_ioctl_error;
 	}
+	fbdev->screensize = fbdev->finfo.smem_len;
 
+#if defined(D2TK_BACKEND_SOFT)
+	// render straight into the mapped framebuffer
+	fbdev->target.argb = (uint32_t *)fbdev->data;
+	fbdev->target.stride = fbdev->finfo.smem_len / fbdev->vinfo.yres_virtual;
+	fbdev->target.w = fbdev->vinfo.xres_virtual;
+	fbdev->target.h = fbdev->vinfo.yres_virtual;
 
+	return &fbdev->target;
+#else
 	/* Create the cairo surface which will be used to draw to */
-	surface = cairo_image_surface_create_for_data(fbdev->data,
+	cairo_surface_t *surface = cairo_image_surface_create_for_data(fbdev->data,
 			CAIRO_FORMAT_RGB24,
 			fbdev->vinfo.xres_virtual,
 			fbdev->vinfo.yres_virtual,
@@ -172,6 +187,7 @@ _d2tk_frontend_create(d2tk_frontend_t *fbdev, const char *fb_device)
 			&_d2tk_frontend_destroy);
 
 	return surface;
+#endif
 
 handle_ioctl_error:
 	close(fbdev->fd.fb);
@@ -199,7 +215,11 @@ _d2tk_frontend_expose(d2tk_frontend_t *fbdev)
 
 	do
 	{
+#if defined(D2TK_BACKEND_SOFT)
+		if(d2tk_base_pre(base, &fbdev->target) == 0)
+#else
 		if(d2tk_base_pre(base, fbdev->cr) == 0)
+#endif
 		{
 			fbdev->config->expose(fbdev->config->data, w, h);
 
@@ -701,10 +721,12 @@ d2tk_frontend_get_size(d2tk_frontend_t *fbdev, d2tk_coord_t *w, d2tk_coord_t *h)
 D2TK_API void
 d2tk_frontend_free(d2tk_frontend_t *fbdev)
 {
+#if !defined(D2TK_BACKEND_SOFT)
 	if(fbdev->cr)
 	{
 		cairo_destroy(fbdev->cr);
 	}
+#endif
 
 	if(fbdev->ctx)
 	{
@@ -717,6 +739,10 @@ d2tk_frontend_free(d2tk_frontend_t *fbdev)
 
 	//FIXME fbdevDestroy(fbdev->view);
 
+#if defined(D2TK_BACKEND_SOFT)
+	_d2tk_frontend_destroy(fbdev); // no cairo surface owns the mapping
+#endif
+
 	free(fbdev);
 }
 
@@ -731,8 +757,12 @@ d2tk_fbdev_new(const d2tk_fbdev_config_t *config)
 
 	fbdev->config = config;
 
+#if defined(D2TK_BACKEND_SOFT)
+	_d2tk_frontend_create(fbdev, fbdev->config->fb_device);
+#else
 	cairo_surface_t *surf = _d2tk_frontend_create(fbdev, fbdev->config->fb_device);
 	fbdev->cr = cairo_create(surf);
+#endif
 
 	fbdev->ctx = d2tk_core_driver.new(config->bundle_path);
 
@@ -0,0 +1,484 @@
+/*
+ * Copyright (c) 2018-2019 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "core_internal.h"
+#include <d2tk/frontend_offscreen.h>
+#include <d2tk/backend_soft.h>
+
+#include <d2tk/backend.h>
+
+#define D2TK_OFFSCREEN_DEFLATE_MAX 0xffff // max length of stored deflate block
+
+struct _d2tk_frontend_t {
+	const d2tk_offscreen_config_t *config;
+	d2tk_soft_target_t target;
+	d2tk_offscreen_timing_t timing;
+	struct {
+		char *type;
+		void *buf;
+		size_t len;
+	} clipboard;
+	d2tk_base_t *base;
+	void *ctx;
+};
+
+static uint64_t
+_d2tk_frontend_now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+static int
+_d2tk_frontend_resize(d2tk_frontend_t *doff, d2tk_coord_t w, d2tk_coord_t h)
+{
+	uint32_t *argb = calloc(w*h, sizeof(uint32_t));
+	if(!argb)
+	{
+		fprintf(stderr, "[%s] calloc failed: '%s'\n", __func__, strerror(errno));
+		return 1;
+	}
+
+	free(doff->target.argb);
+	doff->target.argb = argb;
+	doff->target.stride = w*sizeof(uint32_t);
+	doff->target.w = w;
+	doff->target.h = h;
+
+	return 0;
+}
+
+static inline void
+_d2tk_frontend_expose(d2tk_frontend_t *doff)
+{
+	d2tk_base_t *base = doff->base;
+	d2tk_offscreen_timing_t *timing = &doff->timing;
+
+	d2tk_coord_t w;
+	d2tk_coord_t h;
+	d2tk_base_get_dimensions(base, &w, &h);
+
+	const uint64_t t0 = _d2tk_frontend_now();
+
+	do
+	{
+		if(d2tk_base_pre(base, &doff->target) == 0)
+		{
+			doff->config->expose(doff->config->data, w, h);
+
+			d2tk_base_post(base);
+		}
+	} while(d2tk_base_get_again(base));
+
+	const uint64_t dt = _d2tk_frontend_now() - t0;
+
+	if( (timing->frames == 0) || (dt < timing->min_ns) )
+	{
+		timing->min_ns = dt;
+	}
+
+	if(dt > timing->max_ns)
+	{
+		timing->max_ns = dt;
+	}
+
+	timing->last_ns = dt;
+	timing->sum_ns += dt;
+	timing->frames++;
+}
+
+static uint32_t
+_d2tk_crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	static uint32_t table [256];
+
+	if(!table[1])
+	{
+		for(uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+
+			for(unsigned k = 0; k < 8; k++)
+			{
+				c = (c & 1)
+					? 0xedb88320 ^ (c >> 1)
+					: c >> 1;
+			}
+
+			table[i] = c;
+		}
+	}
+
+	crc = ~crc;
+
+	for(size_t i = 0; i < len; i++)
+	{
+		crc = table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+	}
+
+	return ~crc;
+}
+
+static inline uint8_t *
+_d2tk_be32(uint8_t *dst, uint32_t val)
+{
+	dst[0] = val >> 24;
+	dst[1] = val >> 16;
+	dst[2] = val >> 8;
+	dst[3] = val;
+
+	return dst + 4;
+}
+
+static int
+_d2tk_png_chunk(FILE *f, const char *type, const uint8_t *buf, size_t len)
+{
+	uint8_t hdr [8];
+	uint8_t crc [4];
+
+	_d2tk_be32(hdr, len);
+	memcpy(&hdr[4], type, 4);
+	_d2tk_be32(crc, _d2tk_crc32(_d2tk_crc32(0, &hdr[4], 4), buf, len));
+
+	if(  (fwrite(hdr, sizeof(hdr), 1, f) != 1)
+		|| (len && (fwrite(buf, len, 1, f) != 1))
+		|| (fwrite(crc, sizeof(crc), 1, f) != 1) )
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+D2TK_API int
+d2tk_frontend_poll(d2tk_frontend_t *doff, double timeout __attribute__((unused)))
+{
+	d2tk_base_probe(doff->base);
+
+	_d2tk_frontend_expose(doff);
+
+	return 0;
+}
+
+D2TK_API int
+d2tk_frontend_get_file_descriptors(d2tk_frontend_t *doff, int *fds, int numfds)
+{
+	return d2tk_base_get_file_descriptors(doff->base, fds, numfds);
+}
+
+D2TK_API int
+d2tk_frontend_step(d2tk_frontend_t *doff)
+{
+	return d2tk_frontend_poll(doff, 0.0);
+}
+
+D2TK_API void
+d2tk_frontend_run(d2tk_frontend_t *doff, const sig_atomic_t *done)
+{
+	while(!*done)
+	{
+		if(d2tk_frontend_poll(doff, -1.0))
+		{
+			break;
+		}
+	}
+}
+
+D2TK_API void
+d2tk_frontend_free(d2tk_frontend_t *doff)
+{
+	if(doff->ctx)
+	{
+		if(doff->base)
+		{
+			d2tk_base_free(doff->base);
+		}
+		d2tk_core_driver.free(doff->ctx);
+	}
+
+	free(doff->clipboard.type);
+	free(doff->clipboard.buf);
+	free(doff->target.argb);
+	free(doff);
+}
+
+D2TK_API float
+d2tk_frontend_get_scale()
+{
+	return 1.f;
+}
+
+D2TK_API d2tk_frontend_t *
+d2tk_offscreen_new(const d2tk_offscreen_config_t *config)
+{
+	d2tk_frontend_t *doff = calloc(1, sizeof(d2tk_frontend_t));
+	if(!doff)
+	{
+		goto fail;
+	}
+
+	doff->config = config;
+
+	if(_d2tk_frontend_resize(doff, config->w, config->h))
+	{
+		goto fail;
+	}
+
+	doff->ctx = d2tk_core_driver.new(config->bundle_path);
+	if(!doff->ctx)
+	{
+		goto fail;
+	}
+
+	doff->base = d2tk_base_new(&d2tk_core_driver, doff->ctx);
+	if(!doff->base)
+	{
+		goto fail;
+	}
+
+	d2tk_base_set_dimensions(doff->base, config->w, config->h);
+
+	return doff;
+
+fail:
+	if(doff)
+	{
+		d2tk_frontend_free(doff);
+	}
+
+	return NULL;
+}
+
+D2TK_API void
+d2tk_frontend_redisplay(d2tk_frontend_t *doff)
+{
+	(void)doff; // every step renders a frame anyways
+}
+
+D2TK_API int
+d2tk_frontend_set_size(d2tk_frontend_t *doff, d2tk_coord_t w, d2tk_coord_t h)
+{
+	if(_d2tk_frontend_resize(doff, w, h))
+	{
+		return 1;
+	}
+
+	d2tk_base_set_dimensions(doff->base, w, h);
+
+	return 0;
+}
+
+D2TK_API int
+d2tk_frontend_get_size(d2tk_frontend_t *doff, d2tk_coord_t *w, d2tk_coord_t *h)
+{
+	if(w)
+	{
+		*w = doff->target.w;
+	}
+
+	if(h)
+	{
+		*h = doff->target.h;
+	}
+
+	return 0;
+}
+
+D2TK_API d2tk_base_t *
+d2tk_frontend_get_base(d2tk_frontend_t *doff)
+{
+	return doff->base;
+}
+
+D2TK_API int
+d2tk_frontend_set_clipboard(d2tk_frontend_t *doff, const char *type,
+	const void *buf, size_t buf_len)
+{
+	char *type_dup = strdup(type);
+	void *buf_dup = malloc(buf_len);
+
+	if(!type_dup || !buf_dup)
+	{
+		free(type_dup);
+		free(buf_dup);
+		return 1;
+	}
+
+	memcpy(buf_dup, buf, buf_len);
+
+	free(doff->clipboard.type);
+	free(doff->clipboard.buf);
+	doff->clipboard.type = type_dup;
+	doff->clipboard.buf = buf_dup;
+	doff->clipboard.len = buf_len;
+
+	return 0;
+}
+
+D2TK_API const void *
+d2tk_frontend_get_clipboard(d2tk_frontend_t *doff, const char **type,
+	size_t *buf_len)
+{
+	*type = doff->clipboard.type;
+	*buf_len = doff->clipboard.len;
+
+	return doff->clipboard.buf;
+}
+
+D2TK_API const uint32_t *
+d2tk_offscreen_get_pixels(d2tk_frontend_t *doff, size_t *stride)
+{
+	if(stride)
+	{
+		*stride = doff->target.stride;
+	}
+
+	return doff->target.argb;
+}
+
+D2TK_API const d2tk_offscreen_timing_t *
+d2tk_offscreen_get_timing(d2tk_frontend_t *doff)
+{
+	return &doff->timing;
+}
+
+D2TK_API void
+d2tk_offscreen_reset_timing(d2tk_frontend_t *doff)
+{
+	memset(&doff->timing, 0x0, sizeof(doff->timing));
+}
+
+// RGBA PNG with uncompressed deflate blocks, to not depend on zlib
+D2TK_API int
+d2tk_offscreen_dump_png(d2tk_frontend_t *doff, const char *path)
+{
+	static const uint8_t sig [8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	const d2tk_soft_target_t *target = &doff->target;
+	const size_t rowlen = 1 + target->w*4;
+	const size_t rawlen = rowlen*target->h;
+	const size_t nblocks = (rawlen + D2TK_OFFSCREEN_DEFLATE_MAX - 1)
+		/ D2TK_OFFSCREEN_DEFLATE_MAX;
+	int ret = 1;
+
+	uint8_t *raw = malloc(rawlen);
+	uint8_t *idat = malloc(2 + nblocks*5 + rawlen + 4);
+	FILE *f = fopen(path, "wb");
+
+	if(!raw || !idat || !f)
+	{
+		fprintf(stderr, "[%s] failed: '%s'\n", __func__, strerror(errno));
+		goto fail;
+	}
+
+	// unpremultiply to filter-less RGBA scanlines
+	for(d2tk_coord_t y = 0; y < target->h; y++)
+	{
+		const uint32_t *src = (const uint32_t *)((const uint8_t *)target->argb
+			+ y*target->stride);
+		uint8_t *dst = &raw[y*rowlen];
+
+		*dst++ = 0x0; // filter type none
+
+		for(d2tk_coord_t x = 0; x < target->w; x++)
+		{
+			const uint32_t p = src[x];
+			const uint32_t a = p >> 24;
+
+			for(unsigned s = 16, i = 0; i < 3; s -= 8, i++)
+			{
+				const uint32_t c = (p >> s) & 0xff;
+
+				*dst++ = a
+					? (c*0xff + a/2) / a
+					: 0x0;
+			}
+
+			*dst++ = a;
+		}
+	}
+
+	// zlib stream of stored deflate blocks
+	uint8_t *dst = idat;
+	uint32_t s1 = 1;
+	uint32_t s2 = 0;
+
+	*dst++ = 0x78;
+	*dst++ = 0x01;
+
+	for(size_t off = 0; off < rawlen; off += D2TK_OFFSCREEN_DEFLATE_MAX)
+	{
+		const size_t len = (rawlen - off) < D2TK_OFFSCREEN_DEFLATE_MAX
+			? rawlen - off
+			: D2TK_OFFSCREEN_DEFLATE_MAX;
+
+		*dst++ = (off + len == rawlen) ? 0x1 : 0x0; // BFINAL
+		*dst++ = len & 0xff;
+		*dst++ = len >> 8;
+		*dst++ = ~len & 0xff;
+		*dst++ = (~len >> 8) & 0xff;
+		memcpy(dst, &raw[off], len);
+		dst += len;
+
+		for(size_t i = 0; i < len; i++)
+		{
+			s1 = (s1 + raw[off + i]) % 65521;
+			s2 = (s2 + s1) % 65521;
+		}
+	}
+
+	dst = _d2tk_be32(dst, (s2 << 16) | s1);
+
+	uint8_t ihdr [13];
+	_d2tk_be32(&ihdr[0], target->w);
+	_d2tk_be32(&ihdr[4], target->h);
+	ihdr[8] = 8; // bit depth
+	ihdr[9] = 6; // color type RGBA
+	ihdr[10] = 0; // compression
+	ihdr[11] = 0; // filter
+	ihdr[12] = 0; // interlace
+
+	if(  (fwrite(sig, sizeof(sig), 1, f) != 1)
+		|| _d2tk_png_chunk(f, "IHDR", ihdr, sizeof(ihdr))
+		|| _d2tk_png_chunk(f, "IDAT", idat, dst - idat)
+		|| _d2tk_png_chunk(f, "IEND", NULL, 0) )
+	{
+		fprintf(stderr, "[%s] fwrite failed: '%s'\n", __func__, strerror(errno));
+		goto fail;
+	}
+
+	ret = 0;
+
+fail:
+	if(f)
+	{
+		fclose(f);
+	}
+
+	free(idat);
+	free(raw);
+
+	return ret;
+}
@@ -25,6 +25,12 @@
 # include <windows.h>
 #else
 # include <X11/Xresource.h>
+# include <pthread.h>
+# include <stdatomic.h>
+# include <poll.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <errno.h>
 #endif
 
 #include <pugl/pugl.h>
@@ -42,6 +48,14 @@
 #define KEY_TAB '\t'
 #define KEY_RETURN '\r'
 
+#define WATCH_MAX 32 // fds watched while idle
+
+#define FONT_SANS_BOLD    "FiraSans:bold"
+#define FONT_CODE_LIGHT   "FiraCode:light"
+#define FONT_CODE_REGULAR "FiraCode:regular"
+#define FONT_CODE_MEDIUM  "FiraCode:medium"
+#define FONT_CODE_BOLD    "FiraCode:bold"
+
 struct _d2tk_frontend_t {
 	const d2tk_pugl_config_t *config;
 	bool done;
@@ -49,6 +63,17 @@ struct _d2tk_frontend_t {
 	PuglView *view;
 	d2tk_base_t *base;
 	void *ctx;
+	d2tk_font_preload_t *preload;
+	bool pending; // redisplay posted since last update
+#if !defined(__APPLE__) && !defined(_WIN32)
+	pthread_t watcher;
+	bool watching;
+	int wake [2]; // re-arms the watcher, closed to stop it
+	pthread_mutex_t lock; // guards fds
+	int fds [WATCH_MAX];
+	int nfds;
+	atomic_bool ready; // watched fds had activity
+#endif
 };
 
 static inline void
@@ -519,9 +544,160 @@ d2tk_frontend_get_file_descriptors(d2tk_frontend_t *dpugl, int *fds, int numfds)
 	return idx + d2tk_base_get_file_descriptors(dpugl->base, &fds[idx], numfds-idx);
 }
 
+#if !defined(__APPLE__) && !defined(_WIN32)
+static void *
+_d2tk_frontend_watch(void *data)
+{
+	d2tk_frontend_t *dpugl = data;
+	struct pollfd fds [WATCH_MAX + 1];
+	char buf [32];
+
+	while(true)
+	{
+		nfds_t nfds = 0;
+
+		fds[nfds].fd = dpugl->wake[0];
+		fds[nfds].events = POLLIN;
+		fds[nfds++].revents = 0;
+
+		pthread_mutex_lock(&dpugl->lock);
+		for(int i = 0; i < dpugl->nfds; i++)
+		{
+			fds[nfds].fd = dpugl->fds[i];
+			fds[nfds].events = POLLIN;
+			fds[nfds++].revents = 0;
+		}
+		pthread_mutex_unlock(&dpugl->lock);
+
+		if(poll(fds, nfds, -1) == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		if(!fds[0].revents)
+		{
+			atomic_store(&dpugl->ready, true);
+		}
+
+		// block until the ui thread has stepped and re-armed us
+		if(read(dpugl->wake[0], buf, sizeof(buf)) <= 0)
+		{
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+_d2tk_frontend_watch_arm(d2tk_frontend_t *dpugl, bool fired)
+{
+	Display *disp = puglGetNativeWorld(dpugl->world);
+	int fds [WATCH_MAX];
+	int nfds = 0;
+
+	fds[nfds++] = ConnectionNumber(disp);
+
+	// hidden views don't drain their atoms, only wait for them to be shown
+	if(puglGetVisible(dpugl->view))
+	{
+		nfds += d2tk_base_get_file_descriptors(dpugl->base, &fds[nfds],
+			WATCH_MAX - nfds);
+	}
+
+	pthread_mutex_lock(&dpugl->lock);
+	const bool changed = (nfds != dpugl->nfds)
+		|| memcmp(fds, dpugl->fds, nfds*sizeof(int));
+	if(changed)
+	{
+		memcpy(dpugl->fds, fds, nfds*sizeof(int));
+		dpugl->nfds = nfds;
+	}
+	pthread_mutex_unlock(&dpugl->lock);
+
+	if( (fired || changed) && (write(dpugl->wake[1], "", 1) == -1) )
+	{
+		fprintf(stderr, "[%s] write failed: '%s'\n", __func__, strerror(errno));
+	}
+}
+
+static void
+_d2tk_frontend_watch_start(d2tk_frontend_t *dpugl)
+{
+	if(pipe2(dpugl->wake, O_CLOEXEC) == -1)
+	{
+		return;
+	}
+
+	pthread_mutex_init(&dpugl->lock, NULL);
+	atomic_init(&dpugl->ready, true); // step once to fill in the fds
+
+	if(pthread_create(&dpugl->watcher, NULL, _d2tk_frontend_watch, dpugl) != 0)
+	{
+		pthread_mutex_destroy(&dpugl->lock);
+		close(dpugl->wake[0]);
+		close(dpugl->wake[1]);
+		return;
+	}
+
+	dpugl->watching = true;
+}
+
+static void
+_d2tk_frontend_watch_stop(d2tk_frontend_t *dpugl)
+{
+	if(!dpugl->watching)
+	{
+		return;
+	}
+
+	close(dpugl->wake[1]);
+	pthread_join(dpugl->watcher, NULL);
+	close(dpugl->wake[0]);
+	pthread_mutex_destroy(&dpugl->lock);
+
+	dpugl->watching = false;
+}
+#endif
+
 D2TK_API int
 d2tk_frontend_step(d2tk_frontend_t *dpugl)
 {
+#if !defined(__APPLE__) && !defined(_WIN32)
+	if(dpugl->watching)
+	{
+		Display *disp = puglGetNativeWorld(dpugl->world);
+		const bool fired = atomic_exchange(&dpugl->ready, false);
+		const bool visible = puglGetVisible(dpugl->view);
+
+		if(visible && d2tk_base_get_again(dpugl->base))
+		{
+			d2tk_frontend_redisplay(dpugl);
+		}
+
+		// neither X, the atoms nor the ui have anything for us, stay idle, hidden
+		// views wait for X to show them again
+		if(!fired && !(visible && dpugl->pending)
+			&& !XEventsQueued(disp, QueuedAlready))
+		{
+			return dpugl->done;
+		}
+
+		dpugl->pending = false;
+
+		const int done = d2tk_frontend_poll(dpugl, 0.0);
+
+		_d2tk_frontend_watch_arm(dpugl, fired);
+
+		return done;
+	}
+#endif
+
 	return d2tk_frontend_poll(dpugl, 0.0);
 }
 
@@ -540,6 +716,10 @@ d2tk_frontend_run(d2tk_frontend_t *dpugl, const sig_atomic_t *done)
 D2TK_API void
 d2tk_frontend_free(d2tk_frontend_t *dpugl)
 {
+#if !defined(__APPLE__) && !defined(_WIN32)
+	_d2tk_frontend_watch_stop(dpugl);
+#endif
+
 	if(dpugl->world)
 	{
 		if(dpugl->view)
@@ -553,6 +733,11 @@ d2tk_frontend_free(d2tk_frontend_t *dpugl)
 		puglFreeWorld(dpugl->world);
 	}
 
+	if(dpugl->preload)
+	{
+		d2tk_font_preload_free(dpugl->preload);
+	}
+
 	free(dpugl);
 }
 
@@ -617,6 +802,19 @@ d2tk_pugl_new(const d2tk_pugl_config_t *config, uintptr_t *widget)
 
 	dpugl->config = config;
 
+	// faces of the default style and the monospaced widgets
+	static const char *faces [] = {
+		FONT_SANS_BOLD,
+		FONT_CODE_REGULAR,
+		FONT_CODE_MEDIUM,
+		FONT_CODE_BOLD,
+		FONT_CODE_LIGHT,
+		NULL
+	};
+
+	// overlap font lookup with window creation, first frame would block on it
+	dpugl->preload = d2tk_font_preload_new(config->bundle_path, faces);
+
 	dpugl->world = puglNewWorld(config->parent ? PUGL_MODULE : PUGL_PROGRAM, 0);
 	if(!dpugl->world)
 	{
@@ -678,6 +876,10 @@ d2tk_pugl_new(const d2tk_pugl_config_t *config, uintptr_t *widget)
 	}
 	puglShow(dpugl->view);
 
+#if !defined(__APPLE__) && !defined(_WIN32)
+	_d2tk_frontend_watch_start(dpugl);
+#endif
+
 	if(widget)
 	{
 		*widget = puglGetNativeWindow(dpugl->view);
@@ -697,6 +899,11 @@ fail:
 			puglFreeWorld(dpugl->world);
 		}
 
+		if(dpugl->preload)
+		{
+			d2tk_font_preload_free(dpugl->preload);
+		}
+
 		free(dpugl);
 	}
 
@@ -706,6 +913,7 @@ fail:
 D2TK_API void
 d2tk_frontend_redisplay(d2tk_frontend_t *dpugl)
 {
+	dpugl->pending = true;
 	puglPostRedisplay(dpugl->view);
 }
 
@@ -20,6 +20,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <poll.h>
 
 #include <d2tk/base.h>
 #include <d2tk/hash.h>
@@ -1514,6 +1515,37 @@ _test_default_style()
 	d2tk_base_free(base);
 }
 
+static void
+_test_style_hash()
+{
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	d2tk_base_t *base = d2tk_base_new(&d2tk_mock_driver_lazy, &ctx);
+	assert(base);
+
+	const uint64_t default_hash = d2tk_base_get_style_hash(base);
+	assert(default_hash == d2tk_hash(d2tk_base_get_default_style(),
+		sizeof(d2tk_style_t)));
+
+	d2tk_style_t custom_style = *d2tk_base_get_default_style();
+
+	// equal content gives equal hash
+	d2tk_base_set_style(base, &custom_style);
+	assert(d2tk_base_get_style_hash(base) == default_hash);
+
+	// changed content is picked up at next set
+	custom_style.padding += 1;
+	d2tk_base_set_style(base, &custom_style);
+	assert(d2tk_base_get_style_hash(base) != default_hash);
+
+	d2tk_base_set_default_style(base);
+	assert(d2tk_base_get_style_hash(base) == default_hash);
+
+	d2tk_base_free(base);
+}
+
 static void
 _test_scrollbar_x()
 {
@@ -2503,6 +2535,65 @@ _test_flowmatrix()
 #undef N
 }
 
+static int
+_test_file_descriptors_cb(void *data __attribute__((unused)), int fd_in,
+	int fd_out __attribute__((unused)))
+{
+	struct pollfd fds = {
+		.fd = fd_in,
+		.events = POLLIN
+	};
+
+	// stay alive for a while, the pty is closed once we return
+	poll(&fds, 1, 200);
+
+	return 0;
+}
+
+static void
+_test_file_descriptors()
+{
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	d2tk_base_t *base = d2tk_base_new(&d2tk_mock_driver_bench, &ctx);
+	assert(base);
+
+	d2tk_base_set_dimensions(base, DIM_W, DIM_H);
+	const d2tk_rect_t rect = D2TK_RECT(0, 0, DIM_W, DIM_H);
+	int fds [4];
+
+	assert(d2tk_base_get_file_descriptors(base, fds, 4) == 0);
+
+	// pty registers its fds
+	d2tk_base_pre(base, NULL);
+	D2TK_BASE_PTY(base, D2TK_ID, _test_file_descriptors_cb, NULL, 16, &rect,
+		D2TK_FLAG_NONE, pty)
+	{
+		// nothing to do
+	}
+	d2tk_base_post(base);
+
+	const int nfds = d2tk_base_get_file_descriptors(base, fds, 4);
+	assert(nfds >= 1);
+	assert(fds[0] > 0);
+	assert(d2tk_base_get_file_descriptors(base, fds, 0) == 0);
+
+	d2tk_base_probe(base);
+
+	// and unregisters them once it expires
+	for(unsigned i = 0; i < 32; i++)
+	{
+		d2tk_base_pre(base, NULL);
+		d2tk_base_post(base);
+	}
+
+	assert(d2tk_base_get_file_descriptors(base, fds, 4) == 0);
+
+	d2tk_base_free(base);
+}
+
 int
 main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
 {
@@ -2531,6 +2622,7 @@ main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
 	_test_state();
 	_test_hit();
 	_test_default_style();
+	_test_style_hash();
 	_test_scrollbar_x();
 	_test_scrollbar_y();
 	_test_pane_x();
@@ -2569,6 +2661,7 @@ main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
 	_test_prop_int32();
 	_test_prop_float();
 	_test_flowmatrix();
+	_test_file_descriptors();
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2018-2019 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <assert.h>
+
+#include <d2tk/core.h>
+#include <d2tk/base.h>
+#include <d2tk/hash.h>
+#include "mock.h"
+
+// grid of widget-sized cells filling the mock dimensions
+#define BENCH_NX 100
+#define BENCH_NY 100
+#define BENCH_W (DIM_W / BENCH_NX)
+#define BENCH_H (DIM_H / BENCH_NY)
+
+// iterations for hashing micro benchmarks
+#define BENCH_N 1000000
+
+static uint64_t
+_bench_now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+static d2tk_core_t *
+_bench_core_new(d2tk_mock_ctx_t *ctx)
+{
+	d2tk_core_t *core = d2tk_core_new(&d2tk_mock_driver_bench, ctx);
+	assert(core);
+
+	d2tk_core_set_dimensions(core, DIM_W, DIM_H);
+
+	return core;
+}
+
+static void
+_bench_diff_frame(d2tk_core_t *core, unsigned scroll, unsigned skip)
+{
+	d2tk_core_pre(core, NULL);
+
+	for(unsigned y = 0; y < BENCH_NY; y++)
+	{
+		for(unsigned x = 0; x < BENCH_NX; x++)
+		{
+			const unsigned line = y + scroll;
+
+			if(skip && ( ((line * BENCH_NX + x) % skip) == 0) )
+			{
+				continue;
+			}
+
+			const d2tk_rect_t rect = D2TK_RECT(x*BENCH_W, y*BENCH_H, BENCH_W, BENCH_H);
+			const ssize_t ref = d2tk_core_bbox_push(core, true, &rect);
+			assert(ref >= 0);
+
+			// content depends on the scrolled line, like a terminal cell
+			d2tk_core_rect(core, &D2TK_RECT(rect.x, rect.y, 1 + (line + x) % BENCH_W,
+				BENCH_H));
+
+			d2tk_core_bbox_pop(core, ref);
+		}
+	}
+
+	d2tk_core_post(core);
+}
+
+static void
+_bench_diff()
+{
+	static const struct {
+		const char *name;
+		unsigned scroll;
+		unsigned skip;
+	} frames [] = {
+		{ "initial",   0, 0 },
+		{ "unchanged", 0, 0 },
+		{ "scrolled",  1, 0 },
+		{ "removed",   1, 7 },
+		{ "appeared",  1, 0 }
+	};
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	d2tk_core_t *core = _bench_core_new(&ctx);
+
+	for(unsigned i = 0; i < sizeof(frames) / sizeof(frames[0]); i++)
+	{
+		const uint64_t t0 = _bench_now();
+		_bench_diff_frame(core, frames[i].scroll, frames[i].skip);
+		const uint64_t t1 = _bench_now();
+
+		const double us = (t1 - t0) * 1e-3;
+
+		fprintf(stdout, "[%s] %5u bboxes %-9s %9.1f us/frame\n", __func__,
+			BENCH_NX*BENCH_NY, frames[i].name, us);
+	}
+
+	d2tk_core_free(core);
+}
+
+static void
+_bench_widget_frame(d2tk_core_t *core)
+{
+	d2tk_core_pre(core, NULL);
+
+	for(unsigned y = 0; y < BENCH_NY; y++)
+	{
+		for(unsigned x = 0; x < BENCH_NX; x++)
+		{
+			const d2tk_rect_t rect = D2TK_RECT(x*BENCH_W, y*BENCH_H, BENCH_W, BENCH_H);
+
+			// label-like widget
+			D2TK_CORE_WIDGET(core, y*BENCH_NX + x + 1, widget)
+			{
+				const ssize_t ref = d2tk_core_bbox_push(core, true, &rect);
+				assert(ref >= 0);
+
+				d2tk_core_begin_path(core);
+				d2tk_core_rect(core, &rect);
+				d2tk_core_color(core, 0x222222ff);
+				d2tk_core_stroke_width(core, 0);
+				d2tk_core_fill(core);
+
+				d2tk_core_save(core);
+				d2tk_core_scissor(core, &rect);
+				d2tk_core_font_size(core, BENCH_H);
+				d2tk_core_font_face(core, 4, "Sans");
+				d2tk_core_color(core, 0xddddddff);
+				d2tk_core_text(core, &rect, 12, "label widget", D2TK_ALIGN_CENTERED);
+				d2tk_core_restore(core);
+
+				d2tk_core_bbox_pop(core, ref);
+			}
+		}
+	}
+
+	d2tk_core_post(core);
+}
+
+static void
+_bench_widget()
+{
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	d2tk_core_t *core = _bench_core_new(&ctx);
+
+	const d2tk_core_stats_t *stats = d2tk_core_get_stats(core);
+
+	// initial frame flushes memcaches, second one fills them
+	_bench_widget_frame(core);
+	_bench_widget_frame(core);
+
+	uint64_t build = 0;
+	unsigned nframes = 100;
+
+	for(unsigned i = 0; i < nframes; i++)
+	{
+		_bench_widget_frame(core);
+		build += stats->build;
+	}
+
+	fprintf(stdout, "[%s] %5u widgets replayed %9.1f us/frame %8"PRIu32" bytes\n",
+		__func__, BENCH_NX*BENCH_NY, build * 1e-3 / nframes, stats->bytes);
+
+	d2tk_core_free(core);
+}
+
+static void
+_bench_label_hash()
+{
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	d2tk_base_t *base = d2tk_base_new(&d2tk_mock_driver_lazy, &ctx);
+	assert(base);
+
+	const d2tk_rect_t rect = D2TK_RECT(0, 0, DIM_W, DIM_H);
+	const d2tk_style_t *style = d2tk_base_get_style(base);
+	const float mul = 1.f;
+	const d2tk_align_t align = D2TK_ALIGN_LEFT;
+	const char lbl [] = "label";
+	uint64_t sum = 0;
+
+	for(unsigned interned = 0; interned < 2; interned++)
+	{
+		const uint64_t t0 = _bench_now();
+		for(unsigned i = 0; i < BENCH_N; i++)
+		{
+			// like d2tk_base_label, with either full style or style hash as key
+			const uint64_t style_hash = d2tk_base_get_style_hash(base);
+			const d2tk_hash_dict_t dict [] = {
+				{ &rect, sizeof(d2tk_rect_t) },
+				interned
+					? (d2tk_hash_dict_t){ &style_hash, sizeof(uint64_t) }
+					: (d2tk_hash_dict_t){ style, sizeof(d2tk_style_t) },
+				{ &mul, sizeof(float) },
+				{ &align, sizeof(d2tk_align_t) },
+				{ lbl, sizeof(lbl) },
+				{ NULL, 0 }
+			};
+
+			sum += d2tk_hash_dict(dict);
+		}
+		const uint64_t t1 = _bench_now();
+
+		const double ns = t1 - t0;
+
+		fprintf(stdout, "[%s] %-8s %6.1f ns/label %7.2f Mlabels/s\n", __func__,
+			interned ? "interned" : "full", ns / BENCH_N, BENCH_N * 1e3 / ns);
+	}
+
+	assert(sum); // keep loop alive
+
+	d2tk_base_free(base);
+}
+
+int
+main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
+{
+	_bench_diff();
+	_bench_widget();
+	_bench_label_hash();
+
+	return EXIT_SUCCESS;
+}
@@ -1425,6 +1425,362 @@ _test_triple()
 	d2tk_core_free(core);
 }
 
+static void
+_test_stats_frame(d2tk_core_t *core, d2tk_coord_t w)
+{
+	d2tk_core_pre(core, NULL);
+
+	{
+		const ssize_t ref = d2tk_core_bbox_push(core, true,
+			&D2TK_RECT(CLIP_X, CLIP_Y, CLIP_W, CLIP_H));
+		assert(ref >= 0);
+
+		d2tk_core_rect(core, &D2TK_RECT(CLIP_X, CLIP_Y, w, CLIP_H));
+
+		d2tk_core_bbox_pop(core, ref);
+	}
+
+	D2TK_CORE_WIDGET(core, 0x1234, widget)
+	{
+		const ssize_t ref = d2tk_core_bbox_push(core, true,
+			&D2TK_RECT(CLIP_X, CLIP_Y + CLIP_H, CLIP_W, CLIP_H));
+		assert(ref >= 0);
+
+		d2tk_core_rect(core, &D2TK_RECT(CLIP_X, CLIP_Y + CLIP_H, CLIP_W, CLIP_H));
+
+		d2tk_core_bbox_pop(core, ref);
+	}
+
+	d2tk_core_post(core);
+}
+
+static void
+_test_stats()
+{
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	d2tk_core_t *core = d2tk_core_new(&d2tk_mock_driver_bench, &ctx);
+	assert(core);
+
+	d2tk_core_set_dimensions(core, DIM_W, DIM_H);
+
+	const d2tk_core_stats_t *stats = d2tk_core_get_stats(core);
+	assert(stats);
+	assert(stats->frame == 0);
+
+	// initial frame
+	_test_stats_frame(core, CLIP_W);
+
+	const uint32_t commands = stats->commands;
+
+	assert(stats->frame == 1);
+	assert(stats->full_refresh);
+	assert(commands == 5); // root + 2 bboxes + 2 rects
+	assert(stats->bytes > 0);
+	assert(stats->dirty_rects > 0);
+	assert(stats->dirty_area == DIM_W*DIM_H);
+	assert(stats->memcaches.misses == 1);
+	assert(stats->memcaches.hits == 0);
+	assert(stats->memcaches.evictions == 1); // flushed by full refresh
+	assert(stats->memcaches.entries == 0);
+
+	// unchanged frame, widget is cached anew
+	_test_stats_frame(core, CLIP_W);
+
+	assert(stats->frame == 2);
+	assert(!stats->full_refresh);
+	assert(stats->commands == commands);
+	assert(stats->appeared == 0);
+	assert(stats->disappeared == 0);
+	assert(stats->dirty_rects == 0);
+	assert(stats->dirty_area == 0);
+	assert(stats->memcaches.misses == 1);
+	assert(stats->memcaches.entries == 1);
+
+	// unchanged frame, widget is replayed from memcache
+	_test_stats_frame(core, CLIP_W);
+
+	assert(stats->frame == 3);
+	assert(stats->commands == commands);
+	assert(stats->dirty_rects == 0);
+	assert(stats->memcaches.misses == 0);
+	assert(stats->memcaches.hits == 1);
+
+	// changed frame
+	_test_stats_frame(core, CLIP_W/2);
+
+	assert(stats->frame == 4);
+	assert(stats->commands == commands);
+	assert(stats->matched >= 1);
+	assert(stats->appeared == 1);
+	assert(stats->disappeared == 1);
+	assert(stats->dirty_rects > 0);
+	assert(stats->dirty_area >= CLIP_W*CLIP_H);
+	assert(stats->dirty_area < DIM_W*DIM_H);
+
+	d2tk_core_free(core);
+}
+
+static void
+_test_text_extent()
+{
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	d2tk_core_t *core = d2tk_core_new(&d2tk_mock_driver_bench, &ctx);
+	assert(core);
+
+	d2tk_core_set_dimensions(core, DIM_W, DIM_H);
+
+	const d2tk_core_stats_t *stats = d2tk_core_get_stats(core);
+	assert(stats);
+
+	// initial frame, flushes extents by full refresh
+	_test_stats_frame(core, CLIP_W);
+
+	assert(d2tk_core_text_extent(core, 3, "foo", 10) == 15);
+	assert(ctx.text_extents == 1);
+	assert(d2tk_core_text_extent(core, 3, "foo", 10) == 15);
+	assert(ctx.text_extents == 1);
+	assert(d2tk_core_text_extent(core, 3, "foo", 20) == 30);
+	assert(ctx.text_extents == 2);
+	assert(d2tk_core_text_extent(core, 3, "bar", 10) == 15);
+	assert(ctx.text_extents == 3);
+	assert(d2tk_core_text_extent(core, 0, "", 10) == 0);
+	assert(ctx.text_extents == 4);
+	assert(d2tk_core_text_extent(core, 0, "", 10) == 0);
+	assert(ctx.text_extents == 4);
+
+	_test_stats_frame(core, CLIP_W);
+
+	assert(stats->extents.misses == 4);
+	assert(stats->extents.hits == 2);
+	assert(stats->extents.evictions == 0);
+	assert(stats->extents.entries == 4);
+
+	// unused extents expire
+	d2tk_core_set_ttls(core, 2, 2);
+
+	assert(d2tk_core_text_extent(core, 3, "foo", 10) == 15);
+	assert(ctx.text_extents == 4);
+
+	_test_stats_frame(core, CLIP_W);
+
+	assert(stats->extents.hits == 1);
+	assert(stats->extents.evictions == 3);
+	assert(stats->extents.entries == 1);
+
+	_test_stats_frame(core, CLIP_W);
+
+	assert(stats->extents.evictions == 1);
+	assert(stats->extents.entries == 0);
+
+	assert(d2tk_core_text_extent(core, 3, "foo", 10) == 15);
+	assert(ctx.text_extents == 5);
+
+	d2tk_core_free(core);
+}
+
+static void
+_test_mem_frame(d2tk_core_t *core, unsigned nrects)
+{
+	d2tk_core_pre(core, NULL);
+
+	const ssize_t ref = d2tk_core_bbox_push(core, false,
+		&D2TK_RECT(CLIP_X, CLIP_Y, CLIP_W, CLIP_H));
+	assert(ref >= 0);
+
+	for(unsigned i = 0; i < nrects; i++)
+	{
+		d2tk_core_rect(core, &D2TK_RECT(CLIP_X, CLIP_Y, i % CLIP_W, CLIP_H));
+	}
+
+	d2tk_core_bbox_pop(core, ref);
+
+	d2tk_core_post(core);
+}
+
+static void
+_test_mem()
+{
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	d2tk_core_t *core = d2tk_core_new(&d2tk_mock_driver_bench, &ctx);
+	assert(core);
+
+	d2tk_core_set_dimensions(core, DIM_W, DIM_H);
+
+	const d2tk_core_stats_t *stats = d2tk_core_get_stats(core);
+
+	// grow both buffers
+	_test_mem_frame(core, 0x2000);
+	_test_mem_frame(core, 0x2000);
+
+	const uint32_t size = stats->mem.size;
+	const uint32_t grows = stats->mem.grows;
+
+	assert(size >= stats->bytes);
+	assert(grows > 0);
+	assert(stats->mem.shrinks == 0);
+
+	// alternating volume neither grows nor shrinks
+	for(unsigned i = 0; i < 0x200; i++)
+	{
+		_test_mem_frame(core, (i & 2) ? 0x2000 : 0x10);
+
+		assert(stats->mem.size == size);
+		assert(stats->mem.grows == grows);
+		assert(stats->mem.shrinks == 0);
+	}
+
+	// only the used range is cleared
+	_test_mem_frame(core, 0x10);
+	_test_mem_frame(core, 0x10);
+	_test_mem_frame(core, 0x10);
+	assert(stats->mem.cleared < size / 0x10);
+
+	// low volume eventually shrinks
+	for(unsigned i = 0; i < 0x200; i++)
+	{
+		_test_mem_frame(core, 0x10);
+	}
+
+	assert(stats->mem.size < size);
+	assert(stats->mem.shrinks > 0);
+	assert(stats->mem.grows == grows);
+
+	d2tk_core_free(core);
+}
+
+static unsigned segment_rects;
+
+static void
+_check_segment(const d2tk_com_t *com,
+	const d2tk_clip_t *clip __attribute__((unused)))
+{
+	if(com->instr == D2TK_INSTR_RECT)
+	{
+		segment_rects += 1;
+	}
+}
+
+static void
+_test_segment_widget(d2tk_core_t *core)
+{
+	D2TK_CORE_WIDGET(core, 0x1234, widget)
+	{
+		// keep off the dirty tiles of the other bbox
+		const d2tk_rect_t rect = D2TK_RECT(CLIP_X, CLIP_Y + 2*CLIP_H,
+			CLIP_W, CLIP_H);
+		const ssize_t ref = d2tk_core_bbox_push(core, false, &rect);
+		assert(ref >= 0);
+
+		d2tk_core_rect(core, &rect);
+
+		d2tk_core_bbox_pop(core, ref);
+	}
+}
+
+static void
+_test_segment_frame(d2tk_core_t *core, d2tk_coord_t w, bool nested)
+{
+	d2tk_core_pre(core, NULL);
+
+	{
+		const ssize_t ref = d2tk_core_bbox_push(core, false,
+			&D2TK_RECT(CLIP_X, CLIP_Y, CLIP_W, CLIP_H));
+		assert(ref >= 0);
+
+		d2tk_core_rect(core, &D2TK_RECT(CLIP_X, CLIP_Y, w, CLIP_H));
+
+		d2tk_core_bbox_pop(core, ref);
+	}
+
+	if(nested)
+	{
+		D2TK_CORE_WIDGET(core, 0x5678, outer)
+		{
+			_test_segment_widget(core);
+		}
+	}
+	else
+	{
+		_test_segment_widget(core);
+	}
+
+	d2tk_core_post(core);
+}
+
+static void
+_test_segment()
+{
+	d2tk_mock_ctx_t ctx = {
+		.check = _check_segment
+	};
+
+	d2tk_core_t *core = d2tk_core_new(&d2tk_mock_driver_bench, &ctx);
+	assert(core);
+
+	d2tk_core_set_dimensions(core, DIM_W, DIM_H);
+
+	const d2tk_core_stats_t *stats = d2tk_core_get_stats(core);
+
+	// initial frame, caches are flushed by full refresh
+	segment_rects = 0;
+	_test_segment_frame(core, CLIP_W, false);
+	assert(segment_rects == 2);
+
+	// widget is cached inline
+	segment_rects = 0;
+	_test_segment_frame(core, CLIP_W, false);
+	assert(segment_rects == 0);
+	assert(stats->memcaches.misses == 1);
+
+	const uint32_t bytes = stats->bytes;
+
+	// widget is replayed by reference and its body released while in use
+	d2tk_core_set_full_refresh(core);
+	segment_rects = 0;
+	_test_segment_frame(core, CLIP_W, false);
+	assert(segment_rects == 2);
+	assert(stats->memcaches.hits == 1);
+	assert(stats->bytes < bytes);
+
+	// previous frame refers to released body
+	segment_rects = 0;
+	_test_segment_frame(core, CLIP_W, false);
+	assert(segment_rects == 0);
+	assert(stats->dirty_rects == 0);
+
+	// only the changed bbox is redrawn
+	segment_rects = 0;
+	_test_segment_frame(core, CLIP_W/2, false);
+	assert(segment_rects == 1);
+	assert(stats->memcaches.hits == 1);
+	assert(stats->appeared == 1);
+	assert(stats->disappeared == 1);
+
+	// cached widget is copied into a widget being cached
+	segment_rects = 0;
+	_test_segment_frame(core, CLIP_W/2, true);
+	assert(segment_rects == 0);
+	assert(stats->memcaches.misses == 1);
+	assert(stats->memcaches.hits == 1);
+
+	// widget with nested widget is replayed by reference
+	d2tk_core_set_full_refresh(core);
+	segment_rects = 0;
+	_test_segment_frame(core, CLIP_W/2, true);
+	assert(segment_rects == 2);
+
+	d2tk_core_free(core);
+}
+
 int
 main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
 {
@@ -1461,6 +1817,10 @@ main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
 	_test_stroke_width();
 
 	_test_triple();
+	_test_stats();
+	_test_text_extent();
+	_test_segment();
+	_test_mem();
 
 	return EXIT_SUCCESS;
 }
@@ -56,8 +56,10 @@ _d2tk_mock_post(void *data, d2tk_core_t *core, d2tk_coord_t w, d2tk_coord_t h,
 	assert(h == DIM_H);
 	assert(pass == 0);
 
+	size_t nrects;
 	d2tk_rect_t rect;
-	assert(d2tk_core_get_pixels(core, &rect));
+	assert(d2tk_core_get_dirty_rects(core, &nrects, &rect));
+	assert(nrects != 0);
 	assert( (rect.w != 0) && (rect.h != 0) );
 
 	return false; // do NOT enter 3rd pass
@@ -87,6 +89,18 @@ _d2tk_mock_sprite_free(void *data, uint8_t type, uintptr_t body)
 	free(dummy);
 }
 
+static inline int
+_d2tk_mock_text_extent(void *data, size_t len, const char *buf __attribute__((unused)),
+	d2tk_coord_t h)
+{
+	d2tk_mock_ctx_t *ctx = data;
+	assert(ctx);
+
+	ctx->text_extents += 1;
+
+	return len*h/2;
+}
+
 static inline void
 _d2tk_mock_process(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 	d2tk_coord_t xo, d2tk_coord_t yo,
@@ -232,6 +246,30 @@ _d2tk_mock_process_lazy(void *data, d2tk_core_t *core, const d2tk_com_t *com,
 	assert(num > 0);
 }
 
+static inline void
+_d2tk_mock_process_bench(void *data, d2tk_core_t *core, const d2tk_com_t *com,
+	d2tk_coord_t xo __attribute__((unused)), d2tk_coord_t yo __attribute__((unused)),
+	const d2tk_clip_t *clip __attribute__((unused)), unsigned pass)
+{
+	d2tk_mock_ctx_t *ctx = data;
+	assert(ctx);
+
+	assert(core);
+	assert(com);
+	assert(pass == 0);
+
+	assert(com->instr == D2TK_INSTR_BBOX);
+
+	// walk all commands like a backend would, bboxes may be empty
+	D2TK_COM_FOREACH_CONST(com, bbox)
+	{
+		if(ctx->check)
+		{
+			ctx->check(bbox, &com->body->bbox.clip);
+		}
+	}
+}
+
 const d2tk_core_driver_t d2tk_mock_driver = {
 	.new = NULL,
 	.free = NULL,
@@ -240,7 +278,8 @@ const d2tk_core_driver_t d2tk_mock_driver = {
 	.process = _d2tk_mock_process,
 	.post = _d2tk_mock_post,
 	.end = _d2tk_mock_end,
-	.sprite_free = _d2tk_mock_sprite_free
+	.sprite_free = _d2tk_mock_sprite_free,
+	.text_extent = _d2tk_mock_text_extent
 };
 
 const d2tk_core_driver_t d2tk_mock_driver_triple = {
@@ -251,7 +290,8 @@ const d2tk_core_driver_t d2tk_mock_driver_triple = {
 	.process = _d2tk_mock_process_triple,
 	.post = _d2tk_mock_post,
 	.end = _d2tk_mock_end,
-	.sprite_free = _d2tk_mock_sprite_free
+	.sprite_free = _d2tk_mock_sprite_free,
+	.text_extent = _d2tk_mock_text_extent
 };
 
 const d2tk_core_driver_t d2tk_mock_driver_lazy = {
@@ -262,5 +302,18 @@ const d2tk_core_driver_t d2tk_mock_driver_lazy = {
 	.process = _d2tk_mock_process_lazy,
 	.post = _d2tk_mock_post,
 	.end = _d2tk_mock_end,
-	.sprite_free = _d2tk_mock_sprite_free
+	.sprite_free = _d2tk_mock_sprite_free,
+	.text_extent = _d2tk_mock_text_extent
+};
+
+const d2tk_core_driver_t d2tk_mock_driver_bench = {
+	.new = NULL,
+	.free = NULL,
+	.context = _d2tk_mock_context,
+	.pre = _d2tk_mock_pre,
+	.process = _d2tk_mock_process_bench,
+	.post = _d2tk_mock_post,
+	.end = _d2tk_mock_end,
+	.sprite_free = _d2tk_mock_sprite_free,
+	.text_extent = _d2tk_mock_text_extent
 };
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2018-2019 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <d2tk/base.h>
+#include "mock.h"
+
+#define CORPUS_SIZE 0x400000 // 4M
+#define PTY_HEIGHT 16
+
+typedef struct _corpus_t corpus_t;
+
+struct _corpus_t {
+	const char *name;
+	void (*fill)(corpus_t *corpus);
+	char *buf;
+	size_t len;
+};
+
+static uint64_t
+_now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+__attribute__((format(printf, 2, 3)))
+static bool
+_append(corpus_t *corpus, const char *fmt, ...)
+{
+	const size_t rem = CORPUS_SIZE - corpus->len;
+	va_list args;
+
+	va_start(args, fmt);
+	const int len = vsnprintf(&corpus->buf[corpus->len], rem, fmt, args);
+	va_end(args);
+
+	if( (len < 0) || ((size_t)len >= rem) )
+	{
+		return false;
+	}
+
+	corpus->len += len;
+
+	return true;
+}
+
+// compiler output: mostly plain lines with a few SGR highlighted diagnostics
+static void
+_fill_compiler(corpus_t *corpus)
+{
+	for(unsigned i = 0; ; i++)
+	{
+		const unsigned line = i % 4096;
+		const unsigned col = i % 80;
+
+		const bool ok = (i % 7 == 0)
+			? _append(corpus,
+				"\033[1msrc/base_%u.c:%u:%u: \033[1;35mwarning: \033[0m"
+				"unused variable '\033[1mtmp%u\033[0m' [\033[1;35m-Wunused-variable\033[0m]\n"
+				"  %u |   int tmp%u = 0;\n"
+				"      |       \033[1;32m^~~~\033[0m\n",
+				i % 32, line, col, i, line, i)
+			: _append(corpus,
+				"[%u/4096] Compiling C object libd2tk.a.p/src_base_%u.c.o\n",
+				line, i % 32);
+
+		if(!ok)
+		{
+			break;
+		}
+	}
+}
+
+// htop-style full-screen redraws: absolute positioning with 256 colors
+static void
+_fill_redraw(corpus_t *corpus)
+{
+	for(unsigned frame = 0; ; frame++)
+	{
+		if(!_append(corpus, "\033[H"))
+		{
+			return;
+		}
+
+		for(unsigned row = 1; row <= 24; row++)
+		{
+			const unsigned pid = 1000 + row*7 + frame;
+			const unsigned cpu = (row*13 + frame*17) % 100;
+
+			if(!_append(corpus,
+				"\033[%u;1H\033[38;5;%um%6u \033[38;5;%u;48;5;%umroot     "
+				"%3u.%u \033[0m[\033[32m%.*s\033[0m%*s] \033[1msh\033[0m\033[K",
+				row, 16 + (row % 216), pid, 16 + (frame % 216), 232 + (row % 24),
+				cpu, frame % 10, (int)(cpu / 5), "||||||||||||||||||||",
+				(int)(20 - cpu / 5), ""))
+			{
+				return;
+			}
+		}
+	}
+}
+
+// utf-8 heavy text: box drawing, cjk, greek and emoji
+static void
+_fill_utf8(corpus_t *corpus)
+{
+	static const char *words [] = {
+		"\xe2\x94\x8c\xe2\x94\x80\xe2\x94\x80\xe2\x94\x90", // ┌──┐
+		"\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e", // 日本語
+		"\xce\xb1\xce\xb2\xce\xb3\xce\xb4", // αβγδ
+		"\xe2\x94\x82\xc3\xa4\xc3\xb6\xc3\xbc\xe2\x94\x82", // │äöü│
+		"\xf0\x9f\x94\x94", // bell emoji
+		"\xed\x95\x9c\xea\xb5\xad\xec\x96\xb4" // 한국어
+	};
+	const unsigned nwords = sizeof(words) / sizeof(words[0]);
+
+	for(unsigned i = 0; ; i++)
+	{
+		if(!_append(corpus, "%s%s", words[i % nwords], (i % 9 == 8) ? "\n" : " "))
+		{
+			break;
+		}
+	}
+}
+
+static int
+_feed(void *data, int fd_in __attribute__((unused)), int fd_out)
+{
+	const corpus_t *corpus = data;
+
+	for(size_t off = 0; off < corpus->len; )
+	{
+		const ssize_t written = write(fd_out, &corpus->buf[off], corpus->len - off);
+
+		if(written == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			fprintf(stderr, "[%s] write failed: '%s'\n", __func__, strerror(errno));
+			return 1;
+		}
+
+		off += written;
+	}
+
+	return 0;
+}
+
+static void
+_bench_pty(corpus_t *corpus)
+{
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	corpus->buf = malloc(CORPUS_SIZE);
+	assert(corpus->buf);
+	corpus->len = 0;
+	corpus->fill(corpus);
+
+	d2tk_base_t *base = d2tk_base_new(&d2tk_mock_driver_bench, &ctx);
+	assert(base);
+
+	d2tk_base_set_dimensions(base, DIM_W, DIM_H);
+	const d2tk_rect_t rect = D2TK_RECT(0, 0, DIM_W, DIM_H);
+
+	uint64_t ns_pty = 0;
+	uint64_t ns_post = 0;
+	unsigned nframes = 0;
+
+	for(bool done = false; !done; nframes++)
+	{
+		d2tk_base_pre(base, NULL);
+
+		const uint64_t t0 = _now();
+
+		// read -> vterm -> update -> draw
+		D2TK_BASE_PTY(base, D2TK_ID, _feed, corpus, PTY_HEIGHT, &rect,
+			D2TK_FLAG_NONE, pty)
+		{
+			done = d2tk_state_is_close(d2tk_pty_get_state(pty));
+		}
+
+		const uint64_t t1 = _now();
+
+		// diff -> driver
+		d2tk_base_post(base);
+
+		const uint64_t t2 = _now();
+
+		ns_pty += t1 - t0;
+		ns_post += t2 - t1;
+	}
+
+	d2tk_base_free(base);
+
+	const double mb = corpus->len / (1024.0 * 1024.0);
+
+	fprintf(stdout, "%-10s %7.2f MB %6u frames %9.2f MB/s %9.2f us/frame pty"
+		" %9.2f us/frame post\n",
+		corpus->name, mb, nframes,
+		mb * 1e9 / ns_pty,
+		ns_pty / 1e3 / nframes,
+		ns_post / 1e3 / nframes);
+
+	free(corpus->buf);
+}
+
+// a missing or invalid replay log must close the widget, not crash it
+static void
+_test_replay_invalid()
+{
+	static const struct {
+		const char *name;
+		const char *buf;
+		size_t len;
+	} logs [] = {
+		{ "missing",   NULL, 0 },
+		{ "truncated", "d2tk", 4 },
+		{ "corrupt",   "d2tkpty0\x50\x00\x00\x00\x18\x00\x00\x00", 16 },
+		{ "oversized", "d2tkpty1\xff\xff\x00\x00\x18\x00\x00\x00", 16 }
+	};
+	d2tk_mock_ctx_t ctx = {
+		.check = NULL
+	};
+
+	d2tk_base_t *base = d2tk_base_new(&d2tk_mock_driver_bench, &ctx);
+	assert(base);
+
+	d2tk_base_set_dimensions(base, DIM_W, DIM_H);
+	const d2tk_rect_t rect = D2TK_RECT(0, 0, DIM_W, DIM_H);
+
+	for(unsigned i = 0; i < sizeof(logs) / sizeof(logs[0]); i++)
+	{
+		char path [] = "/tmp/d2tk_replay_XXXXXX";
+
+		const int fd = mkstemp(path);
+		assert(fd != -1);
+
+		if(logs[i].buf)
+		{
+			assert(write(fd, logs[i].buf, logs[i].len) == (ssize_t)logs[i].len);
+		}
+		else
+		{
+			unlink(path);
+		}
+
+		close(fd);
+
+		for(unsigned frame = 0; frame < 3; frame++)
+		{
+			unsigned nclose = 0;
+
+			d2tk_base_pre(base, NULL);
+
+			D2TK_BASE_PTY(base, D2TK_ID_IDX(i), NULL, path, PTY_HEIGHT, &rect,
+				D2TK_FLAG_PTY_REPLAY, pty)
+			{
+				nclose += d2tk_state_is_close(d2tk_pty_get_state(pty));
+			}
+
+			d2tk_base_post(base);
+
+			assert(nclose == 1);
+		}
+
+		if(logs[i].buf)
+		{
+			unlink(path);
+		}
+
+		fprintf(stdout, "%-10s replay closed\n", logs[i].name);
+	}
+
+	d2tk_base_free(base);
+}
+
+int
+main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
+{
+	corpus_t corpora [] = {
+		{ .name = "compiler", .fill = _fill_compiler },
+		{ .name = "redraw",   .fill = _fill_redraw },
+		{ .name = "utf8",     .fill = _fill_utf8 }
+	};
+
+	_test_replay_invalid();
+
+	for(unsigned i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++)
+	{
+		_bench_pty(&corpora[i]);
+	}
+
+	return EXIT_SUCCESS;
+}